@@ -1,6 +1,7 @@
 #include <content_browser/asset_importing.hpp>
 
 #include <anton/array.hpp>
+#include <anton/assert.hpp>
 #include <anton/filesystem.hpp>
 #include <anton/math/math.hpp>
 #include <anton/string.hpp>
@@ -9,6 +10,8 @@
 #include <content_browser/importers/obj.hpp>
 #include <content_browser/importers/png.hpp>
 #include <content_browser/importers/tga.hpp>
+#include <content_browser/mesh_optimization.hpp>
+#include <content_browser/texture_processing.hpp>
 #include <core/paths.hpp>
 #include <core/utils/filesystem.hpp>
 #include <rendering/opengl.hpp>
@@ -68,22 +71,51 @@ namespace anton_engine::asset_importing {
     }
   }
 
-  [[nodiscard]] static i32 compute_number_of_mipmaps(u32 const width,
-                                                     u32 const height)
+  [[nodiscard]] static Block_Format
+  get_block_format(importers::Image const& image,
+                   Texture_Compression const compression)
   {
-    i32 mipmap_levels = 0;
-    u32 max_dim = math::max(width, height);
-    while(max_dim > 1) {
-      max_dim /= 2;
-      mipmap_levels += 1;
+    switch(image.pixel_format) {
+    case importers::Image_Pixel_Format::grey8:
+      return Block_Format::bc4;
+    case importers::Image_Pixel_Format::grey8_alpha8:
+      return Block_Format::bc5;
+    case importers::Image_Pixel_Format::rgb8:
+      return compression == Texture_Compression::bc1_bc3 ? Block_Format::bc1
+                                                         : Block_Format::bc7;
+    case importers::Image_Pixel_Format::rgba8:
+      return compression == Texture_Compression::bc1_bc3 ? Block_Format::bc3
+                                                         : Block_Format::bc7;
+    default:
+      throw Exception(u8"Pixel format does not support block compression");
+    }
+  }
+
+  [[nodiscard]] static opengl::Compressed_Internal_Format
+  get_matching_compressed_format(Block_Format const format)
+  {
+    using Compressed_Format = opengl::Compressed_Internal_Format;
+    // rgb8 and rgba8 are sRGB encoded. See get_matching_texture_format.
+    switch(format) {
+    case Block_Format::bc1:
+      return Compressed_Format::srgb_s3tc_dxt1;
+    case Block_Format::bc3:
+      return Compressed_Format::srgb_alpha_s3tc_dxt5;
+    case Block_Format::bc4:
+      return Compressed_Format::red_rgtc1;
+    case Block_Format::bc5:
+      return Compressed_Format::rg_rgtc2;
+    case Block_Format::bc7:
+      return Compressed_Format::srgb_alpha_bptc_unorm;
     }
-    return mipmap_levels;
+    ANTON_UNREACHABLE();
   }
 
   // TODO: Preprocess textures to limit the number of possible texture formats
   static void write_texture(anton::String_View const output_directory,
                             anton::String_View const file_original_path,
-                            importers::Image const& image)
+                            importers::Image const& image,
+                            Texture_Import_Options const& options)
   {
     u64 identifier = 0; // TODO generate identifier
     Texture_Format format;
@@ -93,15 +125,49 @@ namespace anton_engine::asset_importing {
     format.pixel_format = utils::enum_to_value(texture_format.format);
     format.sized_internal_format =
       utils::enum_to_value(texture_format.internal_format);
-    format.mip_levels = compute_number_of_mipmaps(format.width, format.height);
     memcpy(format.swizzle_mask, texture_format.swizzle_mask,
            sizeof(texture_format.swizzle_mask));
+    bool const wide_samples =
+      image.pixel_format == importers::Image_Pixel_Format::grey16 ||
+      image.pixel_format == importers::Image_Pixel_Format::grey16_alpha16 ||
+      image.pixel_format == importers::Image_Pixel_Format::rgb16 ||
+      image.pixel_format == importers::Image_Pixel_Format::rgba16;
+    format.pixel_type = wide_samples ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
     // TODO: Hardcoded values. Should be customizable.
-    format.pixel_type = GL_UNSIGNED_BYTE;
     format.filter = GL_NEAREST_MIPMAP_NEAREST;
-    i64 const image_bytes = image.data.size();
-    i64 const texture_chunk_size =
-      static_cast<i64>(sizeof(Texture_Format)) + 8 + image_bytes;
+
+    anton::Array<importers::Image> const mipmaps = generate_mipmaps(image);
+    format.mip_levels = mipmaps.size() + 1;
+    // Level 0 is the image itself.
+    anton::Array<anton::Array<u8>> compressed_levels;
+    bool const compress = options.compression != Texture_Compression::none &&
+                          is_compressible(image.pixel_format);
+    if(compress) {
+      Block_Format const block_format =
+        get_block_format(image, options.compression);
+      format.sized_internal_format =
+        utils::enum_to_value(get_matching_compressed_format(block_format));
+      compressed_levels.push_back(compress_image(image, block_format));
+      for(importers::Image const& level: mipmaps) {
+        compressed_levels.push_back(compress_image(level, block_format));
+      }
+    }
+
+    auto get_level_data = [&](i64 const level) -> anton::Array<u8> const& {
+      if(compress) {
+        return compressed_levels[level];
+      } else if(level == 0) {
+        return image.data;
+      } else {
+        return mipmaps[level - 1].data;
+      }
+    };
+
+    // Every level is prefixed with its size in bytes.
+    i64 texture_chunk_size = static_cast<i64>(sizeof(Texture_Format));
+    for(i64 level = 0; level < format.mip_levels; ++level) {
+      texture_chunk_size += 8 + get_level_data(level).size();
+    }
 
     anton::String_View const out_filename_no_ext =
       anton::fs::get_filename_no_extension(file_original_path);
@@ -118,32 +184,34 @@ namespace anton_engine::asset_importing {
     fwrite(reinterpret_cast<char const*>(&identifier), 8, 1, file);
     fwrite(reinterpret_cast<char const*>(&format), sizeof(Texture_Format), 1,
            file);
-    fwrite(
-      reinterpret_cast<char const*>(&image_bytes), 8, 1,
-      file); // Prefix the image with its size in bytes because that will simplify mipmap access
-    fwrite(reinterpret_cast<char const*>(image.data.data()), image_bytes, 1,
-           file);
+    for(i64 level = 0; level < format.mip_levels; ++level) {
+      anton::Array<u8> const& data = get_level_data(level);
+      i64 const level_bytes = data.size();
+      fwrite(reinterpret_cast<char const*>(&level_bytes), 8, 1, file);
+      fwrite(reinterpret_cast<char const*>(data.data()), level_bytes, 1,
+             file);
+    }
     fclose(file);
   }
 
-  void import_image(anton::String_View const path)
+  void import_image(anton::String_View const path,
+                    Texture_Import_Options const& options)
   {
     // TODO convert from gamma encoded/srgb space to linear
     // TODO include necessary info in the output file
     // TODO meta files
     // TODO support files with multiple images
-    // TODO generate mipmaps and save them to the file (if asked to do so)
 
     anton::Array<u8> const file = utils::read_file_binary(path);
     if(importers::test_png(file)) {
       importers::Image decoded_image = importers::import_png(file);
-      write_texture(paths::assets_directory(), path, decoded_image);
+      write_texture(paths::assets_directory(), path, decoded_image, options);
       return;
     }
 
     if(importers::test_tga(file)) {
       importers::Image decoded_image = importers::import_tga(file);
-      write_texture(paths::assets_directory(), path, decoded_image);
+      write_texture(paths::assets_directory(), path, decoded_image, options);
       return;
     }
 
@@ -158,16 +226,55 @@ namespace anton_engine::asset_importing {
     Vec2 const delta_uv2 = vert3.uv_coordinates - vert1.uv_coordinates;
     float const determinant =
       delta_uv1.x * delta_uv2.y - delta_uv1.y * delta_uv2.x;
-    Vec3 const tangent = math::normalize(
-      (delta_uv2.y * delta_pos1 - delta_uv1.y * delta_pos2) / determinant);
-    Vec3 const bitangent = math::normalize(
-      (delta_uv1.x * delta_pos2 - delta_uv2.x * delta_pos1) / determinant);
+    // Triangles with degenerate uv coordinates or positions do not define
+    // the tangent space.
+    if(determinant == 0.0f) {
+      return;
+    }
+
+    Vec3 const tangent =
+      (delta_uv2.y * delta_pos1 - delta_uv1.y * delta_pos2) / determinant;
+    Vec3 const bitangent =
+      (delta_uv1.x * delta_pos2 - delta_uv2.x * delta_pos1) / determinant;
+    if(math::length_squared(tangent) == 0.0f ||
+       math::length_squared(bitangent) == 0.0f) {
+      return;
+    }
 
-    vert1.tangent = vert2.tangent = vert3.tangent = tangent;
-    vert1.bitangent = vert2.bitangent = vert3.bitangent = bitangent;
+    // Vertices are shared between triangles. Accumulate and normalize once
+    // all triangles have been processed.
+    Vec3 const unit_tangent = math::normalize(tangent);
+    Vec3 const unit_bitangent = math::normalize(bitangent);
+    vert1.tangent += unit_tangent;
+    vert2.tangent += unit_tangent;
+    vert3.tangent += unit_tangent;
+    vert1.bitangent += unit_bitangent;
+    vert2.bitangent += unit_bitangent;
+    vert3.bitangent += unit_bitangent;
     //vert1.bitangent = vert2.bitangent = vert3.bitangent = Vec3::cross(vert1.normal, vert1.tangent);
   }
 
+  // Set the tangent and the bitangent of vertex to any orthonormal basis of
+  // the plane perpendicular to its normal.
+  static void compute_fallback_tangents(Vertex& vertex)
+  {
+    Vec3 const normal = vertex.normal;
+    Vec3 const axis = math::abs(normal.x) < 0.9f ? Vec3{1.0f, 0.0f, 0.0f}
+                                                 : Vec3{0.0f, 1.0f, 0.0f};
+    Vec3 const tangent = math::cross(axis, normal);
+    if(math::length_squared(tangent) == 0.0f) {
+      vertex.tangent = Vec3{1.0f, 0.0f, 0.0f};
+      vertex.bitangent = Vec3{0.0f, 1.0f, 0.0f};
+      return;
+    }
+
+    vertex.tangent = math::normalize(tangent);
+    vertex.bitangent = math::normalize(math::cross(normal, vertex.tangent));
+  }
+
+  // Size of the post-transform vertex cache meshes are optimized for.
+  constexpr i32 vertex_cache_size = 16;
+
   static Mesh process_mesh(importers::Mesh const& imported_mesh)
   {
     anton::Array<Vertex> vertices(imported_mesh.vertices.size());
@@ -191,11 +298,31 @@ namespace anton_engine::asset_importing {
       }
     }
 
+    for(Vertex& vertex: vertices) {
+      vertex.tangent = Vec3{0.0f, 0.0f, 0.0f};
+      vertex.bitangent = Vec3{0.0f, 0.0f, 0.0f};
+    }
+
     for(isize i = 0; i < indices.size(); i += 3) {
       compute_tangents(vertices[indices[i]], vertices[indices[i + 1]],
                        vertices[indices[i + 2]]);
     }
 
+    // Vertices of degenerate triangles have no tangents and the tangents of
+    // mirrored triangles may cancel out.
+    for(Vertex& vertex: vertices) {
+      if(math::length_squared(vertex.tangent) < 1e-12f ||
+         math::length_squared(vertex.bitangent) < 1e-12f) {
+        compute_fallback_tangents(vertex);
+      } else {
+        vertex.tangent = math::normalize(vertex.tangent);
+        vertex.bitangent = math::normalize(vertex.bitangent);
+      }
+    }
+
+    optimize_vertex_cache(indices, vertices.size(), vertex_cache_size);
+    optimize_overdraw(indices, vertices, vertex_cache_size, 1.05f);
+    optimize_vertex_fetch(vertices, indices);
     return {ANTON_MOV(vertices), ANTON_MOV(indices)};
   }
 
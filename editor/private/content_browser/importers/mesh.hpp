@@ -4,9 +4,14 @@
 #include <anton/math/vec2.hpp>
 #include <anton/math/vec3.hpp>
 #include <anton/string.hpp>
+#include <core/exception.hpp>
 #include <core/types.hpp>
 
 namespace anton_engine::importers {
+  class Invalid_Mesh_File: public Exception {
+    using Exception::Exception;
+  };
+
   class Face {
   public:
     anton::Array<u32> indices;
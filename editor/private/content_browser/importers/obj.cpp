@@ -1,6 +1,9 @@
 #include <content_browser/importers/obj.hpp>
 
-#include <cctype>
+#include <anton/math/math.hpp>
+#include <engine/ecs/jobs.hpp>
+
+#include <charconv> // std::from_chars
 
 namespace anton_engine::importers {
   bool test_obj(anton::String_View const file_extension,
@@ -14,246 +17,465 @@ namespace anton_engine::importers {
     }
   }
 
-  using stream_iterator = anton::Array<u8>::const_iterator;
-
-  struct Face_Internal {
-    anton::Array<u32> vertex_indices;
-    anton::Array<u32> texture_coordinate_indices;
-    anton::Array<u32> normal_indices;
+  // Indices of the attributes of a face corner or -1 if the attribute
+  // is not specified.
+  struct Corner {
+    i64 position;
+    i64 texture_coordinate;
+    i64 normal;
   };
 
+  [[nodiscard]] static bool operator==(Corner const lhs, Corner const rhs)
+  {
+    return lhs.position == rhs.position &&
+           lhs.texture_coordinate == rhs.texture_coordinate &&
+           lhs.normal == rhs.normal;
+  }
+
+  [[nodiscard]] static u64 hash_corner(Corner const corner)
+  {
+    u64 hash = static_cast<u64>(corner.position) * 0x9E3779B97F4A7C15ULL;
+    hash ^= static_cast<u64>(corner.texture_coordinate) * 0xC2B2AE3D27D4EB4FULL;
+    hash ^= static_cast<u64>(corner.normal) * 0x165667B19E3779F9ULL;
+    return hash ^ (hash >> 32);
+  }
+
   struct Mesh_Internal {
     anton::String name;
-    anton::Array<Face_Internal> faces;
+    // Corners of all faces stored contiguously.
+    anton::Array<Corner> corners;
+    // Number of corners of every face.
+    anton::Array<u32> face_sizes;
   };
 
-  static void seek(stream_iterator& iter, char c)
+  [[nodiscard]] static bool is_blank(u8 const c)
   {
-    while(*iter != c && *iter != '\0') {
-      ++iter;
-    }
+    return c == ' ' || c == '\t' || c == '\r';
   }
 
-  template<typename P>
-  void seek(stream_iterator& iter, P p)
+  static void skip_blanks(u8 const*& iter, u8 const* const end)
   {
-    while(!p(*iter)) {
+    while(iter != end && is_blank(*iter)) {
       ++iter;
     }
   }
 
-  static float read_float(stream_iterator& iter)
+  [[nodiscard]] static u8 const* find_line_end(u8 const* iter,
+                                               u8 const* const end)
   {
-    while(std::isspace(*iter) && *iter != '\n') {
+    while(iter != end && *iter != '\n') {
       ++iter;
     }
+    return iter;
+  }
 
-    float sign = 1.0f;
-    if(*iter == '-') {
-      sign = -1.0f;
+  // Returns: The parsed number or 0 if there is no number at iter.
+  static f32 read_float(u8 const*& iter, u8 const* const end)
+  {
+    skip_blanks(iter, end);
+    // from_chars does not accept a leading plus sign.
+    if(iter != end && *iter == '+') {
       ++iter;
     }
 
-    float number = 0.0f;
-    while(std::isdigit(*iter)) {
-      number *= 10.0f;
-      number += static_cast<float>(*iter - 48);
-      ++iter;
-    }
+    f32 number = 0.0f;
+    std::from_chars_result const result =
+      std::from_chars(reinterpret_cast<char const*>(iter),
+                      reinterpret_cast<char const*>(end), number);
+    iter = reinterpret_cast<u8 const*>(result.ptr);
+    return number;
+  }
 
-    if(*iter == '.') {
+  // Returns: The parsed number or 0 if there is no number at iter.
+  static i64 read_int64(u8 const*& iter, u8 const* const end)
+  {
+    skip_blanks(iter, end);
+    i64 sign = 1;
+    if(iter != end && *iter == '-') {
+      sign = -1;
       ++iter;
     }
 
-    float divisor = 1.0f;
-    while(std::isdigit(*iter)) {
-      divisor /= 10.0f;
-      number += static_cast<float>(*iter - 48) * divisor;
+    i64 number = 0;
+    while(iter != end && *iter >= '0' && *iter <= '9') {
+      number = number * 10 + (*iter - '0');
       ++iter;
     }
 
     return sign * number;
   }
 
-  static i64 read_int64(stream_iterator& iter)
+  enum struct Statement {
+    vertex,
+    texture_coordinate,
+    normal,
+    face,
+    object,
+    other,
+  };
+
+  // Read the keyword of the line starting at iter.
+  [[nodiscard]] static Statement read_statement(u8 const*& iter,
+                                                u8 const* const end)
   {
-    while(std::isspace(*iter) && *iter != '\n') {
+    skip_blanks(iter, end);
+    u8 const* const keyword = iter;
+    while(iter != end && !is_blank(*iter) && *iter != '\n') {
       ++iter;
     }
 
-    i64 sign = 1;
-    if(*iter == '-') {
-      sign = -1;
-      ++iter;
+    i64 const length = iter - keyword;
+    if(length == 1 && keyword[0] == 'v') {
+      return Statement::vertex;
+    } else if(length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+      return Statement::texture_coordinate;
+    } else if(length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+      return Statement::normal;
+    } else if(length == 1 && keyword[0] == 'f') {
+      return Statement::face;
+    } else if(length == 1 && keyword[0] == 'o') {
+      return Statement::object;
+    } else {
+      return Statement::other;
     }
+  }
 
-    i64 number = 0;
-    while(std::isdigit(*iter)) {
-      number *= 10;
-      number += static_cast<i64>(*iter - 48);
-      ++iter;
+  // A range of whole lines of the file parsed by a single job.
+  struct Obj_Chunk {
+    u8 const* first;
+    u8 const* last;
+    // Number of statements of each kind in the chunk.
+    i64 vertex_count = 0;
+    i64 texture_coordinate_count = 0;
+    i64 normal_count = 0;
+    // Number of statements of each kind in the preceding chunks.
+    i64 vertex_offset = 0;
+    i64 texture_coordinate_offset = 0;
+    i64 normal_offset = 0;
+    // Whether a face of the chunk refers to an element that does not exist.
+    bool invalid_reference = false;
+    // Faces preceding the first object of the chunk. They belong to the last
+    // object of the preceding chunks.
+    Mesh_Internal leading_faces;
+    anton::Array<Mesh_Internal> meshes;
+  };
+
+  static void count_statements(Obj_Chunk& chunk)
+  {
+    for(u8 const* iter = chunk.first; iter != chunk.last;) {
+      switch(read_statement(iter, chunk.last)) {
+      case Statement::vertex:
+        chunk.vertex_count += 1;
+        break;
+      case Statement::texture_coordinate:
+        chunk.texture_coordinate_count += 1;
+        break;
+      case Statement::normal:
+        chunk.normal_count += 1;
+        break;
+      default:
+        break;
+      }
+
+      iter = find_line_end(iter, chunk.last);
+      if(iter != chunk.last) {
+        ++iter;
+      }
     }
+  }
 
-    return sign * number;
+  // Resolve a 1-based or negative (relative) reference number of an element.
+  // count - number of the elements defined before the reference.
+  [[nodiscard]] static i64 resolve_index(i64 const index, i64 const count)
+  {
+    return index < 0 ? count + index : index - 1;
   }
 
-  static void parse_obj(stream_iterator obj_it, stream_iterator obj_it_end,
-                        anton::Array<Vec3>& vertices,
-                        anton::Array<Vec3>& normals,
-                        anton::Array<Vec3>& texture_coordinates,
-                        anton::Array<Mesh_Internal>& meshes_internal)
+  // Parse the statements of chunk. vertices, normals and texture_coordinates
+  // must be big enough to hold the elements of all chunks. Every chunk writes
+  // to its own range of them. References are checked against their sizes.
+  static void parse_chunk(Obj_Chunk& chunk, anton::Array<Vec3>& vertices,
+                          anton::Array<Vec3>& normals,
+                          anton::Array<Vec3>& texture_coordinates)
   {
     // TODO add support for object groups (statement g)
     // TODO parse lines and points
-    // TODO add more stream end checks to ensure we are not going past obj_it_end
-    Mesh_Internal* current_mesh = nullptr;
-    while(obj_it != obj_it_end) {
-      char c1 = *obj_it++;
-      char c2 = *obj_it++;
-      if(c1 == 'v' && c2 == ' ') {
+    u8 const* const end = chunk.last;
+    i64 vertex_count = chunk.vertex_offset;
+    i64 texture_coordinate_count = chunk.texture_coordinate_offset;
+    i64 normal_count = chunk.normal_offset;
+    Mesh_Internal* current_mesh = &chunk.leading_faces;
+    for(u8 const* iter = chunk.first; iter != end;) {
+      switch(read_statement(iter, end)) {
+      case Statement::vertex: {
         // Geometric vertex
         // May have 4 (x, y, z, w) parameters if the objects is a rational curve or a surface
         //   We just skip w because we don't support it
-        Vec3 vertex_postion;
-        vertex_postion.x = read_float(obj_it);
-        vertex_postion.y = read_float(obj_it);
-        vertex_postion.z = read_float(obj_it);
-        vertices.push_back(vertex_postion);
-        seek(obj_it, '\n');
-        ++obj_it;
-      } else if(c1 == 'v' && c2 == 'n') {
-        // Normal vector
-        Vec3 vertex_normal;
-        vertex_normal.x = read_float(obj_it);
-        vertex_normal.y = read_float(obj_it);
-        vertex_normal.z = read_float(obj_it);
-        normals.push_back(vertex_normal);
-        seek(obj_it, '\n');
-        ++obj_it;
-      } else if(c1 == 'v' && c2 == 't') {
-        // Vertex texture coordinates
-        Vec3 vertex_uv;
-        vertex_uv.x = read_float(obj_it);
-        vertex_uv.y = read_float(obj_it);
-        vertex_uv.z = read_float(obj_it);
-        texture_coordinates.push_back(vertex_uv);
-        seek(obj_it, '\n');
-        ++obj_it;
-      } else if(c1 == 'f') {
-        // Face
+        Vec3& vertex_position = vertices[vertex_count];
+        vertex_position.x = read_float(iter, end);
+        vertex_position.y = read_float(iter, end);
+        vertex_position.z = read_float(iter, end);
+        vertex_count += 1;
+      } break;
+
+      case Statement::normal: {
+        Vec3& vertex_normal = normals[normal_count];
+        vertex_normal.x = read_float(iter, end);
+        vertex_normal.y = read_float(iter, end);
+        vertex_normal.z = read_float(iter, end);
+        normal_count += 1;
+      } break;
+
+      case Statement::texture_coordinate: {
+        Vec3& vertex_uv = texture_coordinates[texture_coordinate_count];
+        vertex_uv.x = read_float(iter, end);
+        vertex_uv.y = read_float(iter, end);
+        vertex_uv.z = read_float(iter, end);
+        texture_coordinate_count += 1;
+      } break;
+
+      case Statement::face: {
         // Note: reference numbers in obj may be negative (relative to current position)...
-        Face_Internal face;
+        u32 face_size = 0;
         while(true) {
-          i64 pos_index = read_int64(obj_it);
+          Corner corner = {-1, -1, -1};
+          i64 const pos_index = read_int64(iter, end);
           if(pos_index == 0) {
             break;
-          } else {
-            if(pos_index < 0) {
-              pos_index = static_cast<i64>(vertices.size()) + pos_index;
-            } else {
-              pos_index -= 1; // OBJ uses 1 based arrays, thus subtract 1
-            }
-            face.vertex_indices.push_back(pos_index);
           }
 
-          if(*obj_it == '/') {
-            ++obj_it;
-            i64 uv_index = read_int64(obj_it);
+          corner.position = resolve_index(pos_index, vertex_count);
+          if(corner.position < 0 || corner.position >= vertices.size()) {
+            chunk.invalid_reference = true;
+          }
+
+          if(iter != end && *iter == '/') {
+            ++iter;
+            i64 const uv_index = read_int64(iter, end);
             if(uv_index != 0) {
-              if(uv_index < 0) {
-                uv_index =
-                  static_cast<i64>(texture_coordinates.size()) + uv_index;
-              } else {
-                uv_index -= 1; // OBJ uses 1 based arrays, thus subtract 1
+              corner.texture_coordinate =
+                resolve_index(uv_index, texture_coordinate_count);
+              if(corner.texture_coordinate < 0 ||
+                 corner.texture_coordinate >= texture_coordinates.size()) {
+                chunk.invalid_reference = true;
               }
-              face.texture_coordinate_indices.push_back(uv_index);
             }
           }
 
-          if(*obj_it == '/') {
-            ++obj_it;
-            i64 normal_index = read_int64(obj_it);
-            if(normal_index < 0) {
-              normal_index = static_cast<i64>(normals.size()) + normal_index;
-            } else {
-              normal_index -= 1; // OBJ uses 1 based arrays, thus subtract 1
+          if(iter != end && *iter == '/') {
+            ++iter;
+            i64 const normal_index = read_int64(iter, end);
+            if(normal_index != 0) {
+              corner.normal = resolve_index(normal_index, normal_count);
+              if(corner.normal < 0 || corner.normal >= normals.size()) {
+                chunk.invalid_reference = true;
+              }
             }
-            face.normal_indices.push_back(normal_index);
           }
+
+          current_mesh->corners.push_back(corner);
+          face_size += 1;
         }
-        current_mesh->faces.push_back(ANTON_MOV(face));
-        seek(obj_it, '\n');
-        ++obj_it;
-      } else if(c1 == 'o') {
+        current_mesh->face_sizes.push_back(face_size);
+      } break;
+
+      case Statement::object: {
         // Object name
-        while(std::isspace(*obj_it) && *obj_it != '\n') {
-          ++obj_it;
+        skip_blanks(iter, end);
+        u8 const* const name = iter;
+        while(iter != end && !is_blank(*iter) && *iter != '\n') {
+          ++iter;
         }
 
-        if(*obj_it == '\n') {
+        if(iter != name) {
+          chunk.meshes.emplace_back();
+          current_mesh = &chunk.meshes[chunk.meshes.size() - 1];
+          current_mesh->name =
+            anton::String(reinterpret_cast<char8 const*>(name), iter - name);
+        } else {
           // Could not find an object's name
           // throw (what exception?)
-        } else {
-          auto begin = obj_it;
-          while(!std::isspace(*obj_it)) {
-            ++obj_it;
-          }
-          meshes_internal.emplace_back();
-          current_mesh = &meshes_internal[meshes_internal.size() - 1];
-          current_mesh->name = anton::String((char8*)begin, obj_it - begin);
-          seek(obj_it, '\n');
-          ++obj_it;
         }
-      } else {
+      } break;
+
+      default:
         // Skip comments and unsupported or unknown statements/attributes
-        seek(obj_it, '\n');
-        ++obj_it;
+        break;
+      }
+
+      iter = find_line_end(iter, end);
+      if(iter != end) {
+        ++iter;
       }
     }
   }
 
-  anton::Array<Mesh> import_obj(anton::Array<u8> const& obj_data)
+  static void append_faces(Mesh_Internal& mesh, Mesh_Internal const& faces)
   {
-    // TODO face triangulation
-    anton::Array<Vec3> vertices;
-    anton::Array<Vec3> normals;
-    anton::Array<Vec3> texture_coordinates;
-    anton::Array<Mesh_Internal> meshes_internal;
-    parse_obj(obj_data.begin(), obj_data.end(), vertices, normals,
-              texture_coordinates, meshes_internal);
-
-    anton::Array<Mesh> meshes(anton::reserve, meshes_internal.size());
-    for(Mesh_Internal const& mesh_internal: meshes_internal) {
-      Mesh mesh;
-      mesh.name = mesh_internal.name;
-      anton::Array<Face> faces(anton::reserve, mesh_internal.faces.size());
-      for(Face_Internal const& face_internal: mesh_internal.faces) {
-        Face face;
-        for(u32 const index: face_internal.vertex_indices) {
-          mesh.vertices.push_back(vertices[index]);
-          u32 new_index = mesh.vertices.size() - 1;
-          face.indices.push_back(new_index);
+    for(Corner const corner: faces.corners) {
+      mesh.corners.push_back(corner);
+    }
+
+    for(u32 const face_size: faces.face_sizes) {
+      mesh.face_sizes.push_back(face_size);
+    }
+  }
+
+  static void parse_obj(anton::Array<u8> const& obj_data, i64 const chunk_size,
+                        anton::Array<Vec3>& vertices,
+                        anton::Array<Vec3>& normals,
+                        anton::Array<Vec3>& texture_coordinates,
+                        anton::Array<Mesh_Internal>& meshes_internal)
+  {
+    // Split the file at line boundaries.
+    u8 const* const data_end = obj_data.data() + obj_data.size();
+    anton::Array<Obj_Chunk> chunks;
+    for(u8 const* first = obj_data.data(); first != data_end;) {
+      u8 const* last = first + math::min(chunk_size, data_end - first);
+      last = find_line_end(last, data_end);
+      if(last != data_end) {
+        ++last;
+      }
+
+      chunks.emplace_back();
+      Obj_Chunk& chunk = chunks[chunks.size() - 1];
+      chunk.first = first;
+      chunk.last = last;
+      first = last;
+    }
+
+    // Count the elements first, so that every chunk knows where its elements
+    // go and can resolve relative references without waiting for the others.
+    parallel_for(chunks.size(), 1, [&chunks](i64 const first, i64 const last) {
+      for(i64 i = first; i < last; ++i) {
+        count_statements(chunks[i]);
+      }
+    });
+
+    for(i64 i = 1; i < chunks.size(); ++i) {
+      Obj_Chunk const& previous = chunks[i - 1];
+      chunks[i].vertex_offset = previous.vertex_offset + previous.vertex_count;
+      chunks[i].texture_coordinate_offset =
+        previous.texture_coordinate_offset + previous.texture_coordinate_count;
+      chunks[i].normal_offset = previous.normal_offset + previous.normal_count;
+    }
+
+    if(chunks.size() > 0) {
+      Obj_Chunk const& last_chunk = chunks[chunks.size() - 1];
+      vertices.resize(last_chunk.vertex_offset + last_chunk.vertex_count);
+      texture_coordinates.resize(last_chunk.texture_coordinate_offset +
+                                 last_chunk.texture_coordinate_count);
+      normals.resize(last_chunk.normal_offset + last_chunk.normal_count);
+    }
+
+    parallel_for(chunks.size(), 1, [&](i64 const first, i64 const last) {
+      for(i64 i = first; i < last; ++i) {
+        parse_chunk(chunks[i], vertices, normals, texture_coordinates);
+      }
+    });
+
+    // Jobs do not propagate exceptions, so invalid references are reported
+    // once all chunks have been parsed.
+    for(Obj_Chunk const& chunk: chunks) {
+      if(chunk.invalid_reference) {
+        throw Invalid_Mesh_File(
+          u8"Face refers to a vertex, normal or texture coordinate that does "
+          u8"not exist");
+      }
+    }
+
+    for(Obj_Chunk& chunk: chunks) {
+      if(chunk.leading_faces.face_sizes.size() != 0) {
+        // Faces that precede every object form an unnamed mesh.
+        if(meshes_internal.size() == 0) {
+          meshes_internal.emplace_back();
         }
+        append_faces(meshes_internal[meshes_internal.size() - 1],
+                     chunk.leading_faces);
+      }
 
-        if(face_internal.normal_indices.size() != 0) {
-          for(u32 const index: face_internal.normal_indices) {
-            mesh.normals.push_back(normals[index]);
-          }
-        } else {
-          // TODO compute normals (or not)
+      for(Mesh_Internal& mesh: chunk.meshes) {
+        meshes_internal.push_back(ANTON_MOV(mesh));
+      }
+    }
+  }
+
+  // Create a vertex for every unique corner of the faces of mesh_internal.
+  // Corners that do not specify an attribute get a zero vector, so that
+  // the attribute arrays stay parallel to the vertices.
+  static void build_mesh(Mesh_Internal const& mesh_internal,
+                         anton::Array<Vec3> const& vertices,
+                         anton::Array<Vec3> const& normals,
+                         anton::Array<Vec3> const& texture_coordinates,
+                         Mesh& mesh)
+  {
+    bool const has_normals = normals.size() != 0;
+    bool const has_texture_coordinates = texture_coordinates.size() != 0;
+    mesh.name = mesh_internal.name;
+    // Open addressing table mapping corners to the vertices created for them.
+    i64 capacity = 16;
+    while(capacity < 2 * mesh_internal.corners.size()) {
+      capacity *= 2;
+    }
+
+    anton::Array<u32> slots(capacity, static_cast<u32>(-1));
+    anton::Array<Corner> unique_corners;
+    anton::Array<Face> faces(anton::reserve, mesh_internal.face_sizes.size());
+    i64 corner_index = 0;
+    for(u32 const face_size: mesh_internal.face_sizes) {
+      Face face;
+      for(u32 i = 0; i < face_size; ++i, ++corner_index) {
+        Corner const corner = mesh_internal.corners[corner_index];
+        u64 slot = hash_corner(corner) & (capacity - 1);
+        while(slots[slot] != static_cast<u32>(-1) &&
+              !(unique_corners[slots[slot]] == corner)) {
+          slot = (slot + 1) & (capacity - 1);
         }
 
-        if(face_internal.texture_coordinate_indices.size() != 0) {
-          for(u32 const index: face_internal.texture_coordinate_indices) {
-            mesh.texture_coordinates.push_back(texture_coordinates[index]);
+        if(slots[slot] == static_cast<u32>(-1)) {
+          slots[slot] = unique_corners.size();
+          unique_corners.push_back(corner);
+          mesh.vertices.push_back(vertices[corner.position]);
+          if(has_normals) {
+            // TODO compute normals (or not)
+            mesh.normals.push_back(
+              corner.normal != -1 ? normals[corner.normal] : Vec3{});
+          }
+
+          if(has_texture_coordinates) {
+            mesh.texture_coordinates.push_back(
+              corner.texture_coordinate != -1
+                ? texture_coordinates[corner.texture_coordinate]
+                : Vec3{});
           }
         }
 
-        faces.push_back(ANTON_MOV(face));
+        face.indices.push_back(slots[slot]);
       }
-      mesh.faces = ANTON_MOV(faces);
-      meshes.push_back(ANTON_MOV(mesh));
+
+      faces.push_back(ANTON_MOV(face));
     }
+    mesh.faces = ANTON_MOV(faces);
+  }
+
+  anton::Array<Mesh> import_obj(anton::Array<u8> const& obj_data,
+                                i64 const chunk_size)
+  {
+    // TODO face triangulation
+    anton::Array<Vec3> vertices;
+    anton::Array<Vec3> normals;
+    anton::Array<Vec3> texture_coordinates;
+    anton::Array<Mesh_Internal> meshes_internal;
+    parse_obj(obj_data, chunk_size, vertices, normals, texture_coordinates,
+              meshes_internal);
+
+    anton::Array<Mesh> meshes(meshes_internal.size());
+    parallel_for(meshes.size(), 1, [&](i64 const first, i64 const last) {
+      for(i64 i = first; i < last; ++i) {
+        build_mesh(meshes_internal[i], vertices, normals, texture_coordinates,
+                   meshes[i]);
+      }
+    });
     return meshes;
   }
 } // namespace anton_engine::importers
@@ -8,5 +8,11 @@
 namespace anton_engine::importers {
   [[nodiscard]] bool test_obj(anton::String_View file_extension,
                               anton::Slice<u8 const> obj_data);
-  [[nodiscard]] anton::Array<Mesh> import_obj(anton::Array<u8> const& obj_data);
+  // The file is split at line boundaries into chunks of at least chunk_size
+  // bytes that are parsed in parallel. The result does not depend on
+  // chunk_size.
+  // Throws Invalid_Mesh_File if a face refers to an element that does not
+  // exist.
+  [[nodiscard]] anton::Array<Mesh> import_obj(anton::Array<u8> const& obj_data,
+                                              i64 chunk_size = 1 << 20);
 } // namespace anton_engine::importers
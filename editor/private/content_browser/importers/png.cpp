@@ -2,11 +2,19 @@
 
 #include <anton/array.hpp>
 #include <anton/math/math.hpp>
+#include <anton/swap.hpp>
 #include <anton/type_traits.hpp>
 #include <content_browser/importers/common.hpp>
 #include <core/types.hpp>
 #include <zlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+  #define ANTON_PNG_SSE 1
+  #include <emmintrin.h>
+#else
+  #define ANTON_PNG_SSE 0
+#endif
+
 namespace anton_engine::importers {
   constexpr u64 png_header = 0x89504E470D0A1A0A;
 
@@ -59,6 +67,56 @@ namespace anton_engine::importers {
   constexpr u32 chunk_tEXt = 0x74455874;
   constexpr u32 chunk_zTXt = 0x7A545874;
 
+  // Every filter reconstructs a scanline from
+  // x - bytes of the filtered scanline
+  // a - byte corresponding to x in the pixel before
+  // b - byte corresponding to x in the previous scanline
+  // c - byte corresponding to a in the previous scanline
+
+  static void unfilter_sub(u8 const* const in, u8* const out,
+                           i64 const scanline_width, i32 const pixel_width)
+  {
+    i64 i = 0;
+    for(; i < pixel_width; ++i) {
+      out[i] = in[i];
+    }
+    for(; i < scanline_width; ++i) {
+      out[i] = in[i] + out[i - pixel_width];
+    }
+  }
+
+  static void unfilter_up(u8 const* const in, u8 const* const prev,
+                          u8* const out, i64 const scanline_width)
+  {
+    i64 i = 0;
+#if ANTON_PNG_SSE
+    for(; i + 16 <= scanline_width; i += 16) {
+      __m128i const x =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+      __m128i const b =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(prev + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                       _mm_add_epi8(x, b));
+    }
+#endif
+    for(; i < scanline_width; ++i) {
+      out[i] = in[i] + prev[i];
+    }
+  }
+
+  static void unfilter_average(u8 const* const in, u8 const* const prev,
+                               u8* const out, i64 const scanline_width,
+                               i32 const pixel_width)
+  {
+    i64 i = 0;
+    for(; i < pixel_width; ++i) {
+      out[i] = in[i] + (prev[i] >> 1);
+    }
+    for(; i < scanline_width; ++i) {
+      out[i] = in[i] + ((out[i - pixel_width] + prev[i]) >> 1);
+    }
+  }
+
   static u8 paeth_predictor(i32 const a, i32 const b, i32 const c)
   {
     i32 const p = a + b - c;
@@ -74,76 +132,166 @@ namespace anton_engine::importers {
     }
   }
 
-  // x - byte being processed
-  // a - byte corresponding to x in the pixel before
-  // b - byte corresponding to x in the previous scanline
-  // c - byte corresponding to a in the previous scanline
-  static u8 reconstruct_sample(u8 const filter, u8 const x, u8 const a,
-                               u8 const b, u8 const c)
+  static void unfilter_paeth(u8 const* const in, u8 const* const prev,
+                             u8* const out, i64 const scanline_width,
+                             i32 const pixel_width)
+  {
+    i64 i = 0;
+    // a and c are 0 for the first pixel, so the predictor is always b.
+    for(; i < pixel_width; ++i) {
+      out[i] = in[i] + prev[i];
+    }
+    for(; i < scanline_width; ++i) {
+      out[i] = in[i] + paeth_predictor(out[i - pixel_width], prev[i],
+                                       prev[i - pixel_width]);
+    }
+  }
+
+#if ANTON_PNG_SSE
+  // 3 and 4 byte pixels (rgb8 and rgba8) fit into a single register, which
+  // lets us reconstruct all samples of a pixel at once. Every pixel still
+  // depends on the one before, so we go pixel by pixel.
+
+  static __m128i load_pixel(u8 const* const p, i32 const pixel_width)
+  {
+    u32 value = p[0] | (p[1] << 8) | (p[2] << 16);
+    if(pixel_width == 4) {
+      value |= static_cast<u32>(p[3]) << 24;
+    }
+    return _mm_cvtsi32_si128(static_cast<i32>(value));
+  }
+
+  static void store_pixel(u8* const p, __m128i const pixel,
+                          i32 const pixel_width)
+  {
+    u32 const value = static_cast<u32>(_mm_cvtsi128_si32(pixel));
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    if(pixel_width == 4) {
+      p[3] = value >> 24;
+    }
+  }
+
+  // Returns: Lanes of lhs where mask is set and lanes of rhs elsewhere.
+  static __m128i select(__m128i const mask, __m128i const lhs,
+                        __m128i const rhs)
+  {
+    return _mm_or_si128(_mm_and_si128(mask, lhs), _mm_andnot_si128(mask, rhs));
+  }
+
+  static void unfilter_sub_sse(u8 const* const in, u8* const out,
+                               i64 const scanline_width,
+                               i32 const pixel_width)
+  {
+    __m128i a = _mm_setzero_si128();
+    for(i64 i = 0; i < scanline_width; i += pixel_width) {
+      a = _mm_add_epi8(a, load_pixel(in + i, pixel_width));
+      store_pixel(out + i, a, pixel_width);
+    }
+  }
+
+  static void unfilter_average_sse(u8 const* const in, u8 const* const prev,
+                                   u8* const out, i64 const scanline_width,
+                                   i32 const pixel_width)
+  {
+    __m128i const ones = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for(i64 i = 0; i < scanline_width; i += pixel_width) {
+      __m128i const b = load_pixel(prev + i, pixel_width);
+      // _mm_avg_epu8 rounds up, PNG rounds down. The results differ by 1
+      // exactly when a + b is odd.
+      __m128i average = _mm_avg_epu8(a, b);
+      average =
+        _mm_sub_epi8(average, _mm_and_si128(_mm_xor_si128(a, b), ones));
+      a = _mm_add_epi8(average, load_pixel(in + i, pixel_width));
+      store_pixel(out + i, a, pixel_width);
+    }
+  }
+
+  static void unfilter_paeth_sse(u8 const* const in, u8 const* const prev,
+                                 u8* const out, i64 const scanline_width,
+                                 i32 const pixel_width)
+  {
+    // The predictor is computed on 16 bit lanes since the distances
+    // do not fit into 8 bits.
+    __m128i const zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    for(i64 i = 0; i < scanline_width; i += pixel_width) {
+      __m128i const b =
+        _mm_unpacklo_epi8(load_pixel(prev + i, pixel_width), zero);
+      // p = a + b - c, hence |p - a| = |b - c|, |p - b| = |a - c| and
+      // |p - c| = |(b - c) + (a - c)|.
+      __m128i pa = _mm_sub_epi16(b, c);
+      __m128i pb = _mm_sub_epi16(a, c);
+      __m128i pc = _mm_add_epi16(pa, pb);
+      pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+      pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+      pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+      __m128i const smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      // Ties are broken in favour of a, then b.
+      __m128i const predictor =
+        select(_mm_cmpeq_epi16(smallest, pa), a,
+               select(_mm_cmpeq_epi16(smallest, pb), b, c));
+      __m128i const x = _mm_add_epi8(_mm_packus_epi16(predictor, zero),
+                                     load_pixel(in + i, pixel_width));
+      store_pixel(out + i, x, pixel_width);
+      a = _mm_unpacklo_epi8(x, zero);
+      c = b;
+    }
+  }
+#endif
+
+  void unfilter_scanline_scalar(u8 const filter, u8 const* const in,
+                                u8 const* const prev, u8* const out,
+                                i64 const scanline_width,
+                                i32 const pixel_width)
   {
     switch(filter) {
     case filter_none:
-      return x;
+      anton::copy(in, in + scanline_width, out);
+      return;
     case filter_sub:
-      return x + a;
+      unfilter_sub(in, out, scanline_width, pixel_width);
+      return;
     case filter_up:
-      return x + b;
+      unfilter_up(in, prev, out, scanline_width);
+      return;
     case filter_average:
-      return x + ((a + b) >> 1);
+      unfilter_average(in, prev, out, scanline_width, pixel_width);
+      return;
     case filter_paeth:
-      return x + paeth_predictor(a, b, c);
+      unfilter_paeth(in, prev, out, scanline_width, pixel_width);
+      return;
     default:
       throw Invalid_Image_File("Invalid filter type");
     }
   }
 
-  // pixel_width - number of bytes per pixel
-  // scanline_width - number of bytes without the filter byte per scanline
-  // scanlines_total - number of scanlines
-  static void reconstruct_scanlines(u8 const* const pixels,
-                                    i32 const pixel_width,
-                                    i64 const scanline_width,
-                                    u32 const scanlines_total,
-                                    u8* const out_pixels)
+  void unfilter_scanline(u8 const filter, u8 const* const in,
+                         u8 const* const prev, u8* const out,
+                         i64 const scanline_width, i32 const pixel_width)
   {
-    // Reconstruct first scanline
-    {
-      u8 const scanline_filter = pixels[0];
-      // First pixel
-      for(i64 i = 0; i < pixel_width; ++i) {
-        out_pixels[i] =
-          reconstruct_sample(scanline_filter, pixels[i + 1], 0, 0, 0);
-      }
-      // Other pixels
-      for(i64 i = pixel_width; i < scanline_width; i += 1) {
-        out_pixels[i] = reconstruct_sample(scanline_filter, pixels[i + 1],
-                                           out_pixels[i - pixel_width], 0, 0);
-      }
-    }
-
-    // Reconstruct remaining scanlines
-    for(u32 scanline_index = 1; scanline_index < scanlines_total;
-        ++scanline_index) {
-      u8 const scanline_filter = pixels[scanline_index * (scanline_width + 1)];
-      i64 const prev_offset = scanline_width * (scanline_index - 1);
-      i64 const in_offset = (scanline_width + 1) * scanline_index;
-      i64 const out_offset = scanline_width * scanline_index;
-      // First pixel
-      for(i32 i = 0; i < pixel_width; ++i) {
-        out_pixels[out_offset + i] =
-          reconstruct_sample(scanline_filter, pixels[in_offset + i + 1], 0,
-                             out_pixels[prev_offset + i], 0);
-      }
-      // Other pixels
-      for(u32 i = pixel_width; i < scanline_width; i += 1) {
-        u8 current_byte = pixels[in_offset + i + 1];
-        u8 prev_byte = out_pixels[out_offset + i - pixel_width];
-        u8 up_byte = out_pixels[prev_offset + i];
-        u8 prev_up_byte = out_pixels[prev_offset + i - pixel_width];
-        out_pixels[out_offset + i] = reconstruct_sample(
-          scanline_filter, current_byte, prev_byte, up_byte, prev_up_byte);
+#if ANTON_PNG_SSE
+    if(pixel_width == 3 || pixel_width == 4) {
+      switch(filter) {
+      case filter_sub:
+        unfilter_sub_sse(in, out, scanline_width, pixel_width);
+        return;
+      case filter_average:
+        unfilter_average_sse(in, prev, out, scanline_width, pixel_width);
+        return;
+      case filter_paeth:
+        unfilter_paeth_sse(in, prev, out, scanline_width, pixel_width);
+        return;
+      default:
+        break;
       }
     }
+#endif
+    unfilter_scanline_scalar(filter, in, prev, out, scanline_width,
+                             pixel_width);
   }
 
   static void extract_adam7_pass(int const pass, u8 const*& pixels,
@@ -160,7 +308,7 @@ namespace anton_engine::importers {
       for(u64 column = starting_column[pass]; column < image_width;
           column += column_increment[pass]) {
         for(i32 i = 0; i < pixel_width; ++i, ++pixels) {
-          u64 position = (row * image_height + column) * pixel_width + i;
+          u64 position = (row * image_width + column) * pixel_width + i;
           out_pixels[position] = *pixels;
         }
       }
@@ -236,32 +384,105 @@ namespace anton_engine::importers {
     return header;
   }
 
-  static u64 get_decompression_buffer_size(i64 const width, i64 const height,
-                                           i64 const pixel_width,
-                                           bool const interlaced)
+  struct Filtered_Pass {
+    // Number of bytes per scanline without the filter byte.
+    i64 scanline_width;
+    i64 scanlines_total;
+  };
+
+  // Reconstructs the scanlines of all passes in order while the image data is
+  // being inflated, so that every scanline is unfiltered while it is still
+  // in cache.
+  struct Scanline_Reconstructor {
+    // Non-interlaced images consist of a single pass. Empty Adam7 passes
+    // are omitted since they have no scanlines in the image data.
+    Filtered_Pass passes[7];
+    i32 pass_count = 0;
+    i32 pixel_width = 0;
+    i32 pass = 0;
+    i64 scanline = 0;
+    // Offset of the next filtered scanline in the inflated data.
+    i64 in_offset = 0;
+    // Offset of the next reconstructed scanline.
+    i64 out_offset = 0;
+    // Stands in for the scanline above the first scanline of every pass.
+    anton::Array<u8> zero_scanline;
+  };
+
+  static Scanline_Reconstructor
+  make_scanline_reconstructor(i64 const width, i64 const height,
+                              i32 const pixel_width, bool const interlaced)
   {
+    Scanline_Reconstructor reconstructor;
+    reconstructor.pixel_width = pixel_width;
     if(!interlaced) {
-      return width * height * pixel_width + height;
+      reconstructor.passes[0] = {width * pixel_width, height};
+      reconstructor.pass_count = 1;
     } else {
       i64 const row_increment[7] = {8, 8, 8, 4, 4, 2, 2};
       i64 const column_increment[7] = {8, 8, 4, 4, 2, 2, 1};
       // Adam7 starting positions incremented by 1
       i64 const starting_row[7] = {1, 1, 5, 1, 3, 1, 2};
       i64 const starting_column[7] = {1, 5, 1, 3, 1, 2, 1};
-      u64 size = 0;
       for(int i = 0; i < 7; ++i) {
-        i64 const scanlines =
-          height < starting_row[i]
-            ? 0
-            : (height - starting_row[i]) / row_increment[i] + 1;
-        i64 const pixels =
-          width < starting_column[i]
-            ? 0
-            : (width - starting_column[i]) / column_increment[i] + 1;
-        size +=
-          (pixels * pixel_width) * scanlines + (pixels != 0 ? scanlines : 0);
+        if(height >= starting_row[i] && width >= starting_column[i]) {
+          i64 const scanlines =
+            (height - starting_row[i]) / row_increment[i] + 1;
+          i64 const pixels =
+            (width - starting_column[i]) / column_increment[i] + 1;
+          reconstructor.passes[reconstructor.pass_count] = {
+            pixels * pixel_width, scanlines};
+          reconstructor.pass_count += 1;
+        }
+      }
+    }
+
+    // No pass is wider than the image.
+    reconstructor.zero_scanline.resize(width * pixel_width, 0);
+    return reconstructor;
+  }
+
+  // Returns: Size of the filtered image data including the filter bytes.
+  static i64 get_filtered_size(Scanline_Reconstructor const& reconstructor)
+  {
+    i64 size = 0;
+    for(i32 i = 0; i < reconstructor.pass_count; ++i) {
+      Filtered_Pass const& pass = reconstructor.passes[i];
+      size += (pass.scanline_width + 1) * pass.scanlines_total;
+    }
+    return size;
+  }
+
+  // Reconstruct all complete scanlines that have not been reconstructed yet.
+  // pixels - filtered image data
+  // available - number of bytes of pixels that have already been inflated
+  // out_pixels - reconstructed image data with the passes stored one after
+  //              another
+  static void reconstruct_scanlines(Scanline_Reconstructor& reconstructor,
+                                    u8 const* const pixels,
+                                    i64 const available, u8* const out_pixels)
+  {
+    Scanline_Reconstructor& r = reconstructor;
+    while(r.pass < r.pass_count) {
+      Filtered_Pass const& pass = r.passes[r.pass];
+      if(r.in_offset + pass.scanline_width + 1 > available) {
+        return;
+      }
+
+      u8 const* prev = r.zero_scanline.data();
+      if(r.scanline != 0) {
+        prev = out_pixels + r.out_offset - pass.scanline_width;
+      }
+      unfilter_scanline(pixels[r.in_offset], pixels + r.in_offset + 1, prev,
+                        out_pixels + r.out_offset, pass.scanline_width,
+                        r.pixel_width);
+      r.in_offset += pass.scanline_width + 1;
+      r.out_offset += pass.scanline_width;
+      r.scanline += 1;
+      if(r.scanline == pass.scanlines_total) {
+        r.pass += 1;
+        r.scanline = 0;
       }
-      return size;
     }
   }
 
@@ -275,7 +496,6 @@ namespace anton_engine::importers {
   {
     // TODO Reduce number of memory allocations
     // TODO Make sure less than 8 bit images are handled correctly
-    // TODO Maybe filter/deinterlace on the fly?
     // TODO Add CRC checking
     i64 stream_pos = 8; // Skip png header which is 8 bytes long
     Chunk_Data const header_data = read_chunk(png_data.data(), stream_pos);
@@ -325,9 +545,11 @@ namespace anton_engine::importers {
 
     u64 const pixel_width =
       get_pixel_width(header.color_type, header.bit_depth);
-    u64 pixels_buffer_size = get_decompression_buffer_size(
+    Scanline_Reconstructor reconstructor = make_scanline_reconstructor(
       header.width, header.height, pixel_width, header.interlace_method);
-    anton::Array<u8> pixels(pixels_buffer_size);
+    anton::Array<u8> pixels(get_filtered_size(reconstructor));
+    anton::Array<u8> pixels_unfiltered(header.height * header.width *
+                                       pixel_width);
     z_stream stream;
     stream.next_out = pixels.data();
     stream.avail_out = pixels.size();
@@ -395,12 +617,20 @@ namespace anton_engine::importers {
           IDAT_read = true;
         }
 
+        i64 const inflated = stream.next_out - pixels.data();
+        reconstruct_scanlines(reconstructor, pixels.data(), inflated,
+                              pixels_unfiltered.data());
+
         break;
       }
       case chunk_IEND:
         if(!IDAT_read) {
           throw Invalid_Image_File("Missing IDAT chunks");
         }
+
+        if(reconstructor.pass != reconstructor.pass_count) {
+          throw Invalid_Image_File("Image data is incomplete");
+        }
         inflateEnd(&stream);
         end_loop = true;
         break;
@@ -492,39 +722,6 @@ namespace anton_engine::importers {
       }
     }
 
-    anton::Array<u8> pixels_unfiltered(header.height * header.width *
-                                       pixel_width);
-    if(header.interlace_method == 0) {
-      u64 const scanline_width = header.width * pixel_width;
-      reconstruct_scanlines(pixels.data(), pixel_width, scanline_width,
-                            header.height, pixels_unfiltered.data());
-    } else {
-      i64 const row_increment[7] = {8, 8, 8, 4, 4, 2, 2};
-      i64 const column_increment[7] = {8, 8, 4, 4, 2, 2, 1};
-      // Adam7 starting positions incremented by 1
-      i64 const starting_row[7] = {1, 1, 5, 1, 3, 1, 2};
-      i64 const starting_column[7] = {1, 5, 1, 3, 1, 2, 1};
-      u8 const* in_pixels = pixels.data();
-      u8* out_pixels = pixels_unfiltered.data();
-      i64 const height = static_cast<i64>(header.height);
-      i64 const width = static_cast<i64>(header.width);
-      for(int i = 0; i < 7; ++i) {
-        if(height >= starting_row[i] && width >= starting_column[i]) {
-          i64 const pass_scanline_total =
-            (height - starting_row[i]) / row_increment[i] + 1;
-          // Width without the filter byte
-          i64 const pass_scanline_width =
-            ((width - starting_column[i]) / column_increment[i] + 1) *
-            pixel_width;
-          reconstruct_scanlines(in_pixels, pixel_width, pass_scanline_width,
-                                pass_scanline_total, out_pixels);
-          in_pixels +=
-            pass_scanline_width * pass_scanline_total + pass_scanline_total;
-          out_pixels += pass_scanline_width * pass_scanline_total;
-        }
-      }
-    }
-
     if(header.interlace_method == 1) {
       pixels.resize(header.width * header.height * pixel_width);
       u8 const* pixels_ptr = pixels_unfiltered.data();
@@ -535,6 +732,14 @@ namespace anton_engine::importers {
       pixels_unfiltered = ANTON_MOV(pixels);
     }
 
+    // PNG stores 16 bit samples big endian, but OpenGL reads them in
+    // the native byte order, which is little endian on all our platforms.
+    if(header.bit_depth == 16) {
+      for(i64 i = 0; i + 1 < pixels_unfiltered.size(); i += 2) {
+        anton::swap(pixels_unfiltered[i], pixels_unfiltered[i + 1]);
+      }
+    }
+
     if(header.color_type == color_type_indexed) {
       u64 indexed_pixel_width = tRNS_present ? 4 : 3;
       anton::Array<u8> deindexed(anton::reserve, header.width * header.height *
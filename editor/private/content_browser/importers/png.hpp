@@ -1,8 +1,23 @@
 #pragma once
 
 #include <content_browser/importers/image.hpp>
+#include <core/types.hpp>
 
 namespace anton_engine::importers {
   bool test_png(anton::Array<u8> const&);
   Image import_png(anton::Array<u8> const&);
+
+  // Reconstruct a single scanline. Uses SSE2 for 3 and 4 byte pixels where
+  // available.
+  // filter - filter type byte of the scanline
+  // in - filtered scanline without the filter byte
+  // prev - reconstructed previous scanline or zeros for the first scanline
+  // scanline_width - number of bytes without the filter byte
+  // pixel_width - number of bytes per pixel
+  void unfilter_scanline(u8 filter, u8 const* in, u8 const* prev, u8* out,
+                         i64 scanline_width, i32 pixel_width);
+  // Same as unfilter_scanline, but does not use the per-pixel SSE2 paths.
+  void unfilter_scanline_scalar(u8 filter, u8 const* in, u8 const* prev,
+                                u8* out, i64 scanline_width,
+                                i32 pixel_width);
 } // namespace anton_engine::importers
@@ -0,0 +1,255 @@
+#include <content_browser/mesh_optimization.hpp>
+
+#include <anton/math/math.hpp>
+#include <anton/math/vec3.hpp>
+
+#include <algorithm> // std::stable_sort
+
+namespace anton_engine::asset_importing {
+  void optimize_vertex_cache(anton::Array<u32>& indices,
+                             i64 const vertex_count, i32 const cache_size)
+  {
+    i64 const triangle_count = indices.size() / 3;
+    if(triangle_count == 0) {
+      return;
+    }
+
+    // Triangles adjacent to vertex v are adjacency[offsets[v]..offsets[v + 1]).
+    anton::Array<u32> offsets(vertex_count + 1, 0);
+    for(i64 i = 0; i < 3 * triangle_count; ++i) {
+      offsets[indices[i] + 1] += 1;
+    }
+
+    // Number of triangles not yet emitted that use a vertex.
+    anton::Array<i64> live(vertex_count, 0);
+    for(i64 v = 0; v < vertex_count; ++v) {
+      live[v] = offsets[v + 1];
+      offsets[v + 1] += offsets[v];
+    }
+
+    anton::Array<u32> adjacency(3 * triangle_count, 0);
+    anton::Array<u32> cursors(offsets);
+    for(i64 i = 0; i < 3 * triangle_count; ++i) {
+      u32 const vertex = indices[i];
+      adjacency[cursors[vertex]] = i / 3;
+      cursors[vertex] += 1;
+    }
+
+    anton::Array<i64> cache_time(vertex_count, 0);
+    anton::Array<u8> emitted(triangle_count, 0);
+    anton::Array<u32> dead_end;
+    anton::Array<u32> candidates;
+    anton::Array<u32> result{anton::reserve, 3 * triangle_count};
+    i64 time = cache_size + 1;
+    // Next vertex to check when the dead-end stack runs out.
+    i64 cursor = 1;
+    i64 fanning = 0;
+    while(fanning >= 0) {
+      // Emit all remaining triangles of the fanning vertex.
+      candidates.clear();
+      for(u32 i = offsets[fanning]; i < offsets[fanning + 1]; ++i) {
+        u32 const triangle = adjacency[i];
+        if(emitted[triangle]) {
+          continue;
+        }
+
+        for(i64 k = 0; k < 3; ++k) {
+          u32 const vertex = indices[3 * triangle + k];
+          result.push_back(vertex);
+          dead_end.push_back(vertex);
+          candidates.push_back(vertex);
+          live[vertex] -= 1;
+          if(time - cache_time[vertex] > cache_size) {
+            cache_time[vertex] = time;
+            time += 1;
+          }
+        }
+        emitted[triangle] = 1;
+      }
+
+      // Pick the candidate that will still be in the cache after its
+      // remaining triangles have been emitted and was cached the earliest.
+      i64 next = -1;
+      i64 best_priority = -1;
+      for(u32 const vertex: candidates) {
+        if(live[vertex] > 0) {
+          i64 priority = 0;
+          if(time - cache_time[vertex] + 2 * live[vertex] <= cache_size) {
+            priority = time - cache_time[vertex];
+          }
+
+          if(priority > best_priority) {
+            best_priority = priority;
+            next = vertex;
+          }
+        }
+      }
+
+      // Dead end. Return to a recently used vertex or take the next vertex
+      // in input order.
+      while(next == -1 && dead_end.size() > 0) {
+        u32 const vertex = dead_end[dead_end.size() - 1];
+        dead_end.pop_back();
+        if(live[vertex] > 0) {
+          next = vertex;
+        }
+      }
+
+      while(next == -1 && cursor < vertex_count) {
+        if(live[cursor] > 0) {
+          next = cursor;
+        }
+        cursor += 1;
+      }
+
+      fanning = next;
+    }
+
+    indices = ANTON_MOV(result);
+  }
+
+  // Simulate a FIFO cache of cache_size vertices.
+  // Returns: Number of vertices of the triangle that missed the cache.
+  static i64 update_cache(u32 const* const triangle, i32 const cache_size,
+                          anton::Array<i64>& timestamps, i64& timestamp)
+  {
+    i64 misses = 0;
+    for(i64 k = 0; k < 3; ++k) {
+      u32 const vertex = triangle[k];
+      if(timestamp - timestamps[vertex] > cache_size) {
+        timestamps[vertex] = timestamp;
+        timestamp += 1;
+        misses += 1;
+      }
+    }
+    return misses;
+  }
+
+  void optimize_overdraw(anton::Array<u32>& indices,
+                         anton::Slice<Vertex const> const vertices,
+                         i32 const cache_size, f32 const threshold)
+  {
+    i64 const triangle_count = indices.size() / 3;
+    if(triangle_count == 0) {
+      return;
+    }
+
+    // Hard boundaries are where all vertices of a triangle miss the cache,
+    // which usually starts a disjoint patch of the mesh.
+    anton::Array<i64> timestamps(vertices.size(), 0);
+    i64 timestamp = cache_size + 1;
+    anton::Array<i64> hard_boundaries;
+    for(i64 t = 0; t < triangle_count; ++t) {
+      i64 const misses =
+        update_cache(&indices[3 * t], cache_size, timestamps, timestamp);
+      if(t == 0 || misses == 3) {
+        hard_boundaries.push_back(t);
+      }
+    }
+    hard_boundaries.push_back(triangle_count);
+
+    // Split clusters further wherever the running miss ratio reaches the
+    // threshold. The cache is flushed at every boundary, since clusters are
+    // drawn in a different order.
+    anton::Array<i64> boundaries;
+    for(i64 h = 0; h + 1 < hard_boundaries.size(); ++h) {
+      i64 const first = hard_boundaries[h];
+      i64 const last = hard_boundaries[h + 1];
+      timestamp += cache_size + 1;
+      i64 cluster_misses = 0;
+      for(i64 t = first; t < last; ++t) {
+        cluster_misses +=
+          update_cache(&indices[3 * t], cache_size, timestamps, timestamp);
+      }
+
+      f32 const cluster_threshold =
+        threshold * static_cast<f32>(cluster_misses) / (last - first);
+      timestamp += cache_size + 1;
+      boundaries.push_back(first);
+      i64 running_misses = 0;
+      i64 running_triangles = 0;
+      for(i64 t = first; t < last; ++t) {
+        running_misses +=
+          update_cache(&indices[3 * t], cache_size, timestamps, timestamp);
+        running_triangles += 1;
+        if(static_cast<f32>(running_misses) / running_triangles <=
+           cluster_threshold) {
+          boundaries.push_back(t + 1);
+          timestamp += cache_size + 1;
+          running_misses = 0;
+          running_triangles = 0;
+        }
+      }
+
+      if(boundaries[boundaries.size() - 1] == last) {
+        boundaries.pop_back();
+      }
+    }
+    boundaries.push_back(triangle_count);
+
+    Vec3 mesh_centroid{0.0f, 0.0f, 0.0f};
+    for(u32 const index: indices) {
+      mesh_centroid += vertices[index].position;
+    }
+    mesh_centroid /= static_cast<f32>(indices.size());
+
+    // Clusters whose area weighted normal points away from the center of
+    // the mesh are likely to occlude the others.
+    i64 const cluster_count = boundaries.size() - 1;
+    anton::Array<f32> sort_keys(cluster_count, 0.0f);
+    for(i64 cluster = 0; cluster < cluster_count; ++cluster) {
+      Vec3 centroid{0.0f, 0.0f, 0.0f};
+      Vec3 normal{0.0f, 0.0f, 0.0f};
+      f32 area = 0.0f;
+      for(i64 t = boundaries[cluster]; t < boundaries[cluster + 1]; ++t) {
+        Vec3 const a = vertices[indices[3 * t]].position;
+        Vec3 const b = vertices[indices[3 * t + 1]].position;
+        Vec3 const c = vertices[indices[3 * t + 2]].position;
+        Vec3 const cross = math::cross(b - a, c - a);
+        f32 const triangle_area = math::length(cross);
+        centroid += (a + b + c) * (triangle_area / 3.0f);
+        normal += cross;
+        area += triangle_area;
+      }
+
+      f32 const normal_length = math::length(normal);
+      if(area > 0.0f && normal_length > 0.0f) {
+        sort_keys[cluster] = math::dot(centroid / area - mesh_centroid,
+                                 normal / normal_length);
+      }
+    }
+
+    anton::Array<i64> order(cluster_count, 0);
+    for(i64 cluster = 0; cluster < cluster_count; ++cluster) {
+      order[cluster] = cluster;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&sort_keys](i64 const lhs, i64 const rhs) {
+                       return sort_keys[lhs] > sort_keys[rhs];
+                     });
+
+    anton::Array<u32> result{anton::reserve, indices.size()};
+    for(i64 const cluster: order) {
+      for(i64 i = 3 * boundaries[cluster]; i < 3 * boundaries[cluster + 1];
+          ++i) {
+        result.push_back(indices[i]);
+      }
+    }
+    indices = ANTON_MOV(result);
+  }
+
+  void optimize_vertex_fetch(anton::Array<Vertex>& vertices,
+                             anton::Array<u32>& indices)
+  {
+    anton::Array<u32> remap(vertices.size(), static_cast<u32>(-1));
+    anton::Array<Vertex> result{anton::reserve, vertices.size()};
+    for(u32& index: indices) {
+      if(remap[index] == static_cast<u32>(-1)) {
+        remap[index] = result.size();
+        result.push_back(vertices[index]);
+      }
+      index = remap[index];
+    }
+    vertices = ANTON_MOV(result);
+  }
+} // namespace anton_engine::asset_importing
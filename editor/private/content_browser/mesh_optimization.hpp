@@ -0,0 +1,28 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <anton/slice.hpp>
+#include <core/types.hpp>
+#include <engine/mesh.hpp>
+
+namespace anton_engine::asset_importing {
+  // Reorder the triangles to reuse vertices in the post-transform cache
+  // with Tipsify (Sander et al., "Fast Triangle Reordering for Vertex
+  // Locality and Reduced Overdraw").
+  // indices - triangle list.
+  void optimize_vertex_cache(anton::Array<u32>& indices, i64 vertex_count,
+                             i32 cache_size);
+
+  // Split the cache optimized triangles into clusters and sort the clusters
+  // so that those facing away from the center of the mesh are drawn first.
+  // threshold - how much the average cache miss ratio of a cluster may exceed
+  //             that of the original order, e.g. 1.05 allows 5% more misses.
+  void optimize_overdraw(anton::Array<u32>& indices,
+                         anton::Slice<Vertex const> vertices, i32 cache_size,
+                         f32 threshold);
+
+  // Reorder the vertices in the order of their first use by the triangles.
+  // Removes unused vertices.
+  void optimize_vertex_fetch(anton::Array<Vertex>& vertices,
+                             anton::Array<u32>& indices);
+} // namespace anton_engine::asset_importing
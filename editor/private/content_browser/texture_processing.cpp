@@ -0,0 +1,560 @@
+#include <content_browser/texture_processing.hpp>
+
+#include <anton/assert.hpp>
+#include <anton/math/math.hpp>
+#include <anton/swap.hpp>
+#include <engine/ecs/jobs.hpp>
+
+#include <cmath> // std::pow
+
+namespace anton_engine::asset_importing {
+  using importers::Image;
+  using importers::Image_Pixel_Format;
+
+  struct Sample_Layout {
+    i32 channels;
+    // Number of bytes per sample. 16 bit samples are little endian.
+    i32 sample_size;
+    // Number of leading channels that are sRGB encoded.
+    i32 srgb_channels;
+  };
+
+  [[nodiscard]] static Sample_Layout
+  get_sample_layout(Image_Pixel_Format const format)
+  {
+    switch(format) {
+    case Image_Pixel_Format::grey8:
+      return {1, 1, 0};
+    case Image_Pixel_Format::grey16:
+      return {1, 2, 0};
+    case Image_Pixel_Format::grey8_alpha8:
+      return {2, 1, 0};
+    case Image_Pixel_Format::grey16_alpha16:
+      return {2, 2, 0};
+    case Image_Pixel_Format::rgb8:
+      return {3, 1, 3};
+    case Image_Pixel_Format::rgb16:
+      return {3, 2, 0};
+    case Image_Pixel_Format::rgba8:
+      return {4, 1, 3};
+    case Image_Pixel_Format::rgba16:
+      return {4, 2, 0};
+    }
+    ANTON_UNREACHABLE();
+  }
+
+  [[nodiscard]] static f32 srgb_to_linear(f32 const value)
+  {
+    if(value <= 0.04045f) {
+      return value / 12.92f;
+    }
+    return std::pow((value + 0.055f) / 1.055f, 2.4f);
+  }
+
+  [[nodiscard]] static f32 linear_to_srgb(f32 const value)
+  {
+    if(value <= 0.0031308f) {
+      return value * 12.92f;
+    }
+    return 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+  }
+
+  // Pixels of the larger level covered by a pixel of the smaller level along
+  // a single dimension.
+  struct Filter_Taps {
+    i64 first;
+    i32 count;
+    f32 weights[3];
+  };
+
+  // Returns: Taps of the pixel at index of a dimension downsampled from
+  //          src_size to dst_size pixels.
+  [[nodiscard]] static Filter_Taps
+  get_filter_taps(i64 const src_size, i64 const dst_size, i64 const index)
+  {
+    if(src_size == 1) {
+      return {0, 1, {1.0f}};
+    }
+
+    if(src_size % 2 == 0) {
+      return {2 * index, 2, {0.5f, 0.5f}};
+    }
+
+    // Every pixel covers 2 + 1 / dst_size pixels of the larger level, which
+    // overlaps the pixels on both sides of the middle one partially.
+    f32 const size = static_cast<f32>(src_size);
+    return {2 * index,
+            3,
+            {static_cast<f32>(dst_size - index) / size,
+             static_cast<f32>(dst_size) / size,
+             static_cast<f32>(index + 1) / size}};
+  }
+
+  // Number of rows of the smaller level downsampled by a single job.
+  constexpr i64 downsample_grain = 32;
+
+  // Downsample src into dst averaging the pixels covered by every pixel of
+  // dst. See get_filter_taps.
+  // linear_table - linear values of the 8 bit sRGB encoded values.
+  static void downsample(Image const& src, Image& dst,
+                         Sample_Layout const layout,
+                         f32 const* const linear_table)
+  {
+    i64 const src_width = src.width;
+    i64 const src_height = src.height;
+    i64 const dst_width = dst.width;
+    i64 const dst_height = dst.height;
+    i64 const pixel_size = layout.channels * layout.sample_size;
+    parallel_for(dst_height, downsample_grain, [&](i64 const first,
+                                                   i64 const last) {
+      for(i64 y = first; y < last; ++y) {
+        Filter_Taps const taps_y = get_filter_taps(src_height, dst_height, y);
+        for(i64 x = 0; x < dst_width; ++x) {
+          Filter_Taps const taps_x = get_filter_taps(src_width, dst_width, x);
+          u8* const out = dst.data.data() + (y * dst_width + x) * pixel_size;
+          for(i32 c = 0; c < layout.channels; ++c) {
+            i64 const offset = c * layout.sample_size;
+            bool const srgb = c < layout.srgb_channels;
+            f32 sum = 0.0f;
+            for(i32 j = 0; j < taps_y.count; ++j) {
+              u8 const* const row =
+                src.data.data() + (taps_y.first + j) * src_width * pixel_size;
+              for(i32 i = 0; i < taps_x.count; ++i) {
+                u8 const* const sample =
+                  row + (taps_x.first + i) * pixel_size + offset;
+                f32 value;
+                if(layout.sample_size == 2) {
+                  value = static_cast<f32>(sample[0] | (sample[1] << 8));
+                } else if(srgb) {
+                  value = linear_table[sample[0]];
+                } else {
+                  value = sample[0];
+                }
+                sum += taps_y.weights[j] * taps_x.weights[i] * value;
+              }
+            }
+
+            if(layout.sample_size == 2) {
+              u32 const value = static_cast<u32>(sum + 0.5f);
+              out[offset] = value;
+              out[offset + 1] = value >> 8;
+            } else if(srgb) {
+              out[c] = static_cast<u8>(linear_to_srgb(sum) * 255.0f + 0.5f);
+            } else {
+              out[c] = static_cast<u8>(sum + 0.5f);
+            }
+          }
+        }
+      }
+    });
+  }
+
+  anton::Array<Image> generate_mipmaps(Image const& image)
+  {
+    Sample_Layout const layout = get_sample_layout(image.pixel_format);
+    i64 const pixel_size = layout.channels * layout.sample_size;
+    f32 linear_table[256];
+    for(i32 i = 0; i < 256; ++i) {
+      linear_table[i] = srgb_to_linear(static_cast<f32>(i) / 255.0f);
+    }
+
+    anton::Array<Image> levels;
+    Image const* src = &image;
+    while(src->width > 1 || src->height > 1) {
+      u32 const width = math::max(src->width / 2, 1u);
+      u32 const height = math::max(src->height / 2, 1u);
+      Image level(width, height, src->pixel_format, src->color_space,
+                  src->gamma, anton::Array<u8>(width * height * pixel_size));
+      downsample(*src, level, layout, linear_table);
+      levels.push_back(ANTON_MOV(level));
+      src = &levels[levels.size() - 1];
+    }
+    return levels;
+  }
+
+  bool is_compressible(Image_Pixel_Format const format)
+  {
+    return format == Image_Pixel_Format::grey8 ||
+           format == Image_Pixel_Format::grey8_alpha8 ||
+           format == Image_Pixel_Format::rgb8 ||
+           format == Image_Pixel_Format::rgba8;
+  }
+
+  bool is_compatible(Image_Pixel_Format const pixel_format,
+                     Block_Format const format)
+  {
+    switch(format) {
+    case Block_Format::bc1:
+      return pixel_format == Image_Pixel_Format::rgb8;
+    case Block_Format::bc3:
+    case Block_Format::bc7:
+      return pixel_format == Image_Pixel_Format::rgb8 ||
+             pixel_format == Image_Pixel_Format::rgba8;
+    case Block_Format::bc4:
+      return pixel_format == Image_Pixel_Format::grey8;
+    case Block_Format::bc5:
+      return pixel_format == Image_Pixel_Format::grey8_alpha8;
+    }
+    ANTON_UNREACHABLE();
+  }
+
+  // Encode 16 values as a BC4 block of 8 bytes.
+  static void encode_bc4_block(u8 const (&values)[16], u8* const block)
+  {
+    u8 max = values[0];
+    u8 min = values[0];
+    for(u8 const value: values) {
+      max = math::max(max, value);
+      min = math::min(min, value);
+    }
+
+    // With red0 > red1 the block interpolates 6 values between the endpoints.
+    // Otherwise all values are equal and index 0 selects red0.
+    i32 palette[8] = {max, min};
+    for(i32 i = 1; i < 7; ++i) {
+      palette[i + 1] = ((7 - i) * max + i * min + 3) / 7;
+    }
+
+    u64 indices = 0;
+    if(max != min) {
+      for(i32 i = 0; i < 16; ++i) {
+        i32 best_index = 0;
+        i32 best_error = 256;
+        for(i32 j = 0; j < 8; ++j) {
+          i32 const error = math::abs(palette[j] - values[i]);
+          if(error < best_error) {
+            best_index = j;
+            best_error = error;
+          }
+        }
+        indices |= static_cast<u64>(best_index) << (3 * i);
+      }
+    }
+
+    block[0] = max;
+    block[1] = min;
+    for(i32 i = 0; i < 6; ++i) {
+      block[i + 2] = indices >> (8 * i);
+    }
+  }
+
+  // Interpolation weights of 4 bit BC7 indices.
+  constexpr i32 bc7_weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                   34, 38, 43, 47, 51, 55, 60, 64};
+
+  // Write count low bits of value to block starting at bit position.
+  static void write_bits(u8* const block, i32& position, u32 const value,
+                         i32 const count)
+  {
+    for(i32 i = 0; i < count; ++i, ++position) {
+      if((value >> i) & 1) {
+        block[position >> 3] |= 1 << (position & 7);
+      }
+    }
+  }
+
+  // Quantize endpoint to 7 bits per channel and a p-bit shared by
+  // all channels choosing the p-bit with the smaller error.
+  // Fully opaque and fully transparent endpoints are kept exact.
+  static void quantize_bc7_endpoint(f32 const (&endpoint)[4],
+                                    u8 (&quantized)[4], u8& p_bit)
+  {
+    u8 const first_p = endpoint[3] == 255.0f ? 1 : 0;
+    u8 const last_p = endpoint[3] == 0.0f ? 0 : 1;
+    f32 best_error = math::infinity;
+    for(u8 p = first_p; p <= last_p; ++p) {
+      u8 candidate[4];
+      f32 error = 0.0f;
+      for(i32 c = 0; c < 4; ++c) {
+        f32 const q = math::floor((endpoint[c] - p) * 0.5f + 0.5f);
+        candidate[c] = static_cast<u8>(math::min(math::max(q, 0.0f), 127.0f));
+        f32 const difference =
+          static_cast<f32>((candidate[c] << 1) | p) - endpoint[c];
+        error += difference * difference;
+      }
+
+      if(error < best_error) {
+        best_error = error;
+        p_bit = p;
+        for(i32 c = 0; c < 4; ++c) {
+          quantized[c] = candidate[c];
+        }
+      }
+    }
+  }
+
+  // Fit a line segment through the pixels along their principal axis.
+  // channels - number of leading channels of the pixels to fit.
+  // endpoints - the ends of the segment clamped to [0, 255].
+  static void fit_endpoints(u8 const (&pixels)[16][4], i32 const channels,
+                            f32 (&endpoints)[2][4])
+  {
+    f32 mean[4] = {};
+    for(u8 const(&pixel)[4]: pixels) {
+      for(i32 c = 0; c < channels; ++c) {
+        mean[c] += pixel[c];
+      }
+    }
+    for(f32& value: mean) {
+      value /= 16.0f;
+    }
+
+    f32 covariance[4][4] = {};
+    for(u8 const(&pixel)[4]: pixels) {
+      for(i32 i = 0; i < channels; ++i) {
+        for(i32 j = 0; j < channels; ++j) {
+          covariance[i][j] += (pixel[i] - mean[i]) * (pixel[j] - mean[j]);
+        }
+      }
+    }
+
+    // Power iteration converges to the principal axis.
+    f32 axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for(i32 iteration = 0; iteration < 8; ++iteration) {
+      f32 next[4] = {};
+      f32 largest = 0.0f;
+      for(i32 i = 0; i < channels; ++i) {
+        for(i32 j = 0; j < channels; ++j) {
+          next[i] += covariance[i][j] * axis[j];
+        }
+        largest = math::max(largest, math::abs(next[i]));
+      }
+
+      if(largest == 0.0f) {
+        break;
+      }
+
+      for(i32 i = 0; i < channels; ++i) {
+        axis[i] = next[i] / largest;
+      }
+    }
+
+    f32 length_squared = 0.0f;
+    for(i32 c = 0; c < channels; ++c) {
+      length_squared += axis[c] * axis[c];
+    }
+
+    f32 min_t = 0.0f;
+    f32 max_t = 0.0f;
+    for(u8 const(&pixel)[4]: pixels) {
+      f32 t = 0.0f;
+      for(i32 c = 0; c < channels; ++c) {
+        t += (pixel[c] - mean[c]) * axis[c];
+      }
+      t /= length_squared;
+      min_t = math::min(min_t, t);
+      max_t = math::max(max_t, t);
+    }
+
+    for(i32 c = 0; c < channels; ++c) {
+      endpoints[0][c] =
+        math::min(math::max(mean[c] + axis[c] * min_t, 0.0f), 255.0f);
+      endpoints[1][c] =
+        math::min(math::max(mean[c] + axis[c] * max_t, 0.0f), 255.0f);
+    }
+  }
+
+  // Quantize the color channels of endpoint to 5, 6 and 5 bits.
+  [[nodiscard]] static u16 to_rgb565(f32 const (&endpoint)[4])
+  {
+    u16 const r = math::floor(endpoint[0] * (31.0f / 255.0f) + 0.5f);
+    u16 const g = math::floor(endpoint[1] * (63.0f / 255.0f) + 0.5f);
+    u16 const b = math::floor(endpoint[2] * (31.0f / 255.0f) + 0.5f);
+    return (r << 11) | (g << 5) | b;
+  }
+
+  // Encode the color of 16 pixels as a BC1 block of 8 bytes. The block uses
+  // the 4 color mode, which is also the only mode of the color block of BC3.
+  static void encode_bc1_block(u8 const (&pixels)[16][4], u8* const block)
+  {
+    f32 endpoints[2][4];
+    fit_endpoints(pixels, 3, endpoints);
+    // The 4 color mode requires color0 > color1.
+    u16 colors[2] = {to_rgb565(endpoints[1]), to_rgb565(endpoints[0])};
+    if(colors[0] < colors[1]) {
+      anton::swap(colors[0], colors[1]);
+    }
+
+    i32 palette[4][3];
+    for(i32 i = 0; i < 2; ++i) {
+      i32 const r = colors[i] >> 11;
+      i32 const g = (colors[i] >> 5) & 63;
+      i32 const b = colors[i] & 31;
+      palette[i][0] = (r << 3) | (r >> 2);
+      palette[i][1] = (g << 2) | (g >> 4);
+      palette[i][2] = (b << 3) | (b >> 2);
+    }
+    for(i32 c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    }
+
+    // Equal colors select the 3 color mode, in which index 0 is color0.
+    u32 indices = 0;
+    if(colors[0] != colors[1]) {
+      for(i32 i = 0; i < 16; ++i) {
+        u32 best_index = 0;
+        i32 best_error = 0x7FFFFFFF;
+        for(u32 j = 0; j < 4; ++j) {
+          i32 error = 0;
+          for(i32 c = 0; c < 3; ++c) {
+            i32 const difference = palette[j][c] - pixels[i][c];
+            error += difference * difference;
+          }
+
+          if(error < best_error) {
+            best_error = error;
+            best_index = j;
+          }
+        }
+        indices |= best_index << (2 * i);
+      }
+    }
+
+    block[0] = colors[0];
+    block[1] = colors[0] >> 8;
+    block[2] = colors[1];
+    block[3] = colors[1] >> 8;
+    for(i32 i = 0; i < 4; ++i) {
+      block[i + 4] = indices >> (8 * i);
+    }
+  }
+
+  // Encode 16 RGBA pixels as a BC7 mode 6 block of 16 bytes. Mode 6 uses
+  // a single line segment in RGBA space, which we fit along the principal
+  // axis of the pixels.
+  static void encode_bc7_block(u8 const (&pixels)[16][4], u8* const block)
+  {
+    f32 endpoints[2][4];
+    fit_endpoints(pixels, 4, endpoints);
+
+    u8 quantized[2][4];
+    u8 p_bits[2];
+    quantize_bc7_endpoint(endpoints[0], quantized[0], p_bits[0]);
+    quantize_bc7_endpoint(endpoints[1], quantized[1], p_bits[1]);
+
+    i32 palette[16][4];
+    for(i32 i = 0; i < 16; ++i) {
+      for(i32 c = 0; c < 4; ++c) {
+        i32 const e0 = (quantized[0][c] << 1) | p_bits[0];
+        i32 const e1 = (quantized[1][c] << 1) | p_bits[1];
+        palette[i][c] =
+          ((64 - bc7_weights[i]) * e0 + bc7_weights[i] * e1 + 32) >> 6;
+      }
+    }
+
+    u8 indices[16];
+    for(i32 i = 0; i < 16; ++i) {
+      i32 best_error = 0x7FFFFFFF;
+      for(i32 j = 0; j < 16; ++j) {
+        i32 error = 0;
+        for(i32 c = 0; c < 4; ++c) {
+          i32 const difference = palette[j][c] - pixels[i][c];
+          error += difference * difference;
+        }
+
+        if(error < best_error) {
+          best_error = error;
+          indices[i] = j;
+        }
+      }
+    }
+
+    // The most significant bit of the first index is implicitly 0.
+    // Swap the endpoints to make it so.
+    if(indices[0] & 8) {
+      for(i32 c = 0; c < 4; ++c) {
+        anton::swap(quantized[0][c], quantized[1][c]);
+      }
+      anton::swap(p_bits[0], p_bits[1]);
+      for(u8& index: indices) {
+        index = 15 - index;
+      }
+    }
+
+    for(i32 i = 0; i < 16; ++i) {
+      block[i] = 0;
+    }
+
+    i32 position = 0;
+    write_bits(block, position, 1 << 6, 7);
+    for(i32 c = 0; c < 4; ++c) {
+      write_bits(block, position, quantized[0][c], 7);
+      write_bits(block, position, quantized[1][c], 7);
+    }
+    write_bits(block, position, p_bits[0], 1);
+    write_bits(block, position, p_bits[1], 1);
+    write_bits(block, position, indices[0], 3);
+    for(i32 i = 1; i < 16; ++i) {
+      write_bits(block, position, indices[i], 4);
+    }
+  }
+
+  // Number of rows of blocks encoded by a single job.
+  constexpr i64 compress_grain = 4;
+
+  anton::Array<u8> compress_image(Image const& image,
+                                  Block_Format const format)
+  {
+    ANTON_ASSERT(is_compatible(image.pixel_format, format),
+                 "image format is not compatible with the block format");
+    i64 const width = image.width;
+    i64 const height = image.height;
+    i64 const pixel_size = get_sample_layout(image.pixel_format).channels;
+    i64 const blocks_x = (width + 3) / 4;
+    i64 const blocks_y = (height + 3) / 4;
+    i64 const block_size =
+      format == Block_Format::bc1 || format == Block_Format::bc4 ? 8 : 16;
+    anton::Array<u8> blocks(blocks_x * blocks_y * block_size);
+    parallel_for(blocks_y, compress_grain, [&](i64 const first,
+                                               i64 const last) {
+      for(i64 block_y = first; block_y < last; ++block_y) {
+        for(i64 block_x = 0; block_x < blocks_x; ++block_x) {
+          // Partial blocks at the edges repeat the last row or column.
+          u8 pixels[16][4];
+          for(i64 i = 0; i < 16; ++i) {
+            i64 const x = math::min(block_x * 4 + i % 4, width - 1);
+            i64 const y = math::min(block_y * 4 + i / 4, height - 1);
+            u8 const* const pixel =
+              image.data.data() + (y * width + x) * pixel_size;
+            pixels[i][3] = 255;
+            for(i64 c = 0; c < pixel_size; ++c) {
+              pixels[i][c] = pixel[c];
+            }
+          }
+
+          u8* const out =
+            blocks.data() + (block_y * blocks_x + block_x) * block_size;
+          switch(format) {
+          case Block_Format::bc1:
+            encode_bc1_block(pixels, out);
+            break;
+          case Block_Format::bc3: {
+            u8 alpha[16];
+            for(i64 i = 0; i < 16; ++i) {
+              alpha[i] = pixels[i][3];
+            }
+            encode_bc4_block(alpha, out);
+            encode_bc1_block(pixels, out + 8);
+          } break;
+          case Block_Format::bc4:
+          case Block_Format::bc5:
+            // BC5 is a BC4 block for red followed by a BC4 block for green.
+            for(i64 c = 0; c < pixel_size; ++c) {
+              u8 values[16];
+              for(i64 i = 0; i < 16; ++i) {
+                values[i] = pixels[i][c];
+              }
+              encode_bc4_block(values, out + 8 * c);
+            }
+            break;
+          case Block_Format::bc7:
+            encode_bc7_block(pixels, out);
+            break;
+          }
+        }
+      }
+    });
+    return blocks;
+  }
+} // namespace anton_engine::asset_importing
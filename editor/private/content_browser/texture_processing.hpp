@@ -0,0 +1,44 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <content_browser/importers/image.hpp>
+#include <core/types.hpp>
+
+namespace anton_engine::asset_importing {
+  enum class Block_Format {
+    // Opaque RGB in 8 bytes per block.
+    bc1,
+    // A BC4 alpha block followed by a BC1 color block, 16 bytes per block.
+    bc3,
+    // Single channel in 8 bytes per block.
+    bc4,
+    // Two BC4 blocks, 16 bytes per block.
+    bc5,
+    // RGBA in 16 bytes per block.
+    bc7,
+  };
+
+  // Generate the full mip chain of image down to 1x1. Every pixel of a level
+  // is the average of the pixels of the larger level that it covers. Even
+  // dimensions average 2 pixels and odd dimensions weigh 3 pixels, so that
+  // the last row and column contribute too.
+  // Color channels of rgb8 and rgba8 images are sRGB encoded and are averaged
+  // in linear space.
+  // Returns: Levels below the base level from the largest to 1x1.
+  [[nodiscard]] anton::Array<importers::Image>
+  generate_mipmaps(importers::Image const& image);
+
+  // Returns: Whether images of the format may be block compressed.
+  [[nodiscard]] bool is_compressible(importers::Image_Pixel_Format);
+
+  // grey8 may be encoded as BC4, grey8_alpha8 as BC5, rgb8 as BC1, BC3 or
+  // BC7 and rgba8 as BC3 or BC7.
+  // Returns: Whether images of the pixel format may be encoded in the block
+  //          format.
+  [[nodiscard]] bool is_compatible(importers::Image_Pixel_Format, Block_Format);
+
+  // Encode image in 4x4 blocks of format.
+  // Returns: Blocks in row major order.
+  [[nodiscard]] anton::Array<u8> compress_image(importers::Image const& image,
+                                                Block_Format format);
+} // namespace anton_engine::asset_importing
@@ -9,6 +9,7 @@
 #include <engine/components/entity_name.hpp>
 #include <engine/components/transform.hpp>
 #include <engine/ecs/ecs.hpp>
+#include <engine/ecs/jobs_management.hpp>
 #include <engine/input.hpp>
 #include <engine/input/input_internal.hpp>
 #include <engine/material.hpp>
@@ -79,6 +80,7 @@ namespace anton_engine {
     update_time();
     windowing::poll_events();
     input::process_events();
+    rendering::begin_frame();
 
     // printf("frame_start_time: %f, frame_start: %.9f\n", get_frame_start_time(), get_time());
 
@@ -236,6 +238,7 @@ namespace anton_engine {
       glDisable(GL_BLEND);
       glEnable(GL_DEPTH_TEST);
     }
+    rendering::end_frame();
 
     ecs->remove_requested_entities();
 
@@ -305,6 +308,7 @@ namespace anton_engine {
   static void init()
   {
     init_time();
+    init_jobs();
     if(!windowing::init()) {
       throw Exception("Windowing could not be initialized.");
     }
@@ -401,6 +405,7 @@ namespace anton_engine {
     serialization::Binary_Output_Archive out_archive(file);
     serialize(out_archive, Engine::get_ecs());
 #endif
+    terminate_jobs();
     rendering::terminate_font_rendering();
     windowing::terminate();
   }
@@ -526,10 +531,10 @@ namespace anton_engine {
     {
       anton::Array<u8> pixels;
       Texture_Format const format =
-        assets::load_texture_no_mipmaps("barrel_texture", 0, pixels);
+        assets::load_texture("barrel_texture", 0, pixels);
       Texture handle;
       void* pix_data = pixels.data();
-      rendering::load_textures_generate_mipmaps(format, 1, &pix_data, &handle);
+      rendering::load_textures(format, 1, &pix_data, &handle);
       barrel_mat.diffuse_texture = handle;
       barrel_mat.specular_texture = Texture::default_black;
       barrel_mat.normal_map = Texture::default_normal_map;
@@ -547,6 +552,11 @@ namespace anton_engine {
     Handle<Mesh> boxes1_mesh = mesh_manager->add(ANTON_MOV(boxes1_mesh_0));
     Handle<Mesh> boxes2_mesh = mesh_manager->add(ANTON_MOV(boxes1_mesh_1));
     Handle<Mesh> boxes3_mesh = mesh_manager->add(ANTON_MOV(boxes1_mesh_2));
+    Handle<Mesh> const loaded_meshes[] = {box_handle, quad_mesh, boxes1_mesh,
+                                          boxes2_mesh, boxes3_mesh};
+    for(Handle<Mesh> const handle: loaded_meshes) {
+      rendering::make_mesh_resident(handle, mesh_manager->get(handle));
+    }
 
 #if DESERIALIZE
     std::filesystem::path serialization_in_path =
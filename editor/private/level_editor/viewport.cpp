@@ -1,6 +1,7 @@
 #include <level_editor/viewport.hpp>
 
 #include <anton/array.hpp>
+#include <anton/flat_hash_map.hpp>
 #include <anton/math/transform.hpp>
 #include <anton/math/vec2.hpp>
 #include <anton/utility.hpp>
@@ -11,6 +12,7 @@
 #include <engine/components/camera.hpp>
 #include <engine/components/static_mesh_component.hpp>
 #include <engine/components/transform.hpp>
+#include <engine/components/world_matrix.hpp>
 #include <engine/ecs/ecs.hpp>
 #include <engine/input.hpp>
 #include <engine/input/input_internal.hpp>
@@ -21,6 +23,7 @@
 #include <level_editor/gizmo/dial_3d.hpp>
 #include <level_editor/gizmo/gizmo.hpp>
 #include <level_editor/viewport_camera.hpp>
+#include <physics/bvh.hpp>
 #include <physics/intersection_tests.hpp>
 #include <physics/line.hpp>
 #include <physics/obb.hpp>
@@ -137,28 +140,72 @@ namespace anton_engine {
     return is_active;
   }
 
+  // Hierarchies of the triangles of meshes in model space keyed by the values
+  // of the mesh handles. Built the first time a mesh is picked.
+  static anton::Flat_Hash_Map<u64, BVH> mesh_bvhs;
+  static World_Matrix_Cache world_matrix_cache;
+
   static Entity pick_object(Ray const ray)
   {
     // gizmo::draw_line(ray.origin, ray.origin + 20 * ray.direction, Color::green, 200.0f);
 
     ECS& ecs = Editor::get_ecs();
     Resource_Manager<Mesh>& mesh_manager = Editor::get_mesh_manager();
-    Component_View access = ecs.view<Static_Mesh_Component, Transform>();
-    Entity selected = null_entity;
-    Raycast_Hit closest_hit;
-    closest_hit.distance = math::infinity;
+    update_world_matrices(ecs, world_matrix_cache);
+    Component_View access = ecs.view<Static_Mesh_Component, World_Matrix>();
     for(Entity const entity: access) {
-      auto const& [c, transform] =
-        access.get<Static_Mesh_Component, Transform>(entity);
-      Mesh const& mesh = mesh_manager.get(c.mesh_handle);
-      if(auto hit = intersect_ray_mesh(ray, mesh, transform.to_matrix());
-         hit && hit->distance < closest_hit.distance) {
-        // gizmo::draw_point(hit.hit_point, 0.05, Color::red, 200.0f);
-        closest_hit = hit.value();
-        selected = entity;
+      Static_Mesh_Component const& c = access.get<Static_Mesh_Component>(entity);
+      if(mesh_bvhs.find(c.mesh_handle.value) == mesh_bvhs.end()) {
+        mesh_bvhs.emplace(c.mesh_handle.value,
+                          build_mesh_bvh(mesh_manager.get(c.mesh_handle)));
       }
     }
 
+    // Pointers into mesh_bvhs are taken after all insertions, so that they are
+    // not invalidated by rehashing.
+    struct Pick_Object {
+      Entity entity;
+      Mat4 matrix;
+      Mesh const* mesh;
+      BVH const* bvh;
+    };
+
+    anton::Array<Pick_Object> objects{anton::reserve, access.size()};
+    anton::Array<AABB> bounds{anton::reserve, access.size()};
+    for(Entity const entity: access) {
+      auto const& [c, world_matrix] =
+        access.get<Static_Mesh_Component, World_Matrix>(entity);
+      BVH const& bvh = mesh_bvhs.find(c.mesh_handle.value)->value;
+      Mat4 const matrix = world_matrix.matrix;
+      objects.push_back(
+        Pick_Object{entity, matrix, &mesh_manager.get(c.mesh_handle), &bvh});
+      bounds.push_back(transform_aabb(bvh.get_bounds(), matrix));
+    }
+
+    // Entities move between picks, so the scene hierarchy is rebuilt for every
+    // query. Building it is much cheaper than testing the triangles.
+    BVH scene_bvh;
+    scene_bvh.build(bounds);
+    Entity selected = null_entity;
+    scene_bvh.raycast(
+      ray, math::infinity,
+      [&ray, &objects, &selected](i32 const index,
+                                  f32 const max_distance) -> f32 {
+        Pick_Object const& object = objects[index];
+        // Test the mesh in model space. The direction is not normalized, so
+        // distances along the model space ray match the world space ones.
+        Mat4 const inv_matrix = math::inverse(object.matrix);
+        Ray const model_ray = {Vec3(inv_matrix * Vec4(ray.origin, 1.0f)),
+                               Vec3(inv_matrix * Vec4(ray.direction, 0.0f))};
+        if(auto hit = intersect_ray_mesh(model_ray, *object.mesh, *object.bvh);
+           hit && hit->distance < max_distance) {
+          // gizmo::draw_point(hit.hit_point, 0.05, Color::red, 200.0f);
+          selected = object.entity;
+          return hit->distance;
+        }
+        return math::infinity;
+      });
+
     return selected;
   }
 
@@ -413,6 +460,7 @@ namespace anton_engine {
             //}
             transform_ref.local_position =
               gizmo_ctx.grab.cached_transform.local_position + delta_position;
+            transform_ref.dirty = true;
           } break;
           case Gizmo_Transform_Type::rotate: {
           } break;
@@ -431,6 +479,7 @@ namespace anton_engine {
             //}
             transform_ref.local_scale =
               gizmo_ctx.grab.cached_transform.local_scale + delta_position;
+            transform_ref.dirty = true;
           } break;
           }
         }
@@ -752,8 +801,8 @@ namespace anton_engine {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     ECS& ecs = Editor::get_ecs();
-    ECS snapshot = ecs.snapshot<Transform, Static_Mesh_Component>();
-    rendering::render_scene(snapshot, camera_transform, view_mat, proj_mat);
+    rendering::Render_Scene& scene = rendering::extract_scene(ecs);
+    rendering::render_scene(scene, camera_transform, view_mat, proj_mat);
 
     bind_framebuffer(multisampled_framebuffer);
     glClear(GL_DEPTH_BUFFER_BIT);
@@ -13,7 +13,26 @@ namespace anton_engine::asset_importing {
     anton::Array<Mesh> meshes;
   };
 
-  void import_image(anton::String_View path);
+  enum class Texture_Compression {
+    // Store the pixels as they are.
+    none,
+    // Encode color textures as BC7.
+    bc7,
+    // Encode opaque color textures as BC1 and the rest as BC3. Half the size
+    // of BC7 for opaque textures at a lower quality.
+    bc1_bc3,
+  };
+
+  class Texture_Import_Options {
+  public:
+    // Block compression of color textures. Unless it is none, grey textures
+    // are encoded as BC4 and grey textures with alpha as BC5. Textures with
+    // 16 bit samples are never compressed.
+    Texture_Compression compression = Texture_Compression::bc7;
+  };
+
+  void import_image(anton::String_View path,
+                    Texture_Import_Options const& options = {});
   Imported_Meshes import_mesh(anton::String_View path);
 
   void save_meshes(anton::String_View filename, anton::Slice<u64 const> guids,
@@ -0,0 +1,193 @@
+#include <engine/asset_pack.hpp>
+
+#include <anton/string.hpp>
+#include <core/exception.hpp>
+
+#if defined(_WIN32) || defined(_WIN64)
+  #define WIN32_LEAN_AND_MEAN
+  #include <Windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace anton_engine {
+#if defined(_WIN32) || defined(_WIN64)
+
+  // Returns: Address of the mapped file or nullptr if the file could not be
+  //          opened.
+  static u8 const* map_file(anton::String const& path, i64& size)
+  {
+    HANDLE const file = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ,
+                                    nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+      return nullptr;
+    }
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+      CloseHandle(file);
+      throw Exception(u8"Could not map the asset pack " + path);
+    }
+
+    HANDLE const mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    // The view keeps the file mapped after the handles have been closed.
+    void* const view =
+      mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(mapping) {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if(!view) {
+      throw Exception(u8"Could not map the asset pack " + path);
+    }
+
+    size = file_size.QuadPart;
+    return static_cast<u8 const*>(view);
+  }
+
+  static void unmap_file(u8 const* const data, i64)
+  {
+    UnmapViewOfFile(data);
+  }
+
+#else
+
+  // Returns: Address of the mapped file or nullptr if the file could not be
+  //          opened.
+  static u8 const* map_file(anton::String const& path, i64& size)
+  {
+    int const file = ::open(path.data(), O_RDONLY);
+    if(file == -1) {
+      return nullptr;
+    }
+
+    struct stat file_stat;
+    if(fstat(file, &file_stat) == -1 || file_stat.st_size == 0) {
+      ::close(file);
+      throw Exception(u8"Could not map the asset pack " + path);
+    }
+
+    // The mapping keeps the file open after the descriptor has been closed.
+    void* const mapping =
+      mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if(mapping == MAP_FAILED) {
+      throw Exception(u8"Could not map the asset pack " + path);
+    }
+
+    size = file_stat.st_size;
+    return static_cast<u8 const*>(mapping);
+  }
+
+  static void unmap_file(u8 const* const data, i64 const size)
+  {
+    munmap(const_cast<u8*>(data), size);
+  }
+
+#endif
+
+  [[nodiscard]] static bool operator<(Asset_Pack_Entry const& entry,
+                                      Asset_Pack_Entry const& key)
+  {
+    if(entry.type != key.type) {
+      return entry.type < key.type;
+    }
+
+    if(entry.name_hash != key.name_hash) {
+      return entry.name_hash < key.name_hash;
+    }
+
+    return entry.guid < key.guid;
+  }
+
+  Asset_Pack::~Asset_Pack()
+  {
+    close();
+  }
+
+  bool Asset_Pack::open(anton::String_View const path)
+  {
+    close();
+    anton::String const path_str{path};
+    i64 file_size = 0;
+    u8 const* const file_data = map_file(path_str, file_size);
+    if(!file_data) {
+      return false;
+    }
+
+    // The mapping is page aligned and the header is 16 bytes, so the header
+    // and the entries are suitably aligned to be accessed in place.
+    auto const header = reinterpret_cast<Asset_Pack_Header const*>(file_data);
+    bool valid = file_size >= static_cast<i64>(sizeof(Asset_Pack_Header));
+    if(valid) {
+      u64 const max_entries =
+        (file_size - sizeof(Asset_Pack_Header)) / sizeof(Asset_Pack_Entry);
+      valid = header->magic == asset_pack_magic &&
+              header->entry_count <= max_entries;
+    }
+
+    if(!valid) {
+      unmap_file(file_data, file_size);
+      throw Exception(u8"Invalid asset pack " + path_str);
+    }
+
+    data = file_data;
+    size = file_size;
+    entries = reinterpret_cast<Asset_Pack_Entry const*>(header + 1);
+    entry_count = header->entry_count;
+    return true;
+  }
+
+  void Asset_Pack::close()
+  {
+    if(data) {
+      unmap_file(data, size);
+    }
+
+    data = nullptr;
+    size = 0;
+    entries = nullptr;
+    entry_count = 0;
+  }
+
+  bool Asset_Pack::is_open() const
+  {
+    return data != nullptr;
+  }
+
+  anton::Slice<u8 const> Asset_Pack::find(Asset_Type const type,
+                                          u64 const name_hash,
+                                          u64 const guid) const
+  {
+    Asset_Pack_Entry const key{type, 0, name_hash, guid, 0, 0};
+    // Binary search for the first entry that is not less than key.
+    i64 first = 0;
+    i64 count = entry_count;
+    while(count > 0) {
+      i64 const step = count / 2;
+      if(entries[first + step] < key) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+
+    if(first == entry_count || key < entries[first]) {
+      return {};
+    }
+
+    Asset_Pack_Entry const& entry = entries[first];
+    if(entry.offset > static_cast<u64>(size) ||
+       entry.size > static_cast<u64>(size) - entry.offset) {
+      throw Exception(u8"Asset pack entry is out of bounds");
+    }
+
+    return {data + entry.offset, static_cast<i64>(entry.size)};
+  }
+} // namespace anton_engine
@@ -8,25 +8,41 @@
 #include <core/exception.hpp>
 #include <core/paths.hpp>
 #include <core/types.hpp>
+#include <engine/asset_pack.hpp>
 #include <engine/mesh.hpp>
 #include <rendering/opengl.hpp>
 #include <rendering/texture_format.hpp>
 #include <shaders/shader.hpp>
 
 namespace anton_engine::assets {
+  static Asset_Pack asset_pack;
+
+  bool mount_asset_pack(anton::String_View const path)
+  {
+    return asset_pack.open(path);
+  }
+
+  void unmount_asset_pack()
+  {
+    asset_pack.close();
+  }
+
   anton::String read_file_raw_string(anton::String_View const path)
   {
-    FILE* const file = fopen(path.data(), "r");
+    FILE* const file = fopen(path.data(), "rb");
     if(!file) {
       anton::String error_msg{u8"Could not open file "};
       error_msg.append(path);
       throw Exception(error_msg);
     }
 
+    fseek(file, 0, SEEK_END);
+    i64 const size = ftell(file);
+    fseek(file, 0, SEEK_SET);
     anton::String out;
-    for(int c = fgetc(file); c != EOF; c = fgetc(file)) {
-      out.append((char8)c);
-    }
+    out.ensure_capacity_exact(size);
+    i64 const bytes_read = fread(out.data(), 1, size, file);
+    out.force_size(bytes_read);
     fclose(file);
     return out;
   }
@@ -99,11 +115,81 @@ namespace anton_engine::assets {
             static_cast<i64>(read_int32_le(stream)) << 32);
   }
 
+  // Checks whether mip_levels levels, each prefixed with its size, occupy
+  // data exactly.
+  static bool texture_levels_fit(anton::Slice<u8 const> const data,
+                                 i32 const mip_levels)
+  {
+    i64 offset = 0;
+    for(i32 level = 0; level < mip_levels; ++level) {
+      if(data.size() - offset < static_cast<i64>(sizeof(i64))) {
+        return false;
+      }
+
+      i64 level_size_bytes;
+      memcpy(&level_size_bytes, data.data() + offset, sizeof(i64));
+      offset += sizeof(i64);
+      if(level_size_bytes < 0 || level_size_bytes > data.size() - offset) {
+        return false;
+      }
+      offset += level_size_bytes;
+    }
+    return offset == data.size();
+  }
+
+  // Copy levels prefixed with their sizes into pixels one after another.
+  // Textures imported before mipmaps were stored contain only the base level
+  // even though format.mip_levels counts the full chain. Those are loaded
+  // without mipmaps and format.mip_levels is set to 1.
+  static void read_texture_levels(anton::Slice<u8 const> const data,
+                                  Texture_Format& format,
+                                  anton::Array<u8>& pixels)
+  {
+    if(format.mip_levels < 1 || !texture_levels_fit(data, format.mip_levels)) {
+      if(format.mip_levels > 1 && texture_levels_fit(data, 1)) {
+        format.mip_levels = 1;
+      } else {
+        throw Exception(u8"Corrupted texture data. Reimport the texture");
+      }
+    }
+
+    pixels.clear();
+    u8 const* level_data = data.data();
+    for(i32 level = 0; level < format.mip_levels; ++level) {
+      i64 level_size_bytes;
+      memcpy(&level_size_bytes, level_data, sizeof(i64));
+      level_data += sizeof(i64);
+      i64 const offset = pixels.size();
+      pixels.resize(offset + level_size_bytes);
+      memcpy(pixels.data() + offset, level_data, level_size_bytes);
+      level_data += level_size_bytes;
+    }
+  }
+
   // TODO extract writing and reading to one tu to keep them in sync
-  Texture_Format load_texture_no_mipmaps(anton::String_View const filename,
-                                         u64 const texture_id,
-                                         anton::Array<u8>& pixels)
+  Texture_Format load_texture(anton::String_View const filename,
+                              u64 const texture_id, anton::Array<u8>& pixels)
   {
+    if(asset_pack.is_open()) {
+      anton::Slice<u8 const> const texture =
+        asset_pack.find(Asset_Type::texture,
+                        hash_asset_name(filename.data(), filename.size_bytes()),
+                        texture_id);
+      if(texture.size() != 0) {
+        if(texture.size() < static_cast<i64>(sizeof(Texture_Format))) {
+          throw Exception(u8"Corrupted texture in the asset pack");
+        }
+
+        Texture_Format format;
+        memcpy(&format, texture.data(), sizeof(Texture_Format));
+        anton::Slice<u8 const> const levels(
+          texture.data() + sizeof(Texture_Format),
+          texture.data() + texture.size());
+        read_texture_levels(levels, format, pixels);
+        return format;
+      }
+    }
+
 #if !GE_BUILD_SHIPPING
     anton::String const filename_ext = anton::String(filename) + ".getex";
     anton::String const texture_path =
@@ -111,17 +197,29 @@ namespace anton_engine::assets {
     // TODO texture loading
     FILE* file = fopen(texture_path.data(), "rb");
     while(file && !feof(file)) {
-      [[maybe_unused]] i64 const texture_data_size = read_int64_le(file);
+      i64 const texture_data_size = read_int64_le(file);
       u64 const tex_id = read_uint64_le(file);
       if(tex_id == texture_id) {
         Texture_Format format;
         fread(reinterpret_cast<char*>(&format), sizeof(Texture_Format), 1,
               file);
-        i64 const texture_size_bytes = read_int64_le(file);
-        pixels.resize(texture_size_bytes);
-        fread(reinterpret_cast<char*>(pixels.data()), texture_size_bytes, 1,
-              file);
+        // The levels follow the format and fill the rest of the chunk.
+        i64 const levels_size =
+          texture_data_size - static_cast<i64>(sizeof(Texture_Format));
+        if(levels_size < 0) {
+          fclose(file);
+          throw Exception(u8"Invalid texture file " + texture_path);
+        }
+
+        anton::Array<u8> levels(levels_size);
+        i64 const bytes_read =
+          fread(reinterpret_cast<char*>(levels.data()), 1, levels_size, file);
         fclose(file);
+        if(bytes_read != levels_size) {
+          throw Exception(u8"Invalid texture file " + texture_path);
+        }
+
+        read_texture_levels(levels, format, pixels);
         return format;
       } else {
         // Since there's only one texture per file right now, we do not have to skip past it, but instead throw an exception
@@ -130,16 +228,59 @@ namespace anton_engine::assets {
     }
     throw Exception(u8"Invalid texture file");
 #else
-  #error "No implementation of load_texture_no_mipmaps for shipping build."
-// TODO shipping build texture loading
+    throw Exception(u8"Texture not found in the asset pack");
 #endif
   }
 
   Mesh load_mesh(anton::String_View const filename, u64 const guid)
   {
-    // TODO: Shipping build. Files will be packed.
     anton::String_View const filename_no_ext =
       anton::fs::remove_extension(filename);
+    if(asset_pack.is_open()) {
+      anton::Slice<u8 const> const mesh = asset_pack.find(
+        Asset_Type::mesh,
+        hash_asset_name(filename_no_ext.data(), filename_no_ext.size_bytes()),
+        guid);
+      if(mesh.size() != 0) {
+        // Counts are checked against the remaining bytes before the sizes are
+        // computed, so that corrupted counts cannot overflow.
+        u8 const* data = mesh.data();
+        i64 remaining = mesh.size();
+        if(remaining < static_cast<i64>(sizeof(i64))) {
+          throw Exception(u8"Corrupted mesh in the asset pack");
+        }
+
+        i64 vertex_count;
+        memcpy(&vertex_count, data, sizeof(i64));
+        data += sizeof(i64);
+        remaining -= sizeof(i64);
+        if(vertex_count < 0 ||
+           vertex_count > remaining / static_cast<i64>(sizeof(Vertex)) ||
+           remaining - vertex_count * static_cast<i64>(sizeof(Vertex)) <
+             static_cast<i64>(sizeof(i64))) {
+          throw Exception(u8"Corrupted mesh in the asset pack");
+        }
+
+        anton::Array<Vertex> vertices(vertex_count);
+        memcpy(vertices.data(), data, vertex_count * sizeof(Vertex));
+        data += vertex_count * sizeof(Vertex);
+        remaining -= vertex_count * sizeof(Vertex);
+        i64 index_count;
+        memcpy(&index_count, data, sizeof(i64));
+        data += sizeof(i64);
+        remaining -= sizeof(i64);
+        if(index_count < 0 ||
+           index_count > remaining / static_cast<i64>(sizeof(u32)) ||
+           index_count * static_cast<i64>(sizeof(u32)) != remaining) {
+          throw Exception(u8"Corrupted mesh in the asset pack");
+        }
+
+        anton::Array<u32> indices(index_count);
+        memcpy(indices.data(), data, index_count * sizeof(u32));
+        return {ANTON_MOV(vertices), ANTON_MOV(indices)};
+      }
+    }
+
     anton::String asset_path =
       anton::fs::concat_paths(paths::assets_directory(), filename_no_ext);
     asset_path.append(u8".mesh");
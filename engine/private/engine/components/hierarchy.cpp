@@ -0,0 +1,173 @@
+#include <engine/components/hierarchy.hpp>
+
+#include <core/exception.hpp>
+#include <engine/components/transform.hpp>
+#include <engine/ecs/ecs.hpp>
+
+namespace anton_engine {
+  void set_parent(ECS& ecs, Entity const child, Entity const parent)
+  {
+    Hierarchy* hierarchy = ecs.try_get_component<Hierarchy>(child);
+    if(hierarchy == nullptr) {
+      hierarchy = &ecs.add_component<Hierarchy>(child);
+    }
+
+    hierarchy->parent = parent;
+    if(Transform* const transform = ecs.try_get_component<Transform>(child)) {
+      transform->dirty = true;
+    }
+    ecs.mark_structure_changed();
+  }
+
+  void detach_orphans(ECS& ecs)
+  {
+    Entity const* const entities = ecs.entities<Hierarchy>();
+    Hierarchy* const hierarchies = ecs.components<Hierarchy>();
+    if(entities == nullptr) {
+      return;
+    }
+
+    i64 const count = ecs.view<Hierarchy>().size();
+    bool detached = false;
+    for(i64 i = 0; i < count; ++i) {
+      Entity const parent = hierarchies[i].parent;
+      if(parent == null_entity || ecs.is_alive(parent)) {
+        continue;
+      }
+
+      hierarchies[i].parent = null_entity;
+      detached = true;
+      if(Transform* const transform =
+           ecs.try_get_component<Transform>(entities[i])) {
+        transform->dirty = true;
+      }
+    }
+
+    if(detached) {
+      ecs.mark_structure_changed();
+    }
+  }
+
+  void build_hierarchy_levels(ECS& ecs, Hierarchy_Levels& levels)
+  {
+    levels.entities.clear();
+    levels.parents.clear();
+    levels.offsets.clear();
+    Entity const* const entities = ecs.entities<Hierarchy>();
+    Hierarchy const* const hierarchies = ecs.components<Hierarchy>();
+    if(entities == nullptr) {
+      return;
+    }
+
+    i64 const count = ecs.view<Hierarchy>().size();
+    // Positions of the parents in the Hierarchy container or -1 if the parent
+    // is a root.
+    anton::Array<i64>& parent_indices = levels.parent_indices;
+    parent_indices.resize(count);
+    for(i64 i = 0; i < count; ++i) {
+      parent_indices[i] = -1;
+      Entity const parent = hierarchies[i].parent;
+      if(parent == null_entity) {
+        continue;
+      }
+
+      Hierarchy const* const parent_hierarchy =
+        ecs.try_get_component<Hierarchy>(parent);
+      if(parent_hierarchy != nullptr &&
+         parent_hierarchy->parent != null_entity) {
+        parent_indices[i] = parent_hierarchy - hierarchies;
+      }
+    }
+
+    // Depth of the children of roots is 0 and roots themselves get -1.
+    // Every node is visited once by walking up until a node of known depth.
+    constexpr i64 unknown_depth = -2;
+    anton::Array<i64>& depths = levels.depths;
+    anton::Array<i64>& path = levels.path;
+    depths.resize(count);
+    for(i64 i = 0; i < count; ++i) {
+      depths[i] = unknown_depth;
+    }
+
+    i64 max_depth = -1;
+    for(i64 i = 0; i < count; ++i) {
+      path.clear();
+      i64 depth = -1;
+      for(i64 j = i;;) {
+        if(hierarchies[j].parent == null_entity) {
+          depths[j] = -1;
+          break;
+        }
+
+        if(depths[j] != unknown_depth) {
+          depth = depths[j];
+          break;
+        }
+
+        path.push_back(j);
+        if(path.size() > count) {
+          throw Exception(u8"Cycle in the entity hierarchy.");
+        }
+
+        if(parent_indices[j] == -1) {
+          break;
+        }
+
+        j = parent_indices[j];
+      }
+
+      for(i64 k = path.size() - 1; k >= 0; --k) {
+        depth += 1;
+        depths[path[k]] = depth;
+      }
+
+      if(depth > max_depth) {
+        max_depth = depth;
+      }
+    }
+
+    // Counting sort by depth. Nodes within a level keep the order of the
+    // container.
+    levels.offsets.resize(max_depth + 2);
+    for(i64& offset: levels.offsets) {
+      offset = 0;
+    }
+
+    for(i64 i = 0; i < count; ++i) {
+      if(depths[i] >= 0) {
+        levels.offsets[depths[i] + 1] += 1;
+      }
+    }
+
+    for(i64 level = 1; level < levels.offsets.size(); ++level) {
+      levels.offsets[level] += levels.offsets[level - 1];
+    }
+
+    anton::Array<i64>& cursors = levels.cursors;
+    anton::Array<i64>& positions = levels.positions;
+    cursors.resize(levels.offsets.size());
+    positions.resize(count);
+    for(i64 level = 0; level < levels.offsets.size(); ++level) {
+      cursors[level] = levels.offsets[level];
+    }
+
+    i64 const node_count = levels.offsets[levels.offsets.size() - 1];
+    levels.entities.resize(node_count);
+    levels.parents.resize(node_count);
+    for(i64 i = 0; i < count; ++i) {
+      if(depths[i] >= 0) {
+        i64 const position = cursors[depths[i]];
+        cursors[depths[i]] += 1;
+        positions[i] = position;
+        levels.entities[position] = entities[i];
+      }
+    }
+
+    for(i64 i = 0; i < count; ++i) {
+      if(depths[i] >= 0) {
+        levels.parents[positions[i]] =
+          parent_indices[i] != -1 ? positions[parent_indices[i]] : -1;
+      }
+    }
+  }
+} // namespace anton_engine
@@ -0,0 +1,135 @@
+#include <engine/components/world_matrix.hpp>
+
+#include <anton/array.hpp>
+#include <engine/components/hierarchy.hpp>
+#include <engine/components/transform.hpp>
+#include <engine/ecs/ecs.hpp>
+#include <engine/ecs/jobs.hpp>
+
+namespace anton_engine {
+  // Flatten the hierarchy and gather the components of its nodes.
+  // Adds World_Matrix to every node with a Transform, so that the gathered
+  // pointers stay valid until the structure of the ECS changes again.
+  static void rebuild_cache(ECS& ecs, World_Matrix_Cache& cache)
+  {
+    build_hierarchy_levels(ecs, cache.levels);
+    Hierarchy_Levels const& levels = cache.levels;
+    for(Entity const entity: levels.entities) {
+      if(ecs.has_component<Transform>(entity) &&
+         !ecs.has_component<World_Matrix>(entity)) {
+        ecs.add_component<World_Matrix>(entity);
+      }
+    }
+
+    cache.nodes.resize(levels.entities.size());
+    for(i64 i = 0; i < levels.entities.size(); ++i) {
+      Entity const entity = levels.entities[i];
+      Entity const parent = ecs.get_component<Hierarchy>(entity).parent;
+      Hierarchy_Node& node = cache.nodes[i];
+      node.transform = ecs.try_get_component<Transform>(entity);
+      node.world_matrix = ecs.try_get_component<World_Matrix>(entity);
+      node.parent_matrix = ecs.try_get_component<World_Matrix>(parent);
+      node.parent_transform = ecs.try_get_component<Transform>(parent);
+    }
+    cache.structure_version = ecs.get_structure_version();
+  }
+
+  void update_world_matrices(ECS& ecs, World_Matrix_Cache& cache)
+  {
+    Entity const* const entities = ecs.entities<Transform>();
+    Transform* const transforms = ecs.components<Transform>();
+    if(entities == nullptr) {
+      return;
+    }
+
+    // Children of destroyed entities become roots and must be recomputed.
+    // Destroying entities changes the structure version, so the hierarchy is
+    // searched for orphans only when the version changes.
+    if(cache.structure_version != ecs.get_structure_version()) {
+      detach_orphans(ecs);
+    }
+
+    anton::Array<Entity>& dirty = cache.dirty;
+    dirty.clear();
+    i64 const count = ecs.view<Transform>().size();
+    for(i64 i = 0; i < count; ++i) {
+      if(transforms[i].dirty) {
+        dirty.push_back(entities[i]);
+      }
+    }
+
+    // Nothing in the hierarchy may change without a dirty Transform.
+    if(dirty.size() == 0) {
+      return;
+    }
+
+    // Adding components may reorder containers owned by groups, so the
+    // entities are collected before any World_Matrix is added.
+    anton::Array<Entity>& dirty_roots = cache.dirty_roots;
+    dirty_roots.clear();
+    for(Entity const entity: dirty) {
+      if(!ecs.has_component<World_Matrix>(entity)) {
+        ecs.add_component<World_Matrix>(entity);
+      }
+
+      if(!ecs.has_component<Hierarchy>(entity) ||
+         ecs.get_component<Hierarchy>(entity).parent == null_entity) {
+        dirty_roots.push_back(entity);
+      }
+    }
+
+    if(cache.structure_version != ecs.get_structure_version()) {
+      rebuild_cache(ecs, cache);
+    }
+
+    // The dirty flags of roots are cleared after the levels, because the
+    // children of roots read them.
+    auto view = ecs.view<Transform, World_Matrix>();
+    parallel_for(dirty_roots.size(), 256,
+                 [&view, &dirty_roots](i64 const first, i64 const last) {
+                   for(i64 i = first; i < last; ++i) {
+                     auto [transform, world_matrix] =
+                       view.get<Transform, World_Matrix>(dirty_roots[i]);
+                     world_matrix.matrix = to_matrix(transform);
+                   }
+                 });
+
+    // Levels are processed in order, since every node depends on its parent.
+    // Nodes within a level are independent and stored contiguously.
+    Hierarchy_Levels const& levels = cache.levels;
+    Hierarchy_Node const* const nodes = cache.nodes.data();
+    anton::Array<u8>& changed = cache.changed;
+    changed.resize(levels.entities.size());
+    for(i64 level = 0; level + 1 < levels.offsets.size(); ++level) {
+      i64 const level_first = levels.offsets[level];
+      i64 const level_size = levels.offsets[level + 1] - level_first;
+      parallel_for(level_size, 256, [level_first, &levels, nodes, &changed](
+                                      i64 const first, i64 const last) {
+        for(i64 i = level_first + first; i < level_first + last; ++i) {
+          Hierarchy_Node const& node = nodes[i];
+          if(node.transform == nullptr) {
+            changed[i] = false;
+            continue;
+          }
+
+          i64 const parent = levels.parents[i];
+          Transform const* const parent_transform = node.parent_transform;
+          bool const parent_changed =
+            parent != -1 ? changed[parent]
+                         : parent_transform && parent_transform->dirty;
+          changed[i] = node.transform->dirty || parent_changed;
+          if(changed[i]) {
+            Mat4 const local = to_matrix(*node.transform);
+            node.world_matrix->matrix =
+              node.parent_matrix ? local * node.parent_matrix->matrix : local;
+            node.transform->dirty = false;
+          }
+        }
+      });
+    }
+
+    for(Entity const entity: dirty_roots) {
+      view.get<Transform>(entity).dirty = false;
+    }
+  }
+} // namespace anton_engine
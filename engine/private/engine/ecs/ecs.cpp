@@ -4,6 +4,9 @@
 #include <anton/memory.hpp>
 #include <engine/ecs/component_serialization.hpp>
 
+#include <atomic>
+#include <mutex>
+
 #if ANTON_WITH_EDITOR
   #include <editor.hpp>
 #else
@@ -11,6 +14,27 @@
 #endif // ANTON_WITH_EDITOR
 
 namespace anton_engine {
+  i64 get_component_type_index(u64 const type_identifier)
+  {
+    static std::mutex mutex;
+    static anton::Array<u64> type_identifiers;
+    std::lock_guard<std::mutex> lock(mutex);
+    for(i64 i = 0; i < type_identifiers.size(); ++i) {
+      if(type_identifiers[i] == type_identifier) {
+        return i;
+      }
+    }
+
+    type_identifiers.push_back(type_identifier);
+    return type_identifiers.size() - 1;
+  }
+
+  u64 next_structure_version()
+  {
+    static std::atomic<u64> next_version{0};
+    return next_version.fetch_add(1, std::memory_order_relaxed);
+  }
+
   ECS::~ECS()
   {
     for(auto& container_data: containers) {
@@ -21,8 +45,118 @@ namespace anton_engine {
 
   Entity ECS::create()
   {
-    // TODO: More clever entity creation (generations and reusing ids)
-    return _entities.emplace_back(id_generator.next());
+    ANTON_ASSERT(!structure_locked, "Cannot create entities while the "
+                                    "structure of the ECS is locked");
+    u64 index;
+    if(free_indices.size() > 0) {
+      index = free_indices[free_indices.size() - 1];
+      free_indices.pop_back();
+    } else {
+      index = generations.size();
+      generations.push_back(0);
+    }
+
+    u64 const generation = generations[index];
+    return _entities.emplace_back((generation << 32) | index);
+  }
+
+  void ECS::rebuild_container_lookup()
+  {
+    container_lookup.clear();
+    for(i64 i = 0; i < containers.size(); ++i) {
+      i64 const type_index = get_component_type_index(containers[i].family);
+      if(container_lookup.size() <= type_index) {
+        container_lookup.resize(type_index + 1, -1);
+      }
+      container_lookup[type_index] = i;
+    }
+  }
+
+  i64 ECS::find_or_create_group(anton::Slice<i64 const> const type_indices)
+  {
+    for(i64 i = 0; i < groups.size(); ++i) {
+      Group_Data const& group = groups[i];
+      if(group.type_indices.size() != type_indices.size()) {
+        continue;
+      }
+
+      bool same = true;
+      for(i64 const index: type_indices) {
+        same = same && anton::find(group.type_indices.begin(),
+                                   group.type_indices.end(),
+                                   index) != group.type_indices.end();
+      }
+      if(same) {
+        return i;
+      }
+    }
+
+    ANTON_ASSERT(!structure_locked, "Cannot create a group while the "
+                                    "structure of the ECS is locked");
+    i64 const group_index = groups.size();
+    for(i64 const type_index: type_indices) {
+      Components_Container_Data& data =
+        containers[container_lookup[type_index]];
+      ANTON_VERIFY(data.group == -1,
+                   "Component type is already owned by another group");
+      data.group = group_index;
+    }
+
+    Group_Data& group = groups.emplace_back();
+    group.type_indices =
+      anton::Array<i64>(anton::range_construct, type_indices.begin(),
+                        type_indices.end());
+    // Pack the entities that already have all of the owned components.
+    // Entering the group only moves entities that have already been visited.
+    Component_Container_Base* container =
+      containers[container_lookup[type_indices[0]]].container;
+    for(i64 i = 0; i < container->size(); ++i) {
+      enter_group(group, container->entities()[i]);
+    }
+    mark_structure_changed();
+    return group_index;
+  }
+
+  void ECS::enter_group(Group_Data& group, Entity const entity)
+  {
+    for(i64 const type_index: group.type_indices) {
+      Component_Container_Base const* const container =
+        containers[container_lookup[type_index]].container;
+      if(!container->has(entity)) {
+        return;
+      }
+    }
+
+    Component_Container_Base* const first =
+      containers[container_lookup[group.type_indices[0]]].container;
+    if(first->get_component_index(entity) < group.size) {
+      return;
+    }
+
+    for(i64 const type_index: group.type_indices) {
+      Component_Container_Base* const container =
+        containers[container_lookup[type_index]].container;
+      container->swap_positions(container->get_component_index(entity),
+                                group.size);
+    }
+    group.size += 1;
+  }
+
+  void ECS::leave_group(Group_Data& group, Entity const entity)
+  {
+    Component_Container_Base* const first =
+      containers[container_lookup[group.type_indices[0]]].container;
+    if(!first->has(entity) || first->get_component_index(entity) >= group.size) {
+      return;
+    }
+
+    group.size -= 1;
+    for(i64 const type_index: group.type_indices) {
+      Component_Container_Base* const container =
+        containers[container_lookup[type_index]].container;
+      container->swap_positions(container->get_component_index(entity),
+                                group.size);
+    }
   }
 
   static void
@@ -76,13 +210,41 @@ namespace anton_engine {
   void deserialize(serialization::Binary_Input_Archive& archive, ECS& ecs)
   {
     deserialize(archive, ecs._entities);
+    // Rebuild the generations and the free list from the live entities.
+    ecs.generations.clear();
+    ecs.free_indices.clear();
+    anton::Array<bool> used;
+    for(Entity const entity: ecs._entities) {
+      u64 const index = entity_index(entity);
+      if(index >= static_cast<u64>(ecs.generations.size())) {
+        ecs.generations.resize(index + 1, 0);
+        used.resize(index + 1, false);
+      }
+      ecs.generations[index] = entity_generation(entity);
+      used[index] = true;
+    }
+
+    // Generations of destroyed entities are not serialized. Free indices get
+    // generation 1, so that handles with generation 0, which every index has
+    // when it is first used, are not alive.
+    for(i64 i = used.size() - 1; i >= 0; --i) {
+      if(!used[i]) {
+        ecs.generations[i] = 1;
+        ecs.free_indices.push_back(i);
+      }
+    }
+
     i64 containers_count;
     archive.read(containers_count);
+    // Groups are not serialized and have to be recreated.
+    ecs.groups.clear();
     ecs.containers.resize(containers_count);
     for(auto& data: ecs.containers) {
       archive.read(data.family);
       deserialize_component_container(data.family, archive, data.container);
     }
+    ecs.rebuild_container_lookup();
+    ecs.mark_structure_changed();
   }
 
   ECS& get_ecs()
@@ -2,23 +2,337 @@
 #include <engine/ecs/jobs_management.hpp>
 
 #include <anton/array.hpp>
+#include <anton/assert.hpp>
+#include <anton/swap.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace anton_engine {
-  static anton::Array<Job*> jobs;
+  // Maximum number of jobs that may be scheduled and not yet finished at any time.
+  // Must be a power of 2.
+  constexpr i64 max_jobs_in_flight = 4096;
+
+  struct Job_Record {
+    Job* job = nullptr;
+    // Id of the job that currently occupies the record.
+    std::atomic<Job_Id> id{null_job};
+    std::atomic<bool> finished{true};
+    // Number of unfinished dependencies plus one held by schedule_job until
+    // all dependencies have been registered.
+    std::atomic<i64> unfinished_dependencies{0};
+    // Guards dependents and the transition to finished.
+    std::mutex mutex;
+    anton::Array<Job_Id> dependents;
+  };
+
+  // Double-ended queue of runnable jobs. The owning worker pushes and pops at
+  // the back, other workers steal from the front.
+  class Job_Deque {
+  public:
+    void push_back(Job_Id const id)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(count == buffer.size()) {
+        grow();
+      }
+      i64 const index = (head + count) & (buffer.size() - 1);
+      buffer[index] = id;
+      count += 1;
+    }
+
+    [[nodiscard]] Job_Id pop_back()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(count == 0) {
+        return null_job;
+      }
+
+      count -= 1;
+      i64 const index = (head + count) & (buffer.size() - 1);
+      return buffer[index];
+    }
+
+    [[nodiscard]] Job_Id steal_front()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(count == 0) {
+        return null_job;
+      }
+
+      Job_Id const id = buffer[head];
+      head = (head + 1) & (buffer.size() - 1);
+      count -= 1;
+      return id;
+    }
+
+  private:
+    std::mutex mutex;
+    anton::Array<Job_Id> buffer;
+    i64 head = 0;
+    i64 count = 0;
 
-  i64 schedule_job(Job* job)
+    void grow()
+    {
+      i64 const new_size = buffer.size() > 0 ? buffer.size() * 2 : 64;
+      anton::Array<Job_Id> new_buffer(new_size, null_job);
+      for(i64 i = 0; i < count; ++i) {
+        new_buffer[i] = buffer[(head + i) & (buffer.size() - 1)];
+      }
+      anton::swap(buffer, new_buffer);
+      head = 0;
+    }
+  };
+
+  static Job_Record records[max_jobs_in_flight];
+  // Deque 0 belongs to the main thread and to any other thread that is not a
+  // worker of the pool. Deques 1..n belong to the worker threads.
+  static anton::Array<Job_Deque*> deques;
+  static anton::Array<std::thread> workers;
+  static std::atomic<Job_Id> next_id{0};
+  // Number of jobs that have been scheduled, but have not finished yet.
+  static std::atomic<i64> pending_jobs{0};
+  // Number of jobs that are sitting in the deques.
+  static std::atomic<i64> queued_jobs{0};
+  static std::atomic<bool> quit{false};
+  static std::mutex sleep_mutex;
+  static std::condition_variable sleep_condition;
+  static thread_local i64 thread_index = 0;
+
+  [[nodiscard]] static Job_Record& get_record(Job_Id const id)
   {
-    jobs.push_back(job);
-    // TODO: Generate id
-    return 0;
+    return records[id & (max_jobs_in_flight - 1)];
   }
 
-  void execute_jobs()
+  [[nodiscard]] static bool is_finished(Job_Id const id)
+  {
+    Job_Record const& record = get_record(id);
+    // A record is reused only after the previous job has finished.
+    // finished is loaded first. If it is false because the record has been
+    // claimed by a newer job, the load of id observes the newer id.
+    bool const finished = record.finished.load(std::memory_order_acquire);
+    return finished || record.id.load(std::memory_order_acquire) != id;
+  }
+
+  static void run_job(Job_Id id);
+
+  static void enqueue(Job_Id const id)
+  {
+    if(deques.size() == 0) {
+      // The pool has not been started. Run the job inline.
+      run_job(id);
+      return;
+    }
+
+    deques[thread_index]->push_back(id);
+    queued_jobs.fetch_add(1, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_condition.notify_one();
+  }
+
+  [[nodiscard]] static Job_Id take_job()
+  {
+    i64 const deque_count = deques.size();
+    if(deque_count == 0 || queued_jobs.load(std::memory_order_acquire) == 0) {
+      return null_job;
+    }
+
+    Job_Id id = deques[thread_index]->pop_back();
+    for(i64 i = 1; id == null_job && i < deque_count; ++i) {
+      i64 const victim = (thread_index + i) % deque_count;
+      id = deques[victim]->steal_front();
+    }
+
+    if(id != null_job) {
+      queued_jobs.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    return id;
+  }
+
+  static void finish_job(Job_Id const id)
+  {
+    Job_Record& record = get_record(id);
+    anton::Array<Job_Id> dependents;
+    {
+      std::lock_guard<std::mutex> lock(record.mutex);
+      anton::swap(dependents, record.dependents);
+      record.finished.store(true, std::memory_order_release);
+    }
+
+    for(Job_Id const dependent: dependents) {
+      Job_Record& dependent_record = get_record(dependent);
+      if(dependent_record.unfinished_dependencies.fetch_sub(
+           1, std::memory_order_acq_rel) == 1) {
+        enqueue(dependent);
+      }
+    }
+
+    pending_jobs.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  static void run_job(Job_Id const id)
+  {
+    Job_Record& record = get_record(id);
+    record.job->execute();
+    finish_job(id);
+  }
+
+  // Execute a single pending job or yield if there is none.
+  static void help()
+  {
+    Job_Id const id = take_job();
+    if(id != null_job) {
+      run_job(id);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  static void worker_main(i64 const index)
+  {
+    thread_index = index;
+    while(true) {
+      Job_Id const id = take_job();
+      if(id != null_job) {
+        run_job(id);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      sleep_condition.wait(lock, [] {
+        return quit.load(std::memory_order_acquire) ||
+               queued_jobs.load(std::memory_order_acquire) > 0;
+      });
+      if(quit.load(std::memory_order_acquire)) {
+        return;
+      }
+    }
+  }
+
+  [[nodiscard]] static Job_Id allocate_job(Job* const job)
+  {
+    Job_Id const id = next_id.fetch_add(1, std::memory_order_relaxed);
+    Job_Record& record = get_record(id);
+    // Too many jobs in flight. Help until the record becomes free.
+    // Ids that are max_jobs_in_flight apart share the record. It is claimed
+    // under the record's mutex, so that schedule_job never registers a
+    // dependent on the previous job after the record has been taken over.
+    while(true) {
+      {
+        std::lock_guard<std::mutex> lock(record.mutex);
+        if(record.finished.load(std::memory_order_acquire)) {
+          record.job = job;
+          record.dependents.clear();
+          record.unfinished_dependencies.store(1, std::memory_order_relaxed);
+          // Publish the new id before finished drops, so that is_finished
+          // keeps reporting the previous job as finished.
+          record.id.store(id, std::memory_order_release);
+          record.finished.store(false, std::memory_order_release);
+          break;
+        }
+      }
+      help();
+    }
+
+    pending_jobs.fetch_add(1, std::memory_order_relaxed);
+    return id;
+  }
+
+  Job_Id schedule_job(Job* const job)
+  {
+    return schedule_job(job, {});
+  }
+
+  Job_Id schedule_job(Job* const job,
+                      anton::Slice<Job_Id const> const dependencies)
+  {
+    ANTON_ASSERT(job != nullptr, "job must not be nullptr");
+    Job_Id const id = allocate_job(job);
+    Job_Record& record = get_record(id);
+    for(Job_Id const dependency: dependencies) {
+      if(dependency == null_job) {
+        continue;
+      }
+
+      ANTON_ASSERT(dependency < id, "job may depend only on earlier jobs");
+      Job_Record& dependency_record = get_record(dependency);
+      std::lock_guard<std::mutex> lock(dependency_record.mutex);
+      if(dependency_record.id.load(std::memory_order_acquire) == dependency &&
+         !dependency_record.finished.load(std::memory_order_acquire)) {
+        record.unfinished_dependencies.fetch_add(1, std::memory_order_relaxed);
+        dependency_record.dependents.push_back(id);
+      }
+    }
+
+    if(record.unfinished_dependencies.fetch_sub(
+         1, std::memory_order_acq_rel) == 1) {
+      enqueue(id);
+    }
+
+    return id;
+  }
+
+  void wait(Job_Id const id)
   {
-    for(Job* job: jobs) {
-      job->execute();
+    if(id == null_job) {
+      return;
     }
 
-    jobs.clear();
+    while(!is_finished(id)) {
+      help();
+    }
+  }
+
+  i64 get_job_thread_count()
+  {
+    return workers.size() + 1;
+  }
+
+  void init_jobs()
+  {
+    ANTON_ASSERT(deques.size() == 0, "job system has already been initialized");
+    i64 const hardware_threads = std::thread::hardware_concurrency();
+    i64 const worker_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+    quit.store(false, std::memory_order_release);
+    thread_index = 0;
+    // Create all deques before starting the workers, so that they never
+    // observe a partially constructed array.
+    for(i64 i = 0; i < worker_count + 1; ++i) {
+      deques.push_back(new Job_Deque);
+    }
+
+    for(i64 i = 0; i < worker_count; ++i) {
+      workers.emplace_back(worker_main, i + 1);
+    }
+  }
+
+  void terminate_jobs()
+  {
+    execute_jobs();
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+      quit.store(true, std::memory_order_release);
+    }
+    sleep_condition.notify_all();
+    for(std::thread& worker: workers) {
+      worker.join();
+    }
+
+    workers.clear();
+    for(Job_Deque* deque: deques) {
+      delete deque;
+    }
+    deques.clear();
+  }
+
+  void execute_jobs()
+  {
+    while(pending_jobs.load(std::memory_order_acquire) > 0) {
+      help();
+    }
   }
 } // namespace anton_engine
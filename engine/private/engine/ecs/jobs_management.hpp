@@ -1,5 +1,10 @@
 #pragma once
 
 namespace anton_engine {
+  // Start the worker threads of the job pool.
+  void init_jobs();
+  // Finish all pending jobs and join the worker threads.
+  void terminate_jobs();
+  // Block until every scheduled job has finished.
   void execute_jobs();
-}
+} // namespace anton_engine
@@ -2,16 +2,75 @@
 #include <engine/ecs/system_management.hpp>
 
 #include <core/logging.hpp>
+#include <engine/ecs/ecs.hpp>
+#include <engine/ecs/jobs.hpp>
 
 namespace anton_engine {
+  class System_Job: public Job {
+  public:
+    System* system = nullptr;
+    bool exclusive = false;
+
+    void execute() override
+    {
+      // An exclusive system is never updated concurrently with other systems
+      // and may modify the structure of the ECS directly.
+      ECS& ecs = get_ecs();
+      if(exclusive) {
+        ecs.set_structure_locked(false);
+      }
+      system->update();
+      if(exclusive) {
+        ecs.set_structure_locked(true);
+      }
+    }
+  };
+
+  struct System_Node {
+    System_Job job;
+    // Indices of earlier systems whose accesses conflict with this system.
+    anton::Array<i64> dependencies;
+  };
+
   static anton::Array<System*> systems;
+  static anton::Array<System_Node> system_graph;
 
   // From game dll
   create_systems_type create_systems = nullptr;
 
+  // Build the update graph. A system depends on every earlier system (in the order
+  // returned by create_systems) whose accesses conflict with its own, so the
+  // results are the same as when updating serially.
+  // Creates the containers of all declared components, so that systems updated
+  // concurrently only look them up.
+  static void build_system_graph()
+  {
+    ECS& ecs = get_ecs();
+    anton::Array<System_Access> accesses{anton::reserve, systems.size()};
+    for(System* system: systems) {
+      System_Access& access = accesses.emplace_back();
+      system->declare_access(access);
+      access.create_containers(ecs);
+    }
+
+    system_graph.clear();
+    system_graph.resize(systems.size());
+    for(i64 i = 0; i < systems.size(); ++i) {
+      System_Node& node = system_graph[i];
+      node.job.system = systems[i];
+      node.job.exclusive = accesses[i].is_exclusive();
+      for(i64 j = 0; j < i; ++j) {
+        if(accesses[i].conflicts_with(accesses[j])) {
+          node.dependencies.push_back(j);
+        }
+      }
+    }
+  }
+
   void init_systems()
   {
     systems = create_systems();
+    build_system_graph();
   }
 
   void start_systems()
@@ -23,8 +82,27 @@ namespace anton_engine {
 
   void update_systems()
   {
+    ECS& ecs = get_ecs();
+    ecs.set_structure_locked(true);
+    anton::Array<Job_Id> ids{anton::reserve, system_graph.size()};
+    anton::Array<Job_Id> dependencies;
+    for(System_Node& node: system_graph) {
+      dependencies.clear();
+      for(i64 const index: node.dependencies) {
+        dependencies.push_back(ids[index]);
+      }
+      ids.push_back(schedule_job(&node.job, dependencies));
+    }
+
+    for(Job_Id const id: ids) {
+      wait(id);
+    }
+
+    ecs.set_structure_locked(false);
+    // Apply in the order of the systems, so that the result does not depend
+    // on the order the systems finished in.
     for(System* system: systems) {
-      system->update();
+      system->get_command_buffer().apply(ecs);
     }
   }
 } // namespace anton_engine
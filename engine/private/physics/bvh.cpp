@@ -0,0 +1,143 @@
+#include <physics/bvh.hpp>
+
+#include <anton/math/vec4.hpp>
+#include <engine/mesh.hpp>
+
+#include <algorithm> // std::nth_element
+
+namespace anton_engine {
+  AABB merge(AABB const lhs, AABB const rhs)
+  {
+    AABB result;
+    for(i64 i = 0; i < 3; ++i) {
+      result.min[i] = math::min(lhs.min[i], rhs.min[i]);
+      result.max[i] = math::max(lhs.max[i], rhs.max[i]);
+    }
+    return result;
+  }
+
+  AABB transform_aabb(AABB const box, Mat4 const& matrix)
+  {
+    // Transform the center and project the extents onto the world axes.
+    Vec3 const center = (box.min + box.max) * 0.5f;
+    Vec3 const extents = (box.max - box.min) * 0.5f;
+    Vec4 const world_center = matrix * Vec4(center, 1.0f);
+    AABB result;
+    for(i64 i = 0; i < 3; ++i) {
+      f32 const extent = math::abs(matrix[0][i]) * extents.x +
+                         math::abs(matrix[1][i]) * extents.y +
+                         math::abs(matrix[2][i]) * extents.z;
+      result.min[i] = world_center[i] - extent;
+      result.max[i] = world_center[i] + extent;
+    }
+    return result;
+  }
+
+  f32 intersect_ray_aabb(Vec3 const origin, Vec3 const inv_direction,
+                         AABB const box)
+  {
+    f32 t_min = 0.0f;
+    f32 t_max = math::infinity;
+    for(i64 i = 0; i < 3; ++i) {
+      f32 t1 = (box.min[i] - origin[i]) * inv_direction[i];
+      f32 t2 = (box.max[i] - origin[i]) * inv_direction[i];
+      if(t1 > t2) {
+        anton::swap(t1, t2);
+      }
+      // Written so that NaNs produced by rays parallel to a slab are ignored.
+      t_min = t1 > t_min ? t1 : t_min;
+      t_max = t2 < t_max ? t2 : t_max;
+    }
+
+    return t_min <= t_max ? t_min : math::infinity;
+  }
+
+  // Number of primitives below which nodes are not split any further.
+  constexpr i32 bvh_leaf_size = 4;
+
+  static i32 build_node(BVH& bvh, anton::Slice<AABB const> const boxes,
+                        anton::Array<Vec3> const& centroids, i32 const first,
+                        i32 const last)
+  {
+    i32 const node_index = bvh.nodes.size();
+    bvh.nodes.push_back(BVH_Node{});
+    AABB bounds = boxes[bvh.primitives[first]];
+    AABB centroid_bounds = {centroids[bvh.primitives[first]],
+                            centroids[bvh.primitives[first]]};
+    for(i32 i = first + 1; i < last; ++i) {
+      i32 const primitive = bvh.primitives[i];
+      bounds = merge(bounds, boxes[primitive]);
+      centroid_bounds =
+        merge(centroid_bounds, {centroids[primitive], centroids[primitive]});
+    }
+
+    bvh.nodes[node_index].bounds = bounds;
+    if(last - first <= bvh_leaf_size) {
+      bvh.nodes[node_index].index = first;
+      bvh.nodes[node_index].count = last - first;
+      return node_index;
+    }
+
+    Vec3 const size = centroid_bounds.max - centroid_bounds.min;
+    i64 axis = 0;
+    if(size.y > size.x) {
+      axis = 1;
+    }
+    if(size.z > size[axis]) {
+      axis = 2;
+    }
+
+    i32 const middle = first + (last - first) / 2;
+    std::nth_element(bvh.primitives.data() + first,
+                     bvh.primitives.data() + middle,
+                     bvh.primitives.data() + last,
+                     [&centroids, axis](i32 const lhs, i32 const rhs) {
+                       return centroids[lhs][axis] < centroids[rhs][axis];
+                     });
+    build_node(bvh, boxes, centroids, first, middle);
+    i32 const second = build_node(bvh, boxes, centroids, middle, last);
+    bvh.nodes[node_index].index = second;
+    bvh.nodes[node_index].count = 0;
+    return node_index;
+  }
+
+  void BVH::build(anton::Slice<AABB const> const boxes)
+  {
+    nodes.clear();
+    primitives.clear();
+    if(boxes.size() == 0) {
+      return;
+    }
+
+    anton::Array<Vec3> centroids{anton::reserve, boxes.size()};
+    for(i64 i = 0; i < boxes.size(); ++i) {
+      centroids.push_back((boxes[i].min + boxes[i].max) * 0.5f);
+      primitives.push_back(i);
+    }
+    build_node(*this, boxes, centroids, 0, boxes.size());
+  }
+
+  AABB BVH::get_bounds() const
+  {
+    if(nodes.size() == 0) {
+      return {Vec3(0.0f), Vec3(0.0f)};
+    }
+
+    return nodes[0].bounds;
+  }
+
+  BVH build_mesh_bvh(Mesh const& mesh)
+  {
+    anton::Array<AABB> boxes{anton::reserve, mesh.indices.size() / 3};
+    for(i64 i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      Vec3 const a = mesh.vertices[mesh.indices[i]].position;
+      Vec3 const b = mesh.vertices[mesh.indices[i + 1]].position;
+      Vec3 const c = mesh.vertices[mesh.indices[i + 2]].position;
+      boxes.push_back(merge(merge({a, a}, {b, b}), {c, c}));
+    }
+
+    BVH bvh;
+    bvh.build(boxes);
+    return bvh;
+  }
+} // namespace anton_engine
@@ -1,12 +1,19 @@
 #include <physics/intersection_tests.hpp>
 
-#include <anton/math/mat3.hpp>
+#include <anton/assert.hpp>
 #include <anton/math/mat4.hpp>
 #include <anton/math/math.hpp>
 #include <anton/math/transform.hpp>
 #include <core/types.hpp>
 #include <engine/mesh.hpp>
 
+#if defined(__SSE2__) || defined(_M_X64)
+  #define ANTON_INTERSECTION_SSE 1
+  #include <emmintrin.h>
+#else
+  #define ANTON_INTERSECTION_SSE 0
+#endif
+
 namespace anton_engine {
   anton::Optional<Raycast_Hit> intersect_ray_plane(Ray const ray,
                                                    Vec3 const plane_normal,
@@ -30,15 +37,30 @@ namespace anton_engine {
                                                       Vec3 const b,
                                                       Vec3 const c)
   {
-    Vec3 ao = ray.origin - a;
-    Vec3 ab = b - a;
-    Vec3 ac = c - a;
-    Mat3 inv_mat = math::inverse({ab, ac, -ray.direction});
-    Vec3 result = inv_mat * ao;
-    f32 u = result.x;
-    f32 v = result.y;
-    f32 t = result.z;
-    if(u < 0 || v < 0 || u + v > 1 || t < 0) {
+    Vec3 const ab = b - a;
+    Vec3 const ac = c - a;
+    Vec3 const p = math::cross(ray.direction, ac);
+    f32 const det = math::dot(ab, p);
+    // The ray is parallel to the triangle or the triangle is degenerate.
+    if(det == 0.0f) {
+      return anton::null_optional;
+    }
+
+    f32 const inv_det = 1.0f / det;
+    Vec3 const ao = ray.origin - a;
+    f32 const u = math::dot(ao, p) * inv_det;
+    if(u < 0 || u > 1) {
+      return anton::null_optional;
+    }
+
+    Vec3 const q = math::cross(ao, ab);
+    f32 const v = math::dot(ray.direction, q) * inv_det;
+    if(v < 0 || u + v > 1) {
+      return anton::null_optional;
+    }
+
+    f32 const t = math::dot(ac, q) * inv_det;
+    if(t < 0) {
       return anton::null_optional;
     }
 
@@ -46,6 +68,128 @@ namespace anton_engine {
     return Raycast_Hit{r, {u, v, 1 - u - v}, t};
   }
 
+  Triangle_Packet make_triangle_packet(Vec3 const* const vertices,
+                                       i32 const count)
+  {
+    ANTON_ASSERT(count <= 4, "packet holds at most 4 triangles");
+    Triangle_Packet packet = {};
+    for(i32 lane = 0; lane < count; ++lane) {
+      Vec3 const a = vertices[3 * lane];
+      Vec3 const ab = vertices[3 * lane + 1] - a;
+      Vec3 const ac = vertices[3 * lane + 2] - a;
+      for(i32 i = 0; i < 3; ++i) {
+        packet.a[i][lane] = a[i];
+        packet.ab[i][lane] = ab[i];
+        packet.ac[i][lane] = ac[i];
+      }
+    }
+    return packet;
+  }
+
+  anton::Optional<Raycast_Hit>
+  intersect_ray_triangles(Ray const ray, Triangle_Packet const& packet,
+                          i32* const lane)
+  {
+    f32 us[4];
+    f32 vs[4];
+    f32 ts[4];
+    i32 mask = 0;
+#if ANTON_INTERSECTION_SSE
+    {
+      __m128 const zero = _mm_setzero_ps();
+      __m128 const one = _mm_set1_ps(1.0f);
+      __m128 const dx = _mm_set1_ps(ray.direction.x);
+      __m128 const dy = _mm_set1_ps(ray.direction.y);
+      __m128 const dz = _mm_set1_ps(ray.direction.z);
+      __m128 const abx = _mm_loadu_ps(packet.ab[0]);
+      __m128 const aby = _mm_loadu_ps(packet.ab[1]);
+      __m128 const abz = _mm_loadu_ps(packet.ab[2]);
+      __m128 const acx = _mm_loadu_ps(packet.ac[0]);
+      __m128 const acy = _mm_loadu_ps(packet.ac[1]);
+      __m128 const acz = _mm_loadu_ps(packet.ac[2]);
+      // p = cross(direction, ac)
+      __m128 const px = _mm_sub_ps(_mm_mul_ps(dy, acz), _mm_mul_ps(dz, acy));
+      __m128 const py = _mm_sub_ps(_mm_mul_ps(dz, acx), _mm_mul_ps(dx, acz));
+      __m128 const pz = _mm_sub_ps(_mm_mul_ps(dx, acy), _mm_mul_ps(dy, acx));
+      __m128 const det = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(abx, px), _mm_mul_ps(aby, py)),
+        _mm_mul_ps(abz, pz));
+      __m128 const inv_det = _mm_div_ps(one, det);
+      // ao = origin - a
+      __m128 const aox =
+        _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(packet.a[0]));
+      __m128 const aoy =
+        _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(packet.a[1]));
+      __m128 const aoz =
+        _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(packet.a[2]));
+      __m128 const u = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(aox, px), _mm_mul_ps(aoy, py)),
+                   _mm_mul_ps(aoz, pz)),
+        inv_det);
+      // q = cross(ao, ab)
+      __m128 const qx = _mm_sub_ps(_mm_mul_ps(aoy, abz), _mm_mul_ps(aoz, aby));
+      __m128 const qy = _mm_sub_ps(_mm_mul_ps(aoz, abx), _mm_mul_ps(aox, abz));
+      __m128 const qz = _mm_sub_ps(_mm_mul_ps(aox, aby), _mm_mul_ps(aoy, abx));
+      __m128 const v = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+                   _mm_mul_ps(dz, qz)),
+        inv_det);
+      __m128 const t = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(acx, qx), _mm_mul_ps(acy, qy)),
+                   _mm_mul_ps(acz, qz)),
+        inv_det);
+      __m128 hit = _mm_cmpneq_ps(det, zero);
+      hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+      hit = _mm_and_ps(hit, _mm_cmple_ps(u, one));
+      hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+      hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+      hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+      mask = _mm_movemask_ps(hit);
+      _mm_storeu_ps(us, u);
+      _mm_storeu_ps(vs, v);
+      _mm_storeu_ps(ts, t);
+    }
+#else
+    for(i32 i = 0; i < 4; ++i) {
+      Vec3 const a = {packet.a[0][i], packet.a[1][i], packet.a[2][i]};
+      Vec3 const b = a + Vec3{packet.ab[0][i], packet.ab[1][i], packet.ab[2][i]};
+      Vec3 const c = a + Vec3{packet.ac[0][i], packet.ac[1][i], packet.ac[2][i]};
+      if(auto hit = intersect_ray_triangle(ray, a, b, c)) {
+        us[i] = hit->barycentric_coordinates.x;
+        vs[i] = hit->barycentric_coordinates.y;
+        ts[i] = hit->distance;
+        mask |= 1 << i;
+      }
+    }
+#endif
+
+    i32 closest = -1;
+    for(i32 i = 0; i < 4; ++i) {
+      if((mask & (1 << i)) && (closest == -1 || ts[i] < ts[closest])) {
+        closest = i;
+      }
+    }
+
+    if(closest == -1) {
+      return anton::null_optional;
+    }
+
+    if(lane) {
+      *lane = closest;
+    }
+
+    f32 const u = us[closest];
+    f32 const v = vs[closest];
+    Vec3 const a = {packet.a[0][closest], packet.a[1][closest],
+                    packet.a[2][closest]};
+    Vec3 const ab = {packet.ab[0][closest], packet.ab[1][closest],
+                     packet.ab[2][closest]};
+    Vec3 const ac = {packet.ac[0][closest], packet.ac[1][closest],
+                     packet.ac[2][closest]};
+    Vec3 r(a + u * ab + v * ac);
+    return Raycast_Hit{r, {u, v, 1 - u - v}, ts[closest]};
+  }
+
   anton::Optional<Raycast_Hit>
   intersect_ray_cone(Ray const ray, Vec3 const vertex, Vec3 const direction,
                      f32 const angle_cos, f32 const height)
@@ -232,10 +376,14 @@ namespace anton_engine {
   bool test_ray_mesh(Ray ray, Mesh const& mesh)
   {
     auto& verts = mesh.vertices;
-    for(isize i = 0; i < mesh.indices.size(); i += 3) {
-      if(intersect_ray_triangle(ray, verts[mesh.indices[i]].position,
-                                verts[mesh.indices[i + 1]].position,
-                                verts[mesh.indices[i + 2]].position)) {
+    Vec3 triangles[12];
+    for(isize i = 0; i < mesh.indices.size(); i += 12) {
+      i32 const count = math::min(mesh.indices.size() - i, (isize)12) / 3;
+      for(i32 j = 0; j < 3 * count; ++j) {
+        triangles[j] = verts[mesh.indices[i + j]].position;
+      }
+
+      if(intersect_ray_triangles(ray, make_triangle_packet(triangles, count))) {
         return true;
       }
     }
@@ -249,14 +397,16 @@ namespace anton_engine {
     Raycast_Hit closest_hit;
     closest_hit.distance = math::infinity;
     auto& verts = mesh.vertices;
-    for(isize i = 0; i < mesh.indices.size(); i += 3) {
-      Vec4 vert1 = model_transform * Vec4(verts[mesh.indices[i]].position, 1);
-      Vec4 vert2 =
-        model_transform * Vec4(verts[mesh.indices[i + 1]].position, 1);
-      Vec4 vert3 =
-        model_transform * Vec4(verts[mesh.indices[i + 2]].position, 1);
+    Vec3 triangles[12];
+    for(isize i = 0; i < mesh.indices.size(); i += 12) {
+      i32 const count = math::min(mesh.indices.size() - i, (isize)12) / 3;
+      for(i32 j = 0; j < 3 * count; ++j) {
+        triangles[j] = Vec3(model_transform *
+                            Vec4(verts[mesh.indices[i + j]].position, 1));
+      }
+
       if(auto hit =
-           intersect_ray_triangle(ray, Vec3(vert1), Vec3(vert2), Vec3(vert3));
+           intersect_ray_triangles(ray, make_triangle_packet(triangles, count));
          hit && hit->distance < closest_hit.distance) {
         closest_hit = hit.value();
         hit_flag = true;
@@ -270,6 +420,35 @@ namespace anton_engine {
     }
   }
 
+  anton::Optional<Raycast_Hit> intersect_ray_mesh(Ray const ray,
+                                                  Mesh const& mesh,
+                                                  BVH const& mesh_bvh)
+  {
+    Raycast_Hit closest_hit;
+    f32 const distance = mesh_bvh.raycast(
+      ray, math::infinity,
+      [&ray, &mesh, &closest_hit](i32 const triangle,
+                                  f32 const max_distance) -> f32 {
+        auto& verts = mesh.vertices;
+        i64 const i = 3 * triangle;
+        if(auto hit = intersect_ray_triangle(
+             ray, verts[mesh.indices[i]].position,
+             verts[mesh.indices[i + 1]].position,
+             verts[mesh.indices[i + 2]].position);
+           hit && hit->distance < max_distance) {
+          closest_hit = hit.value();
+          return hit->distance;
+        }
+        return math::infinity;
+      });
+
+    if(distance != math::infinity) {
+      return closest_hit;
+    } else {
+      return anton::null_optional;
+    }
+  }
+
   anton::Optional<Linecast_Hit> intersect_line_plane(Line line, Vec3 normal,
                                                      f32 distance)
   {
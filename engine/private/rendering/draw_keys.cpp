@@ -0,0 +1,68 @@
+#include <rendering/draw_keys.hpp>
+
+#include <anton/swap.hpp>
+#include <core/handle.hpp>
+
+#include <cstring>
+
+namespace anton_engine::rendering {
+  u64 make_draw_key(Static_Mesh_Component const& mesh)
+  {
+    u64 const shader = handle_index(mesh.shader_handle) & 0xFFFF;
+    u64 const material = handle_index(mesh.material_handle) & 0xFFFFFF;
+    u64 const mesh_index = handle_index(mesh.mesh_handle) & 0xFFFFFF;
+    return (shader << 48) | (material << 24) | mesh_index;
+  }
+
+  void radix_sort(anton::Array<u64>& keys, anton::Array<u32>& indices,
+                  Radix_Sort_Scratch& scratch)
+  {
+    i64 const count = keys.size();
+    if(count <= 1) {
+      return;
+    }
+
+    i64 histograms[8][256] = {};
+    for(i64 i = 0; i < count; ++i) {
+      u64 const key = keys[i];
+      for(i64 digit = 0; digit < 8; ++digit) {
+        histograms[digit][(key >> (digit * 8)) & 0xFF] += 1;
+      }
+    }
+
+    scratch.keys.resize(count);
+    scratch.indices.resize(count);
+    u64* src_keys = keys.data();
+    u32* src_indices = indices.data();
+    u64* dst_keys = scratch.keys.data();
+    u32* dst_indices = scratch.indices.data();
+    for(i64 digit = 0; digit < 8; ++digit) {
+      i64* const offsets = histograms[digit];
+      i64 const shift = digit * 8;
+      if(offsets[(src_keys[0] >> shift) & 0xFF] == count) {
+        continue;
+      }
+
+      i64 sum = 0;
+      for(i64 i = 0; i < 256; ++i) {
+        i64 const bucket = offsets[i];
+        offsets[i] = sum;
+        sum += bucket;
+      }
+
+      for(i64 i = 0; i < count; ++i) {
+        i64 const position = offsets[(src_keys[i] >> shift) & 0xFF]++;
+        dst_keys[position] = src_keys[i];
+        dst_indices[position] = src_indices[i];
+      }
+
+      anton::swap(src_keys, dst_keys);
+      anton::swap(src_indices, dst_indices);
+    }
+
+    if(src_keys != keys.data()) {
+      memcpy(keys.data(), src_keys, count * sizeof(u64));
+      memcpy(indices.data(), src_indices, count * sizeof(u32));
+    }
+  }
+} // namespace anton_engine::rendering
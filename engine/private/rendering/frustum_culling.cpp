@@ -0,0 +1,148 @@
+#include <rendering/frustum_culling.hpp>
+
+#include <anton/math/math.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #define ANTON_CULLING_SSE 1
+  #include <emmintrin.h>
+#else
+  #define ANTON_CULLING_SSE 0
+#endif
+
+namespace anton_engine::rendering {
+  Frustum make_frustum(Mat4 const& m)
+  {
+    // Gribb-Hartmann plane extraction. Mat4 is column-major, so m[c][r] is
+    // the element in row r and column c.
+    auto row = [&m](i64 const r) -> Vec4 {
+      return Vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    };
+
+    Vec4 const r0 = row(0);
+    Vec4 const r1 = row(1);
+    Vec4 const r2 = row(2);
+    Vec4 const r3 = row(3);
+    Frustum frustum = {{r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2}};
+    for(Vec4& plane: frustum.planes) {
+      f32 const length = math::length(Vec3(plane.x, plane.y, plane.z));
+      plane = plane / length;
+    }
+    return frustum;
+  }
+
+  Bounding_Sphere
+  compute_bounding_sphere(anton::Slice<Vertex const> const vertices)
+  {
+    if(vertices.size() == 0) {
+      return {Vec3(0.0f), 0.0f};
+    }
+
+    // Center of the bounding box. Cheaper than the minimal sphere and
+    // close enough for culling.
+    Vec3 min = vertices[0].position;
+    Vec3 max = vertices[0].position;
+    for(Vertex const& vertex: vertices) {
+      for(i64 i = 0; i < 3; ++i) {
+        min[i] = math::min(min[i], vertex.position[i]);
+        max[i] = math::max(max[i], vertex.position[i]);
+      }
+    }
+
+    Vec3 const center = (min + max) * 0.5f;
+    f32 radius_squared = 0.0f;
+    for(Vertex const& vertex: vertices) {
+      radius_squared = math::max(
+        radius_squared, math::length_squared(vertex.position - center));
+    }
+    return {center, math::sqrt(radius_squared)};
+  }
+
+  Bounding_Sphere transform_bounding_sphere(Bounding_Sphere const sphere,
+                                            Mat4 const& matrix)
+  {
+    Vec4 const center = matrix * Vec4(sphere.center, 1.0f);
+    // The largest scale along any axis is the length of the longest basis vector.
+    f32 const x_squared =
+      math::length_squared(Vec3(matrix[0][0], matrix[0][1], matrix[0][2]));
+    f32 const y_squared =
+      math::length_squared(Vec3(matrix[1][0], matrix[1][1], matrix[1][2]));
+    f32 const z_squared =
+      math::length_squared(Vec3(matrix[2][0], matrix[2][1], matrix[2][2]));
+    f32 const scale_squared =
+      math::max(x_squared, math::max(y_squared, z_squared));
+    return {Vec3(center.x, center.y, center.z),
+            sphere.radius * math::sqrt(scale_squared)};
+  }
+
+  bool test_sphere(Frustum const& frustum, Bounding_Sphere const& sphere)
+  {
+    for(Vec4 const& plane: frustum.planes) {
+      // Same order of operations as the SSE path, so both agree on the boundary.
+      f32 const distance = plane.x * sphere.center.x + plane.w +
+                           plane.y * sphere.center.y +
+                           plane.z * sphere.center.z;
+      if(distance < -sphere.radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  i64 cull_spheres(Frustum const& frustum,
+                   anton::Slice<Bounding_Sphere const> const spheres,
+                   u32* const visible)
+  {
+    static_assert(sizeof(Bounding_Sphere) == 4 * sizeof(f32),
+                  "Bounding_Sphere must be tightly packed");
+    i64 const count = spheres.size();
+    i64 visible_count = 0;
+    i64 i = 0;
+#if ANTON_CULLING_SSE
+    __m128 plane_x[6];
+    __m128 plane_y[6];
+    __m128 plane_z[6];
+    __m128 plane_w[6];
+    for(i64 p = 0; p < 6; ++p) {
+      plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+      plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+      plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+      plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    f32 const* const data = reinterpret_cast<f32 const*>(spheres.data());
+    __m128 const zero = _mm_setzero_ps();
+    for(; i + 4 <= count; i += 4) {
+      // Transpose 4 spheres into x, y, z and radius lanes.
+      __m128 x = _mm_loadu_ps(data + 4 * i);
+      __m128 y = _mm_loadu_ps(data + 4 * i + 4);
+      __m128 z = _mm_loadu_ps(data + 4 * i + 8);
+      __m128 r = _mm_loadu_ps(data + 4 * i + 12);
+      _MM_TRANSPOSE4_PS(x, y, z, r);
+      __m128 const negative_r = _mm_sub_ps(zero, r);
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for(i64 p = 0; p < 6; ++p) {
+        __m128 distance = _mm_add_ps(_mm_mul_ps(x, plane_x[p]), plane_w[p]);
+        distance = _mm_add_ps(distance, _mm_mul_ps(y, plane_y[p]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(z, plane_z[p]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_r));
+      }
+
+      i32 mask = _mm_movemask_ps(inside);
+      for(u32 lane = 0; mask != 0; ++lane, mask >>= 1) {
+        if(mask & 1) {
+          visible[visible_count] = i + lane;
+          visible_count += 1;
+        }
+      }
+    }
+#endif
+
+    for(; i < count; ++i) {
+      if(test_sphere(frustum, spheres[i])) {
+        visible[visible_count] = i;
+        visible_count += 1;
+      }
+    }
+    return visible_count;
+  }
+} // namespace anton_engine::rendering
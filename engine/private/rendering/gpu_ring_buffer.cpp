@@ -0,0 +1,103 @@
+#include <rendering/gpu_ring_buffer.hpp>
+
+#include <anton/assert.hpp>
+#include <rendering/glad.hpp>
+
+namespace anton_engine::rendering {
+  Fence GL_Fence_Backend::insert_fence()
+  {
+    GLsync const sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    return reinterpret_cast<Fence>(sync);
+  }
+
+  bool GL_Fence_Backend::wait_fence(Fence const fence)
+  {
+    GLsync const sync = reinterpret_cast<GLsync>(fence);
+    GLenum result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+      return false;
+    }
+
+    // Wait in 1ms steps until the fence is signaled.
+    while(result == GL_TIMEOUT_EXPIRED) {
+      result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+
+    ANTON_ASSERT(result != GL_WAIT_FAILED, "glClientWaitSync failed");
+    return true;
+  }
+
+  void GL_Fence_Backend::delete_fence(Fence const fence)
+  {
+    glDeleteSync(reinterpret_cast<GLsync>(fence));
+  }
+
+  GPU_Ring_Buffer::GPU_Ring_Buffer(Fence_Backend* const backend,
+                                   i64 const size, i64 const region_count)
+    : backend(backend), fences(region_count, null_fence),
+      region_size(size / region_count)
+  {
+    ANTON_ASSERT(backend != nullptr, "backend must not be nullptr");
+    ANTON_ASSERT(region_count > 0, "region_count must be greater than 0");
+  }
+
+  GPU_Ring_Buffer::~GPU_Ring_Buffer()
+  {
+    for(Fence const fence: fences) {
+      if(fence != null_fence) {
+        backend->delete_fence(fence);
+      }
+    }
+  }
+
+  void GPU_Ring_Buffer::begin_frame()
+  {
+    region = (region + 1) % fences.size();
+    head = 0;
+    Fence& fence = fences[region];
+    if(fence != null_fence) {
+      if(backend->wait_fence(fence)) {
+        statistics.stall_count += 1;
+      }
+      backend->delete_fence(fence);
+      fence = null_fence;
+    }
+  }
+
+  void GPU_Ring_Buffer::end_frame()
+  {
+    Fence& fence = fences[region];
+    // end_frame without a matching begin_frame guards the region again.
+    if(fence != null_fence) {
+      backend->delete_fence(fence);
+    }
+    fence = backend->insert_fence();
+    statistics.frame_count += 1;
+  }
+
+  i64 GPU_Ring_Buffer::allocate(i64 const count)
+  {
+    ANTON_ASSERT(count >= 0, "count must not be negative");
+    if(region_size - head < count) {
+      statistics.failed_allocations += 1;
+      return -1;
+    }
+
+    i64 const offset = region * region_size + head;
+    head += count;
+    if(head > statistics.high_water_mark) {
+      statistics.high_water_mark = head;
+    }
+    return offset;
+  }
+
+  i64 GPU_Ring_Buffer::get_region_size() const
+  {
+    return region_size;
+  }
+
+  GPU_Ring_Buffer_Statistics const& GPU_Ring_Buffer::get_statistics() const
+  {
+    return statistics;
+  }
+} // namespace anton_engine::rendering
@@ -0,0 +1,175 @@
+#include <rendering/light_clustering.hpp>
+
+#include <anton/math/math.hpp>
+
+#include <cmath> // std::log, std::pow
+
+namespace anton_engine::rendering {
+  Cluster_Grid make_cluster_grid(Mat4 const& projection, i32 const tiles_x,
+                                 i32 const tiles_y, i32 const slices)
+  {
+    // Invert the terms of an OpenGL perspective projection. Mat4 is
+    // column-major, so m[c][r] is the element in row r and column c.
+    f32 const a = projection[2][2];
+    f32 const b = projection[3][2];
+    Cluster_Grid grid;
+    grid.tiles_x = tiles_x;
+    grid.tiles_y = tiles_y;
+    grid.slices = slices;
+    grid.near_plane = b / (a - 1.0f);
+    grid.far_plane = b / (a + 1.0f);
+    grid.tan_half_fov_x = 1.0f / projection[0][0];
+    grid.tan_half_fov_y = 1.0f / projection[1][1];
+    return grid;
+  }
+
+  i32 get_cluster_slice(Cluster_Grid const& grid, f32 const depth)
+  {
+    if(depth < grid.near_plane || depth > grid.far_plane) {
+      return -1;
+    }
+
+    f32 const scale = static_cast<f32>(grid.slices) /
+                      std::log(grid.far_plane / grid.near_plane);
+    i32 const slice =
+      static_cast<i32>(std::log(depth / grid.near_plane) * scale);
+    return math::min(slice, grid.slices - 1);
+  }
+
+  // Compute the range of tiles along one axis covered by [ndc_min, ndc_max].
+  static void get_tile_range(f32 const ndc_min, f32 const ndc_max,
+                             i32 const tiles, i32& first, i32& last)
+  {
+    first = static_cast<i32>(math::floor((ndc_min + 1.0f) * 0.5f * tiles));
+    last = static_cast<i32>(math::floor((ndc_max + 1.0f) * 0.5f * tiles));
+    first = math::max(first, 0);
+    last = math::min(last, tiles - 1);
+  }
+
+  void
+  assign_lights_to_clusters(Cluster_Grid const& grid,
+                            anton::Slice<Bounding_Sphere const> const lights,
+                            Light_Clusters& clusters)
+  {
+    i64 const cluster_count =
+      static_cast<i64>(grid.tiles_x) * grid.tiles_y * grid.slices;
+    clusters.ranges.resize(2 * cluster_count);
+    for(u32& value: clusters.ranges) {
+      value = 0;
+    }
+
+    anton::Array<f32>& slice_depths = clusters.slice_depths;
+    slice_depths.resize(grid.slices + 1);
+    for(i32 i = 0; i <= grid.slices; ++i) {
+      slice_depths[i] =
+        grid.near_plane *
+        std::pow(grid.far_plane / grid.near_plane,
+                  static_cast<f32>(i) / static_cast<f32>(grid.slices));
+    }
+
+    anton::Array<u32>& pair_clusters = clusters.pair_clusters;
+    anton::Array<u32>& pair_lights = clusters.pair_lights;
+    pair_clusters.clear();
+    pair_lights.clear();
+    for(i64 light = 0; light < lights.size(); ++light) {
+      Bounding_Sphere const sphere = lights[light];
+      // View space looks down -z. Depths are positive in front of the camera.
+      f32 const depth = -sphere.center.z;
+      f32 const min_depth = math::max(depth - sphere.radius, grid.near_plane);
+      f32 const max_depth = math::min(depth + sphere.radius, grid.far_plane);
+      if(min_depth > max_depth) {
+        continue;
+      }
+
+      // Conservative screen bounds of the box around the sphere between
+      // min_depth and max_depth. Negative coordinates project farthest from
+      // the center at the smallest depth, positive ones at the largest.
+      auto project_min = [min_depth, max_depth](f32 const coordinate,
+                                                f32 const tan) {
+        return coordinate / ((coordinate < 0.0f ? min_depth : max_depth) * tan);
+      };
+      auto project_max = [min_depth, max_depth](f32 const coordinate,
+                                                f32 const tan) {
+        return coordinate / ((coordinate > 0.0f ? min_depth : max_depth) * tan);
+      };
+      f32 const ndc_min_x =
+        project_min(sphere.center.x - sphere.radius, grid.tan_half_fov_x);
+      f32 const ndc_max_x =
+        project_max(sphere.center.x + sphere.radius, grid.tan_half_fov_x);
+      f32 const ndc_min_y =
+        project_min(sphere.center.y - sphere.radius, grid.tan_half_fov_y);
+      f32 const ndc_max_y =
+        project_max(sphere.center.y + sphere.radius, grid.tan_half_fov_y);
+      if(ndc_min_x > 1.0f || ndc_max_x < -1.0f || ndc_min_y > 1.0f ||
+         ndc_max_y < -1.0f) {
+        continue;
+      }
+
+      i32 first_x;
+      i32 last_x;
+      i32 first_y;
+      i32 last_y;
+      get_tile_range(ndc_min_x, ndc_max_x, grid.tiles_x, first_x, last_x);
+      get_tile_range(ndc_min_y, ndc_max_y, grid.tiles_y, first_y, last_y);
+      i32 const first_z = get_cluster_slice(grid, min_depth);
+      i32 const last_z = get_cluster_slice(grid, max_depth);
+      f32 const radius_squared = sphere.radius * sphere.radius;
+      for(i32 z = first_z; z <= last_z; ++z) {
+        f32 const near_depth = slice_depths[z];
+        f32 const far_depth = slice_depths[z + 1];
+        f32 const dz = math::max(
+          0.0f, math::max(near_depth - depth, depth - far_depth));
+        for(i32 y = first_y; y <= last_y; ++y) {
+          // Tiles widen with depth, so the bounds of the froxel lie on
+          // the near plane of the slice on one side and the far on the other.
+          f32 const bottom =
+            (2.0f * y / grid.tiles_y - 1.0f) * grid.tan_half_fov_y;
+          f32 const top =
+            (2.0f * (y + 1) / grid.tiles_y - 1.0f) * grid.tan_half_fov_y;
+          f32 const min_y = math::min(bottom * near_depth, bottom * far_depth);
+          f32 const max_y = math::max(top * near_depth, top * far_depth);
+          f32 const dy = math::max(0.0f, math::max(min_y - sphere.center.y,
+                                                   sphere.center.y - max_y));
+          for(i32 x = first_x; x <= last_x; ++x) {
+            f32 const left =
+              (2.0f * x / grid.tiles_x - 1.0f) * grid.tan_half_fov_x;
+            f32 const right =
+              (2.0f * (x + 1) / grid.tiles_x - 1.0f) * grid.tan_half_fov_x;
+            f32 const min_x = math::min(left * near_depth, left * far_depth);
+            f32 const max_x = math::max(right * near_depth, right * far_depth);
+            f32 const dx = math::max(0.0f, math::max(min_x - sphere.center.x,
+                                                     sphere.center.x - max_x));
+            if(dx * dx + dy * dy + dz * dz <= radius_squared) {
+              u32 const cluster = (z * grid.tiles_y + y) * grid.tiles_x + x;
+              pair_clusters.push_back(cluster);
+              pair_lights.push_back(light);
+            }
+          }
+        }
+      }
+    }
+
+    // Counting sort of the pairs by cluster. Lights were visited in ascending
+    // order, so they stay sorted within each cluster.
+    for(u32 const cluster: pair_clusters) {
+      clusters.ranges[2 * cluster + 1] += 1;
+    }
+
+    u32 offset = 0;
+    for(i64 cluster = 0; cluster < cluster_count; ++cluster) {
+      clusters.ranges[2 * cluster] = offset;
+      offset += clusters.ranges[2 * cluster + 1];
+      // Reset the count to use it as the write cursor.
+      clusters.ranges[2 * cluster + 1] = 0;
+    }
+
+    clusters.light_indices.resize(pair_lights.size());
+    for(i64 i = 0; i < pair_clusters.size(); ++i) {
+      u32 const cluster = pair_clusters[i];
+      u32& count = clusters.ranges[2 * cluster + 1];
+      clusters.light_indices[clusters.ranges[2 * cluster] + count] =
+        pair_lights[i];
+      count += 1;
+    }
+  }
+} // namespace anton_engine::rendering
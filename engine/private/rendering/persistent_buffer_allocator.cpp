@@ -0,0 +1,108 @@
+#include <rendering/persistent_buffer_allocator.hpp>
+
+#include <anton/assert.hpp>
+
+namespace anton_engine::rendering {
+  Persistent_Buffer_Allocator::Persistent_Buffer_Allocator(
+    i64 const size, i64 const frame_latency)
+    : frame_latency(frame_latency)
+  {
+    ANTON_ASSERT(size >= 0, "size must not be negative");
+    ANTON_ASSERT(frame_latency >= 0, "frame_latency must not be negative");
+    if(size > 0) {
+      free_ranges.push_back(Range{0, size, 0});
+    }
+  }
+
+  void Persistent_Buffer_Allocator::begin_frame()
+  {
+    i64 i = 0;
+    while(i < pending_ranges.size()) {
+      Range& range = pending_ranges[i];
+      range.frames_left -= 1;
+      if(range.frames_left <= 0) {
+        release(range.offset, range.count);
+        pending_ranges.erase_unsorted_unchecked(i);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  i64 Persistent_Buffer_Allocator::allocate(i64 const count)
+  {
+    ANTON_ASSERT(count >= 0, "count must not be negative");
+    if(count == 0) {
+      return 0;
+    }
+
+    for(i64 i = 0; i < free_ranges.size(); ++i) {
+      Range& range = free_ranges[i];
+      if(range.count < count) {
+        continue;
+      }
+
+      i64 const offset = range.offset;
+      range.offset += count;
+      range.count -= count;
+      if(range.count == 0) {
+        free_ranges.erase(free_ranges.begin() + i, free_ranges.begin() + i + 1);
+      }
+      return offset;
+    }
+    return -1;
+  }
+
+  void Persistent_Buffer_Allocator::free(i64 const offset, i64 const count)
+  {
+    ANTON_ASSERT(offset >= 0 && count >= 0, "invalid range");
+    if(count == 0) {
+      return;
+    }
+
+    if(frame_latency == 0) {
+      release(offset, count);
+    } else {
+      pending_ranges.push_back(Range{offset, count, frame_latency});
+    }
+  }
+
+  i64 Persistent_Buffer_Allocator::get_free_size() const
+  {
+    i64 size = 0;
+    for(Range const& range: free_ranges) {
+      size += range.count;
+    }
+    for(Range const& range: pending_ranges) {
+      size += range.count;
+    }
+    return size;
+  }
+
+  void Persistent_Buffer_Allocator::release(i64 const offset, i64 const count)
+  {
+    // Index of the first range after the released one.
+    i64 next = 0;
+    while(next < free_ranges.size() && free_ranges[next].offset < offset) {
+      ++next;
+    }
+
+    bool const merge_previous =
+      next > 0 &&
+      free_ranges[next - 1].offset + free_ranges[next - 1].count == offset;
+    bool const merge_next = next < free_ranges.size() &&
+                            offset + count == free_ranges[next].offset;
+    if(merge_previous && merge_next) {
+      free_ranges[next - 1].count += count + free_ranges[next].count;
+      free_ranges.erase(free_ranges.begin() + next,
+                        free_ranges.begin() + next + 1);
+    } else if(merge_previous) {
+      free_ranges[next - 1].count += count;
+    } else if(merge_next) {
+      free_ranges[next].offset = offset;
+      free_ranges[next].count += count;
+    } else {
+      free_ranges.insert(free_ranges.begin() + next, Range{offset, count, 0});
+    }
+  }
+} // namespace anton_engine::rendering
@@ -4,7 +4,9 @@
 #include <anton/array.hpp>
 #include <anton/flat_hash_map.hpp>
 #include <anton/math/mat4.hpp>
+#include <anton/math/math.hpp>
 #include <anton/math/transform.hpp>
+#include <anton/math/vec3.hpp>
 #include <anton/string.hpp>
 #include <anton/utility.hpp>
 #include <core/exception.hpp>
@@ -21,16 +23,22 @@
 #include <engine/components/spot_light_component.hpp>
 #include <engine/components/static_mesh_component.hpp>
 #include <engine/components/transform.hpp>
+#include <engine/components/world_matrix.hpp>
 #include <engine/ecs/ecs.hpp>
+#include <engine/ecs/jobs.hpp>
 #include <engine/mesh.hpp>
 #include <engine/resource_manager.hpp>
 #include <rendering/framebuffer.hpp>
+#include <rendering/frustum_culling.hpp>
+#include <rendering/draw_keys.hpp>
 #include <rendering/glad.hpp>
+#include <rendering/gpu_ring_buffer.hpp>
+#include <rendering/light_clustering.hpp>
 #include <rendering/opengl.hpp>
+#include <rendering/persistent_buffer_allocator.hpp>
 #include <shaders/builtin_shaders.hpp>
 #include <shaders/shader.hpp>
 
-#include <algorithm> // std::sort
 
 #if ANTON_WITH_EDITOR
   #include <editor.hpp>
@@ -75,6 +83,8 @@ namespace anton_engine::rendering {
     float attentuation_quadratic;
     float diffuse_strength;
     float specular_strength;
+    // Distance beyond which the light has no visible effect.
+    float radius;
   };
 
   struct Directional_Light_Data {
@@ -92,7 +102,6 @@ namespace anton_engine::rendering {
       shininess; // TODO: Remove. Has basically no meaning since it should be per material and should be a different property.
     int point_lights_count;
     int directional_light_count;
-    Point_Light_Data point_lights[16];
     Directional_Light_Data directional_lights[16];
   };
 
@@ -106,10 +115,29 @@ namespace anton_engine::rendering {
   constexpr u32 lighting_data_binding = 0;
   constexpr u32 draw_matrix_binding = 1;
   constexpr u32 draw_material_binding = 2;
+  constexpr u32 point_lights_binding = 3;
+  constexpr u32 cluster_ranges_binding = 4;
+  constexpr u32 cluster_lights_binding = 5;
 
   // Dynamic lights and environment data. Bound to binding 0 and 1 respectively.
   static u32 lighting_data_ubo = 0;
 
+  // Point lights are not limited in number. The deferred shading pass only
+  // evaluates the lights binned into the froxel of each fragment.
+  constexpr i32 cluster_tiles_x = 16;
+  constexpr i32 cluster_tiles_y = 9;
+  constexpr i32 cluster_slices = 24;
+  // Attenuation below which a point light is considered to have no effect.
+  constexpr f32 light_cutoff = 1.0f / 256.0f;
+
+  static anton::Array<Point_Light_Data> point_lights;
+  // View space bounds of point_lights and their clusters.
+  static anton::Array<Bounding_Sphere> light_bounds;
+  static Light_Clusters light_clusters;
+  static GPU_Buffer gpu_point_lights_buffer;
+  static GPU_Buffer gpu_cluster_ranges_buffer;
+  static GPU_Buffer gpu_cluster_lights_buffer;
+
   static GPU_Buffer gpu_vertex_buffer;
   static Buffer<Vertex> vertex_buffer;
   static GPU_Buffer gpu_persistent_vertex_buffer;
@@ -129,6 +157,20 @@ namespace anton_engine::rendering {
   static GPU_Buffer gpu_persistent_element_buffer;
   static Buffer<u32> persistent_element_buffer;
 
+  // Number of frames the CPU may be ahead of the GPU. Every transient buffer is
+  // split into that many regions, so writing a frame never overwrites data
+  // that the GPU is still reading.
+  constexpr i64 frames_in_flight = 3;
+
+  static GL_Fence_Backend fence_backend;
+  static GPU_Ring_Buffer* vertex_ring = nullptr;
+  static GPU_Ring_Buffer* element_ring = nullptr;
+  // Shared by matrix_buffer and material_buffer since draws index both with the same draw id.
+  static GPU_Ring_Buffer* draw_data_ring = nullptr;
+  static GPU_Ring_Buffer* draw_cmd_ring = nullptr;
+  static Persistent_Buffer_Allocator* persistent_vertex_allocator = nullptr;
+  static Persistent_Buffer_Allocator* persistent_element_allocator = nullptr;
+
   [[nodiscard]] static bool operator==(Texture_Format lhs, Texture_Format rhs)
   {
     bool const swizzle_equal = lhs.swizzle_mask[0] == rhs.swizzle_mask[0] &&
@@ -164,8 +206,23 @@ namespace anton_engine::rendering {
   // Draw commands buffer
   static anton::Array<Draw_Elements_Command> draw_elements_commands;
 
-  static anton::Flat_Hash_Map<u64, Draw_Elements_Command>
-    persistent_draw_commands_map;
+  struct Persistent_Geometry {
+    Draw_Elements_Command command;
+    // Number of vertices starting at command.base_vertex.
+    u32 vertex_count;
+  };
+
+  static anton::Flat_Hash_Map<u64, Persistent_Geometry> persistent_geometries;
+
+  struct Resident_Mesh {
+    // Handle to the persistent geometry of the mesh.
+    u64 geometry;
+    // Bounds of the mesh in model space.
+    Bounding_Sphere bounds;
+  };
+
+  // Maps values of mesh handles to their resident geometry.
+  static anton::Flat_Hash_Map<u64, Resident_Mesh> resident_meshes;
 
   static u64 get_persistent_geometry_next_handle()
   {
@@ -221,10 +278,11 @@ namespace anton_engine::rendering {
     constexpr u32 buffer_flags =
       GL_MAP_COHERENT_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT;
 
-    // TODO: Synchronisation to prevent buffer races
     // TODO: Hardcoded initial size of the buffers. Make it configurable or computed offline.
 
-    gpu_vertex_buffer.size = 1048576 * sizeof(Vertex);
+    // Transient buffers hold frames_in_flight regions, so every frame has the
+    // full capacity available.
+    gpu_vertex_buffer.size = frames_in_flight * 1048576 * sizeof(Vertex);
     glGenBuffers(1, &gpu_vertex_buffer.handle);
     glBindBuffer(GL_ARRAY_BUFFER, gpu_vertex_buffer.handle);
     glBufferStorage(GL_ARRAY_BUFFER, gpu_vertex_buffer.size, nullptr,
@@ -247,8 +305,8 @@ namespace anton_engine::rendering {
     persistent_vertex_buffer.size =
       gpu_persistent_vertex_buffer.size / sizeof(Vertex);
 
-    gpu_draw_data_buffer.size =
-      65536 * (sizeof(u32) + sizeof(Mat4) + sizeof(Material));
+    gpu_draw_data_buffer.size = frames_in_flight * 65536 *
+                                (sizeof(u32) + sizeof(Mat4) + sizeof(Material));
     glGenBuffers(1, &gpu_draw_data_buffer.handle);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu_draw_data_buffer.handle);
     glBufferStorage(GL_SHADER_STORAGE_BUFFER, gpu_draw_data_buffer.size,
@@ -267,7 +325,7 @@ namespace anton_engine::rendering {
     material_buffer.buffer = material_buffer.head =
       reinterpret_cast<Material*>(matrix_buffer.buffer + matrix_buffer.size);
 
-    gpu_element_buffer.size = 1048576 * sizeof(u32);
+    gpu_element_buffer.size = frames_in_flight * 1048576 * sizeof(u32);
     glGenBuffers(1, &gpu_element_buffer.handle);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu_element_buffer.handle);
     glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, gpu_element_buffer.size, nullptr,
@@ -291,7 +349,8 @@ namespace anton_engine::rendering {
     persistent_element_buffer.size =
       gpu_persistent_element_buffer.size / sizeof(u32);
 
-    gpu_draw_cmd_buffer.size = 65536 * sizeof(Draw_Elements_Command);
+    gpu_draw_cmd_buffer.size =
+      frames_in_flight * 65536 * sizeof(Draw_Elements_Command);
     glGenBuffers(1, &gpu_draw_cmd_buffer.handle);
     glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpu_draw_cmd_buffer.handle);
     glBufferStorage(GL_DRAW_INDIRECT_BUFFER, gpu_draw_cmd_buffer.size, nullptr,
@@ -303,6 +362,19 @@ namespace anton_engine::rendering {
     draw_cmd_buffer.size =
       gpu_draw_cmd_buffer.size / sizeof(Draw_Elements_Command);
 
+    vertex_ring = new GPU_Ring_Buffer(&fence_backend, vertex_buffer.size,
+                                      frames_in_flight);
+    element_ring = new GPU_Ring_Buffer(&fence_backend, element_buffer.size,
+                                       frames_in_flight);
+    draw_data_ring = new GPU_Ring_Buffer(&fence_backend, matrix_buffer.size,
+                                         frames_in_flight);
+    draw_cmd_ring = new GPU_Ring_Buffer(&fence_backend, draw_cmd_buffer.size,
+                                        frames_in_flight);
+    persistent_vertex_allocator = new Persistent_Buffer_Allocator(
+      persistent_vertex_buffer.size, frames_in_flight);
+    persistent_element_allocator = new Persistent_Buffer_Allocator(
+      persistent_element_buffer.size, frames_in_flight);
+
     // Uniforms
 
     glGenBuffers(1, &lighting_data_ubo);
@@ -328,11 +400,31 @@ namespace anton_engine::rendering {
       u8 const pixels[] = {0, 0, 0, 255, 0, 0, 0, 0, 127, 127, 255, 255};
       void const* const pixels_loc[3] = {pixels, pixels + 4, pixels + 8};
       Texture handles[3];
-      load_textures_generate_mipmaps(default_format, 3, pixels_loc, handles);
+      load_textures(default_format, 3, pixels_loc, handles);
       bind_texture(0, handles[0]);
     }
   }
 
+  void begin_frame()
+  {
+    vertex_ring->begin_frame();
+    element_ring->begin_frame();
+    draw_data_ring->begin_frame();
+    draw_cmd_ring->begin_frame();
+    // The rings have waited for the frame that began frames_in_flight frames
+    // ago, so the geometry freed during that frame is no longer read.
+    persistent_vertex_allocator->begin_frame();
+    persistent_element_allocator->begin_frame();
+  }
+
+  void end_frame()
+  {
+    vertex_ring->end_frame();
+    element_ring->end_frame();
+    draw_data_ring->end_frame();
+    draw_cmd_ring->end_frame();
+  }
+
   static i64 buffer_offset(void* head, void* buffer)
   {
     return reinterpret_cast<char*>(head) - reinterpret_cast<char*>(buffer);
@@ -369,22 +461,66 @@ namespace anton_engine::rendering {
                       lighting_data_ubo, 0, sizeof(Lighting_Data));
   }
 
+  // Replace the contents of a storage buffer. The buffer is reallocated with
+  // room to grow when data does not fit.
+  static void write_storage_buffer(GPU_Buffer& buffer, void const* const data,
+                                   i64 const size)
+  {
+    if(buffer.handle == 0 || size > buffer.size) {
+      if(buffer.handle != 0) {
+        glDeleteBuffers(1, &buffer.handle);
+      }
+
+      buffer.size = math::max(math::max(size, 2 * buffer.size), i64(256));
+      glGenBuffers(1, &buffer.handle);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.handle);
+      glBufferStorage(GL_SHADER_STORAGE_BUFFER, buffer.size, nullptr,
+                      GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    if(size > 0) {
+      glNamedBufferSubData(buffer.handle, 0, size, data);
+    }
+  }
+
+  // Returns: Distance at which the attenuation of light drops to light_cutoff.
+  [[nodiscard]] static f32 compute_light_radius(Point_Light_Data const& light)
+  {
+    // Solve intensity / (constant + linear * d + quadratic * d^2) = cutoff.
+    f32 const a = light.attentuation_quadratic;
+    f32 const b = light.attentuation_linear;
+    f32 const c = light.attentuation_constant - light.intensity / light_cutoff;
+    if(c >= 0.0f) {
+      return 0.0f;
+    }
+
+    if(a == 0.0f) {
+      return b > 0.0f ? -c / b : math::infinity;
+    }
+
+    return (-b + math::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+  }
+
   void update_dynamic_lights()
   {
     ECS& ecs = get_ecs();
     // TODO: We load hardcoded environment properties at startup, but they should be modifiable.
-    Lighting_Data lights_data = {
-      {1.0f, 1.0f, 1.0f}, 0.02f, 32.0f, 0, 0, {}, {}};
+    Lighting_Data lights_data = {{1.0f, 1.0f, 1.0f}, 0.02f, 32.0f, 0, 0, {}};
     {
       auto directional_lights = ecs.view<Directional_Light_Component>();
-      lights_data.directional_light_count = directional_lights.size();
       i32 i = 0;
       for(Entity const entity: directional_lights) {
+        // Directional lights are few. Ignore the ones that do not fit.
+        if(i == 16) {
+          break;
+        }
+
         Directional_Light_Component& light = directional_lights.get(entity);
         lights_data.directional_lights[i] = {light.color, light.direction,
                                              light.intensity, 0.8f, 1.0f};
         ++i;
       }
+      lights_data.directional_light_count = i;
     }
     // {
     //     auto spot_lights = ecs.view<Transform, Spot_Light_Component>();
@@ -397,27 +533,75 @@ namespace anton_engine::rendering {
     //     }
     // }
     {
-      auto point_lights = ecs.view<Transform, Point_Light_Component>();
-      lights_data.point_lights_count = point_lights.size();
-      i32 i = 0;
-      for(Entity const entity: point_lights) {
+      auto point_light_view = ecs.view<Transform, Point_Light_Component>();
+      lights_data.point_lights_count = point_light_view.size();
+      point_lights.clear();
+      for(Entity const entity: point_light_view) {
         auto [transform, light] =
-          point_lights.get<Transform, Point_Light_Component>(entity);
+          point_light_view.get<Transform, Point_Light_Component>(entity);
         // TODO: Global attentuation instead of per light. Most likely hardcoded in the shaders
-        lights_data.point_lights[i] = {transform.local_position,
-                                       light.color,
-                                       light.intensity,
-                                       1.0f,
-                                       0.09f,
-                                       0.032f,
-                                       0.8f,
-                                       1.0f};
-        ++i;
+        Point_Light_Data data = {transform.local_position,
+                                 light.color,
+                                 light.intensity,
+                                 1.0f,
+                                 0.09f,
+                                 0.032f,
+                                 0.8f,
+                                 1.0f,
+                                 0.0f};
+        data.radius = compute_light_radius(data);
+        point_lights.push_back(data);
       }
     }
 
     glNamedBufferSubData(lighting_data_ubo, 0, sizeof(Lighting_Data),
                          &lights_data);
+    write_storage_buffer(gpu_point_lights_buffer, point_lights.data(),
+                         point_lights.size() * sizeof(Point_Light_Data));
+  }
+
+  // Bin the point lights into the froxels of the camera and upload the light
+  // lists for the deferred shading pass.
+  static void update_light_clusters(Shader& shader, Mat4 const view_mat,
+                                    Mat4 const projection_mat)
+  {
+    Cluster_Grid const grid = make_cluster_grid(
+      projection_mat, cluster_tiles_x, cluster_tiles_y, cluster_slices);
+    // Distance from the camera to the corners of the far plane.
+    f32 const far_reach =
+      grid.far_plane * math::sqrt(1.0f +
+                                  grid.tan_half_fov_x * grid.tan_half_fov_x +
+                                  grid.tan_half_fov_y * grid.tan_half_fov_y);
+    light_bounds.resize(point_lights.size());
+    for(i64 i = 0; i < point_lights.size(); ++i) {
+      Vec4 const position = view_mat * Vec4(point_lights[i].position, 1.0f);
+      Vec3 const center(position.x, position.y, position.z);
+      // Lights without attenuation have an infinite radius. Clamp it to the
+      // far plane, beyond which no surface is shaded.
+      f32 const radius =
+        math::min(point_lights[i].radius, math::length(center) + far_reach);
+      light_bounds[i] = {center, radius};
+    }
+
+    assign_lights_to_clusters(grid, light_bounds, light_clusters);
+    write_storage_buffer(gpu_cluster_ranges_buffer,
+                         light_clusters.ranges.data(),
+                         light_clusters.ranges.size() * sizeof(u32));
+    write_storage_buffer(gpu_cluster_lights_buffer,
+                         light_clusters.light_indices.data(),
+                         light_clusters.light_indices.size() * sizeof(u32));
+    // Buffers are reallocated when they grow, so they are bound every time.
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, point_lights_binding,
+                     gpu_point_lights_buffer.handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cluster_ranges_binding,
+                     gpu_cluster_ranges_buffer.handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cluster_lights_binding,
+                     gpu_cluster_lights_buffer.handle);
+    shader.set_int("cluster_tiles_x", grid.tiles_x);
+    shader.set_int("cluster_tiles_y", grid.tiles_y);
+    shader.set_int("cluster_slices", grid.slices);
+    shader.set_float("cluster_near", grid.near_plane);
+    shader.set_float("cluster_far", grid.far_plane);
   }
 
   void bind_mesh_vao()
@@ -456,10 +640,66 @@ namespace anton_engine::rendering {
            min_filter == GL_LINEAR_MIPMAP_LINEAR;
   }
 
-  void load_textures_generate_mipmaps(Texture_Format const format,
-                                      i32 const texture_count,
-                                      void const* const* const pixels,
-                                      Texture* const handles)
+  // Returns: Size of a 4x4 block in bytes or 0 if the format is not
+  //          block compressed.
+  [[nodiscard]] static i64 get_block_size(u32 const internal_format)
+  {
+    // The S3TC enums are an extension which the loader might not define.
+    using Compressed_Format = opengl::Compressed_Internal_Format;
+    switch(static_cast<Compressed_Format>(internal_format)) {
+    case Compressed_Format::rgb_s3tc_dxt1:
+    case Compressed_Format::srgb_s3tc_dxt1:
+    case Compressed_Format::rgba_s3tc_dxt1:
+    case Compressed_Format::srgb_alpha_s3tc_dxt1:
+    case Compressed_Format::red_rgtc1:
+    case Compressed_Format::signed_red_rgtc1:
+      return 8;
+    case Compressed_Format::rgba_s3tc_dxt3:
+    case Compressed_Format::srgb_alpha_s3tc_dxt3:
+    case Compressed_Format::rgba_s3tc_dxt5:
+    case Compressed_Format::srgb_alpha_s3tc_dxt5:
+    case Compressed_Format::rg_rgtc2:
+    case Compressed_Format::signed_rg_rgtc2:
+    case Compressed_Format::rgba_bptc_unorm:
+    case Compressed_Format::srgb_alpha_bptc_unorm:
+    case Compressed_Format::rgb_bptc_signed_float:
+    case Compressed_Format::rgb_bptc_unsigned_float:
+      return 16;
+    default:
+      return 0;
+    }
+  }
+
+  [[nodiscard]] static i64 get_pixel_size(Texture_Format const format)
+  {
+    i64 channels = 4;
+    switch(format.pixel_format) {
+    case GL_RED:
+      channels = 1;
+      break;
+    case GL_RG:
+      channels = 2;
+      break;
+    case GL_RGB:
+      channels = 3;
+      break;
+    }
+    return channels * (format.pixel_type == GL_UNSIGNED_SHORT ? 2 : 1);
+  }
+
+  [[nodiscard]] static i64 get_level_size(Texture_Format const format,
+                                          i64 const width, i64 const height)
+  {
+    if(i64 const block_size = get_block_size(format.sized_internal_format);
+       block_size != 0) {
+      return ((width + 3) / 4) * ((height + 3) / 4) * block_size;
+    } else {
+      return width * height * get_pixel_size(format);
+    }
+  }
+
+  void load_textures(Texture_Format const format, i32 const texture_count,
+                     void const* const* const pixels, Texture* const handles)
   {
     i32 texture_index = find_texture_with_format(format);
     if(texture_index == -1) {
@@ -500,10 +740,12 @@ namespace anton_engine::rendering {
                        format.sized_internal_format, format.width,
                        format.height, new_size);
         for(i32 i = 0; i < format.mip_levels; ++i) {
+          i32 const width = math::max(format.width >> i, 1u);
+          i32 const height = math::max(format.height >> i, 1u);
           glCopyImageSubData(textures[texture_index].handle,
                              GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, new_texture,
-                             GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, format.width,
-                             format.height, texture_storage.size);
+                             GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, width, height,
+                             texture_storage.size);
         }
         glDeleteTextures(1, &textures[texture_index].handle);
         textures[texture_index].handle = new_texture;
@@ -515,100 +757,150 @@ namespace anton_engine::rendering {
       }
     }
 
+    // Rows of small levels are not padded to 4 bytes.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    bool const compressed = get_block_size(format.sized_internal_format) != 0;
     Array_Texture_Storage& texture_storage = textures_storage[texture_index];
     for(i32 i = 0; i < texture_count; ++i) {
       i32 const unused_texture = texture_storage.free_list[i];
-      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, unused_texture,
-                      format.width, format.height, 1, format.pixel_format,
-                      format.pixel_type, pixels[i]);
+      u8 const* level_pixels = static_cast<u8 const*>(pixels[i]);
+      for(i32 level = 0; level < format.mip_levels; ++level) {
+        i32 const width = math::max(format.width >> level, 1u);
+        i32 const height = math::max(format.height >> level, 1u);
+        i64 const level_size = get_level_size(format, width, height);
+        if(compressed) {
+          glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0,
+                                    unused_texture, width, height, 1,
+                                    format.sized_internal_format, level_size,
+                                    level_pixels);
+        } else {
+          glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, unused_texture,
+                          width, height, 1, format.pixel_format,
+                          format.pixel_type, level_pixels);
+        }
+        level_pixels += level_size;
+      }
       handles[i].index = texture_index;
       handles[i].layer = unused_texture;
     }
     texture_storage.free_list.erase(texture_storage.free_list.begin(),
                                     texture_storage.free_list.begin() +
                                       texture_count);
-    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
   }
 
   Draw_Elements_Command
   write_geometry(anton::Slice<Vertex const> const vertices,
                  anton::Slice<u32 const> const indices)
   {
-    Draw_Elements_Command cmd = {};
-
-    i64 vert_head_offset = vertex_buffer.head - vertex_buffer.buffer;
-    if(vertex_buffer.size - vert_head_offset < vertices.size()) {
-      vertex_buffer.head = vertex_buffer.buffer;
-      vert_head_offset = 0;
+    i64 const vertex_offset = vertex_ring->allocate(vertices.size());
+    i64 const index_offset = element_ring->allocate(indices.size());
+    if(vertex_offset == -1 || index_offset == -1) {
+      // The region is full. The failure is counted by the ring buffer and
+      // the returned command draws nothing.
+      return {};
     }
-    memcpy(vertex_buffer.head, vertices.data(),
-           vertices.size() * sizeof(Vertex));
-    vertex_buffer.head += vertices.size();
-    cmd.base_vertex = vert_head_offset;
 
-    i64 elem_head_offset = element_buffer.head - element_buffer.buffer;
-    if(element_buffer.size - elem_head_offset < indices.size()) {
-      element_buffer.head = element_buffer.buffer;
-      elem_head_offset = 0;
-    }
-    memcpy(element_buffer.head, indices.data(), indices.size() * sizeof(u32));
-    element_buffer.head += indices.size();
+    memcpy(vertex_buffer.buffer + vertex_offset, vertices.data(),
+           vertices.size() * sizeof(Vertex));
+    memcpy(element_buffer.buffer + index_offset, indices.data(),
+           indices.size() * sizeof(u32));
+    Draw_Elements_Command cmd = {};
     cmd.count = indices.size();
-    cmd.first_index = elem_head_offset;
-
+    cmd.first_index = index_offset;
+    cmd.base_vertex = vertex_offset;
     return cmd;
   }
 
-  u32 write_matrices_and_materials(anton::Slice<Mat4 const> const matrices,
+  i64 write_matrices_and_materials(anton::Slice<Mat4 const> const matrices,
                                    anton::Slice<Material const> const materials)
   {
-    i64 material_head_offset = material_buffer.head - material_buffer.buffer;
-    if(material_buffer.size - material_head_offset < materials.size()) {
-      material_buffer.head = material_buffer.buffer;
-      material_head_offset = 0;
-    }
-    memcpy(material_buffer.head, materials.data(),
-           materials.size() * sizeof(Material));
-    material_buffer.head += materials.size();
-
-    i64 matrix_head_offset = matrix_buffer.head - matrix_buffer.buffer;
-    if(matrix_buffer.size - matrix_head_offset < matrices.size()) {
-      matrix_buffer.head = matrix_buffer.buffer;
-      matrix_head_offset = 0;
+    ANTON_ASSERT(matrices.size() == materials.size(),
+                 "matrices and materials must have the same size");
+    i64 const offset = draw_data_ring->allocate(matrices.size());
+    if(offset == -1) {
+      return -1;
     }
-    memcpy(matrix_buffer.head, matrices.data(), matrices.size() * sizeof(Mat4));
-    matrix_buffer.head += matrices.size();
 
-    return matrix_head_offset;
+    memcpy(matrix_buffer.buffer + offset, matrices.data(),
+           matrices.size() * sizeof(Mat4));
+    memcpy(material_buffer.buffer + offset, materials.data(),
+           materials.size() * sizeof(Material));
+    return offset;
   }
 
   u64 write_persistent_geometry(anton::Slice<Vertex const> const vertices,
                                 anton::Slice<u32 const> const indices)
   {
-    // TODO: Checks, safety, fencing, anything? Right now I'm pretty sure I'll not overwrite,
-    //       but we'll need all of that in the future.
-    i64 const index_offset =
-      persistent_element_buffer.head - persistent_element_buffer.buffer;
     i64 const vertex_offset =
-      persistent_vertex_buffer.head - persistent_vertex_buffer.buffer;
-    if(index_offset + indices.size() > persistent_element_buffer.size ||
-       vertex_offset + vertices.size() > persistent_vertex_buffer.size) {
+      persistent_vertex_allocator->allocate(vertices.size());
+    if(vertex_offset == -1) {
       throw Exception(u8"Out of memory.");
     }
 
-    memcpy(persistent_vertex_buffer.head, vertices.data(),
+    i64 const index_offset =
+      persistent_element_allocator->allocate(indices.size());
+    if(index_offset == -1) {
+      persistent_vertex_allocator->free(vertex_offset, vertices.size());
+      throw Exception(u8"Out of memory.");
+    }
+
+    memcpy(persistent_vertex_buffer.buffer + vertex_offset, vertices.data(),
            vertices.size() * sizeof(Vertex));
-    persistent_vertex_buffer.head += vertices.size();
-    memcpy(persistent_element_buffer.head, indices.data(),
+    memcpy(persistent_element_buffer.buffer + index_offset, indices.data(),
            indices.size() * sizeof(u32));
-    persistent_element_buffer.head += indices.size();
     Draw_Elements_Command cmd = {(u32)indices.size(), 0, (u32)index_offset,
                                  (u32)vertex_offset, 0};
     u64 const handle = get_persistent_geometry_next_handle();
-    persistent_draw_commands_map.emplace(handle, cmd);
+    persistent_geometries.emplace(
+      handle, Persistent_Geometry{cmd, (u32)vertices.size()});
     return handle;
   }
 
+  void free_persistent_geometry(u64 const handle)
+  {
+    auto iter = persistent_geometries.find(handle);
+    if(iter == persistent_geometries.end()) {
+      return;
+    }
+
+    Persistent_Geometry const& geometry = iter->value;
+    persistent_vertex_allocator->free(geometry.command.base_vertex,
+                                      geometry.vertex_count);
+    persistent_element_allocator->free(geometry.command.first_index,
+                                       geometry.command.count);
+    persistent_geometries.erase(iter);
+  }
+
+  u64 make_mesh_resident(Handle<Mesh> const handle, Mesh const& mesh)
+  {
+    auto iter = resident_meshes.find(handle.value);
+    if(iter != resident_meshes.end()) {
+      return iter->value.geometry;
+    }
+
+    u64 const geometry = write_persistent_geometry(mesh.vertices, mesh.indices);
+    Bounding_Sphere const bounds = compute_bounding_sphere(mesh.vertices);
+    resident_meshes.emplace(handle.value, Resident_Mesh{geometry, bounds});
+    return geometry;
+  }
+
+  void evict_mesh(Handle<Mesh> const handle)
+  {
+    auto iter = resident_meshes.find(handle.value);
+    if(iter == resident_meshes.end()) {
+      return;
+    }
+
+    free_persistent_geometry(iter->value.geometry);
+    resident_meshes.erase(iter);
+  }
+
+  void unload_mesh(Handle<Mesh> const handle)
+  {
+    evict_mesh(handle);
+    get_mesh_manager().remove(handle);
+  }
+
   static void bind_default_textures()
   {
     bind_texture(0, Texture{0, 0});
@@ -639,10 +931,10 @@ namespace anton_engine::rendering {
 
   void add_draw_command(Draw_Persistent_Geometry_Command const cmd)
   {
-    auto iter = persistent_draw_commands_map.find(cmd.handle);
-    ANTON_ASSERT(iter != persistent_draw_commands_map.end(),
+    auto iter = persistent_geometries.find(cmd.handle);
+    ANTON_ASSERT(iter != persistent_geometries.end(),
                  "Persistent draw command was not added prior to its use.");
-    Draw_Elements_Command draw_cmd = iter->value;
+    Draw_Elements_Command draw_cmd = iter->value.command;
     draw_cmd.base_instance = cmd.base_instance;
     draw_cmd.instance_count = cmd.instance_count;
     add_draw_command(draw_cmd);
@@ -651,62 +943,173 @@ namespace anton_engine::rendering {
   void commit_draw()
   {
     if(draw_elements_commands.size() > 0) {
-      if(draw_cmd_buffer.head - draw_cmd_buffer.buffer +
-           draw_elements_commands.size() >
-         draw_cmd_buffer.size) {
-        draw_cmd_buffer.head = draw_cmd_buffer.buffer;
+      i64 const offset = draw_cmd_ring->allocate(draw_elements_commands.size());
+      if(offset == -1) {
+        // The region is full. Drop the draws, the failure is counted by the
+        // ring buffer.
+        draw_elements_commands.clear();
+        return;
       }
 
-      memcpy(draw_cmd_buffer.head, draw_elements_commands.data(),
+      memcpy(draw_cmd_buffer.buffer + offset, draw_elements_commands.data(),
              draw_elements_commands.size() * sizeof(Draw_Elements_Command));
-      i64 const offset = (draw_cmd_buffer.head - draw_cmd_buffer.buffer) *
-                         sizeof(Draw_Elements_Command);
-      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset,
-                                  draw_elements_commands.size(),
-                                  sizeof(Draw_Elements_Command));
-      draw_cmd_buffer.head += draw_elements_commands.size();
+      glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        (void*)(offset * sizeof(Draw_Elements_Command)),
+        draw_elements_commands.size(), sizeof(Draw_Elements_Command));
       draw_elements_commands.clear();
     }
   }
 
-  void render_scene(ECS snapshot, Transform const camera_transform,
+  static Render_Scene extracted_scene;
+  static World_Matrix_Cache world_matrix_cache;
+
+  Render_Scene& extract_scene(ECS& ecs)
+  {
+    Render_Scene& scene = extracted_scene;
+    update_world_matrices(ecs, world_matrix_cache);
+    auto objects = ecs.group<Static_Mesh_Component, World_Matrix>();
+    Static_Mesh_Component const* const meshes =
+      objects.components<Static_Mesh_Component>();
+    World_Matrix const* const world_matrices =
+      objects.components<World_Matrix>();
+    scene.meshes.resize(objects.size());
+    scene.matrices.resize(objects.size());
+    scene.bounds.resize(objects.size());
+    parallel_for(objects.size(), 1024, [&](i64 const first, i64 const last) {
+      for(i64 i = first; i < last; ++i) {
+        scene.meshes[i] = meshes[i];
+        scene.matrices[i] = world_matrices[i].matrix;
+        auto iter = resident_meshes.find(meshes[i].mesh_handle.value);
+        if(iter != resident_meshes.end()) {
+          scene.bounds[i] =
+            transform_bounding_sphere(iter->value.bounds, scene.matrices[i]);
+        } else {
+          // Bounds are not known until the mesh becomes resident, never cull it.
+          scene.bounds[i] = {Vec3(0.0f), math::infinity};
+        }
+      }
+    });
+    return scene;
+  }
+
+  void generate_draw_data(Render_Scene const& scene,
+                          anton::Slice<Draw_Batch const> const batches,
+                          u32 const base_instance, Mat4* const matrices,
+                          Material* const materials,
+                          Draw_Elements_Command* const commands)
+  {
+    if(batches.size() == 0) {
+      return;
+    }
+
+    i64 const first_object = batches[0].first;
+    Draw_Batch const& last_batch = batches[batches.size() - 1];
+    i64 const object_count = last_batch.first + last_batch.count - first_object;
+    parallel_for(object_count, 1024, [&](i64 const first, i64 const last) {
+      // Find the batch containing the first object of the chunk.
+      i64 batch = 0;
+      i64 batch_last = batches.size();
+      while(batch + 1 < batch_last) {
+        i64 const middle = (batch + batch_last) / 2;
+        if(batches[middle].first - first_object <= first) {
+          batch = middle;
+        } else {
+          batch_last = middle;
+        }
+      }
+
+      for(i64 i = first; i < last; ++i) {
+        Draw_Batch const* current = &batches[batch];
+        if(current->first + current->count - first_object <= i) {
+          batch += 1;
+          current = &batches[batch];
+        }
+
+        // The chunk containing the first object of a batch writes its command.
+        if(current->first - first_object == i) {
+          Draw_Elements_Command cmd = current->command;
+          cmd.instance_count = current->count;
+          cmd.base_instance = base_instance + i;
+          commands[batch] = cmd;
+        }
+
+        u32 const object = scene.draw_order[first_object + i];
+        matrices[i] = scene.matrices[object];
+        materials[i] = current->material;
+      }
+    });
+  }
+
+  void render_scene(Render_Scene& scene, Transform const camera_transform,
                     Mat4 const view, Mat4 const projection)
   {
-    snapshot.sort<Static_Mesh_Component>(
-      [](auto begin, auto end, auto predicate) {
-        std::sort(begin, end, predicate);
-      },
-      [](Static_Mesh_Component const lhs,
-         Static_Mesh_Component const rhs) -> bool {
-        return lhs.shader_handle < rhs.shader_handle ||
-               (lhs.shader_handle == rhs.shader_handle &&
-                lhs.material_handle < rhs.material_handle) ||
-               (lhs.shader_handle == rhs.shader_handle &&
-                lhs.material_handle == rhs.material_handle &&
-                lhs.mesh_handle < rhs.mesh_handle);
-      });
-
-    // snapshot.respect<Static_Mesh_Component, Transform>();
-    bind_default_textures();
-    bind_mesh_vao();
-    bind_buffers();
-    bind_transient_geometry_buffers();
-    auto objects = snapshot.view<Static_Mesh_Component, Transform>();
-    Static_Mesh_Component last_mesh = {};
+    scene.draw_order.resize(scene.meshes.size());
+    Frustum const frustum = make_frustum(projection * view);
+    i64 const object_count =
+      cull_spheres(frustum, scene.bounds, scene.draw_order.data());
+    scene.draw_order.resize(object_count);
+    scene.draw_keys.resize(object_count);
+    parallel_for(object_count, 4096, [&](i64 const first, i64 const last) {
+      for(i64 i = first; i < last; ++i) {
+        u32 const object = scene.draw_order[i];
+        scene.draw_keys[i] = make_draw_key(scene.meshes[object]);
+      }
+    });
+    radix_sort(scene.draw_keys, scene.draw_order, scene.sort_scratch);
+
     Resource_Manager<Shader>& shader_manager = get_shader_manager();
     Resource_Manager<Material>& material_manager = get_material_manager();
     Resource_Manager<Mesh>& mesh_manager = get_mesh_manager();
 
+    // Group objects sharing shader, mesh and material into batches.
+    // A batch never has more objects than fit in a region of the draw data.
+    i64 const max_segment_objects = draw_data_ring->get_region_size();
+    i64 const max_segment_batches = draw_cmd_ring->get_region_size();
+    scene.batches.clear();
+    Static_Mesh_Component last_mesh = {};
+    for(i64 i = 0; i < object_count; ++i) {
+      Static_Mesh_Component const& static_mesh =
+        scene.meshes[scene.draw_order[i]];
+      if(i != 0 && static_mesh.shader_handle == last_mesh.shader_handle &&
+         static_mesh.mesh_handle == last_mesh.mesh_handle &&
+         static_mesh.material_handle == last_mesh.material_handle &&
+         scene.batches[scene.batches.size() - 1].count < max_segment_objects) {
+        scene.batches[scene.batches.size() - 1].count += 1;
+        continue;
+      }
+
+      // Meshes that were not made resident at load time are uploaded on first use.
+      Mesh const& mesh = mesh_manager.get(static_mesh.mesh_handle);
+      u64 const geometry = make_mesh_resident(static_mesh.mesh_handle, mesh);
+      Draw_Batch batch;
+      batch.shader = static_mesh.shader_handle;
+      batch.material = material_manager.get(static_mesh.material_handle);
+      batch.command = persistent_geometries.find(geometry)->value.command;
+      batch.first = i;
+      batch.count = 1;
+      scene.batches.push_back(batch);
+      last_mesh = static_mesh;
+    }
+
+    bind_default_textures();
+    bind_mesh_vao();
+    bind_buffers();
+    bind_persistent_geometry_buffers();
+
     struct Bound_Texture {
       u32 index = 0;
       i64 draw = -1;
     };
 
-    auto find_slot_and_bind_texture = [](Bound_Texture bound_textures[16],
-                                         Texture const texture,
-                                         i64 const current_draw) -> u32 {
+    // Slots bound at or after segment_draw are used by the batches of the
+    // current segment and must not be evicted until the segment is drawn.
+    auto find_slot_and_bind_texture =
+      [](Bound_Texture bound_textures[16], Texture const texture,
+         i64 const current_draw, i64 const segment_draw) -> u32 {
       for(i32 i = 0; i < 16; ++i) {
         if(bound_textures[i].index == texture.index) {
+          bound_textures[i].draw = current_draw;
           return i;
         }
       }
@@ -718,86 +1121,113 @@ namespace anton_engine::rendering {
           bind_texture(i, texture);
           bound_textures[i] = Bound_Texture{texture.index, current_draw};
           return i;
-        } else if(bound_textures[i].draw > max_draw) {
+        } else if(bound_textures[i].draw < segment_draw &&
+                  bound_textures[i].draw > max_draw) {
           max_draw_index = i;
           max_draw = bound_textures[i].draw;
         }
       }
 
+      ANTON_ASSERT(max_draw_index != 0, "no texture slot can be evicted");
       bind_texture(max_draw_index, texture);
       bound_textures[max_draw_index] =
         Bound_Texture{texture.index, current_draw};
       return max_draw_index;
     };
 
-    Bound_Texture bound_textures[16] = {};
-    i64 current_draw = 0;
-    Draw_Elements_Command cmd = {};
-    // TODO: wrap around, write_geometry functions, etc.
-    // Fairly dumb rendering loop.
-    for(auto iter = objects.begin(), end = objects.end(); iter != end; ++iter) {
-      auto const [transform, static_mesh] =
-        objects.get<Transform, Static_Mesh_Component>(*iter);
-      if(static_mesh.shader_handle != last_mesh.shader_handle ||
-         static_mesh.mesh_handle != last_mesh.mesh_handle ||
-         static_mesh.material_handle != last_mesh.material_handle) {
-        if(ANTON_LIKELY(current_draw != 0)) {
-          add_draw_command(cmd);
+    // Whether the textures of material can be bound without evicting a slot
+    // used by the current segment.
+    auto textures_fit = [](Bound_Texture const bound_textures[16],
+                           Material const& material,
+                           i64 const segment_draw) -> bool {
+      u32 const textures[3] = {material.diffuse_texture.index,
+                               material.specular_texture.index,
+                               material.normal_map.index};
+      i32 required_slots = 0;
+      for(i32 t = 0; t < 3; ++t) {
+        bool bound = false;
+        for(i32 i = 0; i < 16; ++i) {
+          bound = bound || bound_textures[i].index == textures[t];
         }
-        cmd.instance_count = 1;
-      } else {
-        cmd.instance_count += 1;
-      }
-
-      if(static_mesh.shader_handle != last_mesh.shader_handle) {
-        if(ANTON_LIKELY(current_draw != 0)) {
-          commit_draw();
+        for(i32 i = 0; i < t; ++i) {
+          bound = bound || textures[i] == textures[t];
         }
-        Shader& shader = shader_manager.get(static_mesh.shader_handle);
-        shader.use();
-        shader.set_vec3("camera.position", camera_transform.local_position);
-        shader.set_mat4("projection", projection);
-        shader.set_mat4("view", view);
+        required_slots += !bound;
       }
 
-      if(static_mesh.mesh_handle != last_mesh.mesh_handle) {
-        Mesh const& mesh = mesh_manager.get(static_mesh.mesh_handle);
-        cmd = write_geometry(mesh.vertices, mesh.indices);
-        cmd.instance_count = 1;
-        cmd.base_instance = current_draw;
+      i32 available_slots = 0;
+      for(i32 i = 1; i < 16; ++i) {
+        available_slots += bound_textures[i].draw < segment_draw;
       }
+      return required_slots <= available_slots;
+    };
 
-      {
-        // TODO: Does pointless calls to find_slot_and_bind_texture even though
-        //       it doesn't actually rebind textures each iteration.
-        //
-        // Skip first texture slot since it should always have the default textures bound
-        Material const mat = material_manager.get(static_mesh.material_handle);
-        Material materials[1] = {mat};
-        materials[0].diffuse_texture.index = find_slot_and_bind_texture(
-          bound_textures, mat.diffuse_texture, current_draw);
-        materials[0].specular_texture.index = find_slot_and_bind_texture(
-          bound_textures, mat.specular_texture, current_draw);
-        materials[0].normal_map.index = find_slot_and_bind_texture(
-          bound_textures, mat.normal_map, current_draw);
-        Mat4 const matrices[1] = {to_matrix(transform)};
-        [[maybe_unused]] u32 const base_instance =
-          write_matrices_and_materials(matrices, materials);
-        if(static_mesh.shader_handle != last_mesh.shader_handle ||
-           static_mesh.mesh_handle != last_mesh.mesh_handle ||
-           static_mesh.material_handle != last_mesh.material_handle) {
-          cmd.base_instance = base_instance;
+    // Skip first texture slot since it should always have the default textures bound
+    Bound_Texture bound_textures[16] = {};
+    i64 const batch_count = scene.batches.size();
+    i64 segment_first = 0;
+    // Every run of batches using the same shader is generated on the job pool
+    // and drawn with a single multi draw call. A run is split when its
+    // textures do not fit in the texture slots or its draw data does not fit
+    // in a region of the ring buffers.
+    while(segment_first < batch_count) {
+      Handle<Shader> const shader_handle =
+        scene.batches[segment_first].shader;
+      i64 const segment_draw = scene.batches[segment_first].first;
+      i64 segment_last = segment_first;
+      for(; segment_last < batch_count &&
+            scene.batches[segment_last].shader == shader_handle;
+          ++segment_last) {
+        Draw_Batch& batch = scene.batches[segment_last];
+        Material& material = batch.material;
+        if(segment_last != segment_first &&
+           (batch.first + batch.count - segment_draw > max_segment_objects ||
+            segment_last - segment_first == max_segment_batches ||
+            !textures_fit(bound_textures, material, segment_draw))) {
+          break;
         }
+
+        material.diffuse_texture.index = find_slot_and_bind_texture(
+          bound_textures, material.diffuse_texture, batch.first, segment_draw);
+        material.specular_texture.index = find_slot_and_bind_texture(
+          bound_textures, material.specular_texture, batch.first,
+          segment_draw);
+        material.normal_map.index = find_slot_and_bind_texture(
+          bound_textures, material.normal_map, batch.first, segment_draw);
       }
 
-      last_mesh = static_mesh;
-      current_draw += 1;
-    }
+      Shader& shader = shader_manager.get(shader_handle);
+      shader.use();
+      shader.set_vec3("camera.position", camera_transform.local_position);
+      shader.set_mat4("projection", projection);
+      shader.set_mat4("view", view);
+
+      anton::Slice<Draw_Batch const> const batches(
+        scene.batches.data() + segment_first,
+        scene.batches.data() + segment_last);
+      Draw_Batch const& last_batch = scene.batches[segment_last - 1];
+      i64 const segment_objects =
+        last_batch.first + last_batch.count - batches[0].first;
+      i64 const draw_data_offset = draw_data_ring->allocate(segment_objects);
+      i64 const commands_offset =
+        draw_cmd_ring->allocate(segment_last - segment_first);
+      if(draw_data_offset == -1 || commands_offset == -1) {
+        // The region has been used up by earlier draws in this frame. Drop
+        // the segment, the failure is counted by the ring buffers.
+        segment_first = segment_last;
+        continue;
+      }
 
-    // Since there's no state change at the end of the loop we have to
-    // add the last draw command and kick rendering off manually.
-    add_draw_command(cmd);
-    commit_draw();
+      generate_draw_data(scene, batches, draw_data_offset,
+                         matrix_buffer.buffer + draw_data_offset,
+                         material_buffer.buffer + draw_data_offset,
+                         draw_cmd_buffer.buffer + commands_offset);
+      glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        (void*)(commands_offset * sizeof(Draw_Elements_Command)),
+        segment_last - segment_first, sizeof(Draw_Elements_Command));
+      segment_first = segment_last;
+    }
   }
 
   Renderer::Renderer(i32 width, i32 height)
@@ -863,8 +1293,8 @@ namespace anton_engine::rendering {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     ECS& ecs = get_ecs();
-    ECS snapshot = ecs.snapshot<Transform, Static_Mesh_Component>();
-    render_scene(snapshot, camera_transform, view_mat, projection_mat);
+    Render_Scene& scene = extract_scene(ecs);
+    render_scene(scene, camera_transform, view_mat, projection_mat);
 
     // Postprocessing
 
@@ -882,6 +1312,7 @@ namespace anton_engine::rendering {
     deferred_shading.set_vec2("viewport_size", viewport_size);
     deferred_shading.set_mat4("inv_view_mat", to_matrix(camera_transform));
     deferred_shading.set_mat4("inv_proj_mat", math::inverse(projection_mat));
+    update_light_clusters(deferred_shading, view_mat, projection_mat);
     render_texture_quad();
     glEnable(GL_DEPTH_TEST);
     swap_postprocess_buffers();
@@ -9,6 +9,26 @@ namespace anton_engine {
     u64 value = static_cast<u64>(-1);
   };
 
+  // Handles store the index of the referenced slot in the lower 32 bits
+  // and the generation of the slot in the upper 32 bits.
+  [[nodiscard]] constexpr u64 handle_value(u64 const index,
+                                           u64 const generation)
+  {
+    return (generation << 32) | (index & 0xFFFFFFFF);
+  }
+
+  template<typename T>
+  [[nodiscard]] constexpr u64 handle_index(Handle<T> const handle)
+  {
+    return handle.value & 0xFFFFFFFF;
+  }
+
+  template<typename T>
+  [[nodiscard]] constexpr u64 handle_generation(Handle<T> const handle)
+  {
+    return (handle.value >> 32) & 0xFFFFFFFF;
+  }
+
   template<typename T>
   [[nodiscard]] constexpr bool operator==(Handle<T> lhs, Handle<T> rhs)
   {
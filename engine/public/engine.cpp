@@ -138,6 +138,9 @@ namespace anton_engine {
   static void init()
   {
     init_time();
+    init_jobs();
+    assets::mount_asset_pack(
+      anton::fs::concat_paths(paths::assets_directory(), u8"assets.gepack"));
     windowing::init();
     windowing::enable_vsync(true);
     main_window = windowing::create_window(1280, 720, true);
@@ -296,10 +299,10 @@ namespace anton_engine {
 
       // Texture_Format const format = create_noise_texture(pixels);
       Texture_Format const format =
-        assets::load_texture_no_mipmaps("barrel_texture", 0, pixels);
+        assets::load_texture("barrel_texture", 0, pixels);
       Texture handle;
       void* pix_data = pixels.data();
-      rendering::load_textures_generate_mipmaps(format, 1, &pix_data, &handle);
+      rendering::load_textures(format, 1, &pix_data, &handle);
       barrel_mat.diffuse_texture = handle;
       barrel_mat.specular_texture = Texture::default_black;
       barrel_mat.normal_map = Texture::default_normal_map;
@@ -309,6 +312,8 @@ namespace anton_engine {
     Handle<Mesh> const box_handle = mesh_manager->add(ANTON_MOV(container));
 
     Handle<Mesh> const quad_mesh = mesh_manager->add(generate_plane());
+    rendering::make_mesh_resident(box_handle, mesh_manager->get(box_handle));
+    rendering::make_mesh_resident(quad_mesh, mesh_manager->get(quad_mesh));
 
     if constexpr(DESERIALIZE) {
       // std::filesystem::path serialization_in_path = utils::concat_paths(paths::project_directory(), "ecs.bin");
@@ -392,6 +397,8 @@ namespace anton_engine {
 
   static void terminate()
   {
+    terminate_jobs();
+    assets::unmount_asset_pack();
     delete renderer;
     renderer = nullptr;
     unload_builtin_shaders();
@@ -422,9 +429,8 @@ namespace anton_engine {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     rendering::bind_mesh_vao();
     ECS& ecs = Engine::get_ecs();
-    ECS snapshot = ecs.snapshot<Transform, Static_Mesh_Component>();
-    rendering::render_scene(snapshot, camera_transform, view_mat,
-                            projection_mat);
+    rendering::Render_Scene& scene = rendering::extract_scene(ecs);
+    rendering::render_scene(scene, camera_transform, view_mat, projection_mat);
 
     // Postprocessing
 
@@ -466,6 +472,8 @@ namespace anton_engine {
     update_systems();
     execute_jobs();
 
+    rendering::begin_frame();
+
     // TODO make this rendering code great again (not that it ever was great, but still)
     rendering::update_dynamic_lights();
     auto cameras = ecs->view<Camera, Transform>();
@@ -494,6 +502,7 @@ namespace anton_engine {
       }
     }
 
+    rendering::end_frame();
     windowing::swap_buffers(main_window);
   }
 
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <anton/slice.hpp>
+#include <anton/string_view.hpp>
+#include <core/types.hpp>
+
+namespace anton_engine {
+  // Asset packs store imported assets in a single file that is memory mapped
+  // as a whole. The file begins with an index sorted by (type, name_hash, guid)
+  // that is binary searched to find assets, so loading an asset does not read
+  // anything besides its own data.
+  //
+  // Layout (little endian):
+  //   Asset_Pack_Header
+  //   Asset_Pack_Entry[entry_count]
+  //   data of the assets, each aligned to asset_pack_alignment bytes
+  //
+  // The data of an asset is the same as in the loose asset file:
+  //   mesh - the record following the guid in a .mesh file
+  //   texture - the chunk following the identifier in a .getex file
+
+  // "GEPACK01"
+  constexpr u64 asset_pack_magic = 0x31304B4341504547;
+  constexpr i64 asset_pack_alignment = 16;
+
+  enum class Asset_Type : u32 {
+    mesh = 0,
+    texture = 1,
+  };
+
+  struct Asset_Pack_Header {
+    u64 magic;
+    u64 entry_count;
+  };
+
+  struct Asset_Pack_Entry {
+    Asset_Type type;
+    u32 reserved;
+    // Hash of the name of the loose file the asset was stored in
+    // without the extension. See hash_asset_name.
+    u64 name_hash;
+    u64 guid;
+    // Offset of the data from the beginning of the file.
+    u64 offset;
+    u64 size;
+  };
+
+  // FNV-1a hash of name.
+  [[nodiscard]] constexpr u64 hash_asset_name(char8 const* name, i64 size);
+
+  class Asset_Pack {
+  public:
+    Asset_Pack() = default;
+    Asset_Pack(Asset_Pack const&) = delete;
+    Asset_Pack& operator=(Asset_Pack const&) = delete;
+    ~Asset_Pack();
+
+    // Map the pack at path into memory. Closes the currently open pack.
+    // Throws Exception if the file is not a valid asset pack.
+    // Returns: false if the file could not be opened.
+    bool open(anton::String_View path);
+    void close();
+
+    [[nodiscard]] bool is_open() const;
+
+    // Returns: Data of the asset or an empty slice if the pack does not
+    //          contain the asset.
+    [[nodiscard]] anton::Slice<u8 const> find(Asset_Type type, u64 name_hash,
+                                              u64 guid) const;
+
+  private:
+    u8 const* data = nullptr;
+    i64 size = 0;
+    Asset_Pack_Entry const* entries = nullptr;
+    i64 entry_count = 0;
+  };
+} // namespace anton_engine
+
+namespace anton_engine {
+  constexpr u64 hash_asset_name(char8 const* const name, i64 const size)
+  {
+    u64 hash = 0xCBF29CE484222325;
+    for(i64 i = 0; i < size; ++i) {
+      hash ^= static_cast<u8>(name[i]);
+      hash *= 0x100000001B3;
+    }
+    return hash;
+  }
+} // namespace anton_engine
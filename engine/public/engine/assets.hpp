@@ -10,6 +10,12 @@ namespace anton_engine {
   class Mesh;
 
   namespace assets {
+    // Map the asset pack at path. Assets found in the pack are loaded from it
+    // instead of the loose asset files.
+    // Returns: false if the file does not exist.
+    bool mount_asset_pack(anton::String_View path);
+    void unmount_asset_pack();
+
     // Reads file as a string of chars without interpreting it
     anton::String read_file_raw_string(anton::String_View filename);
 
@@ -18,10 +24,10 @@ namespace anton_engine {
 
     Shader_Stage load_shader_stage(anton::String_View path);
 
-    // Loads texture pixels
-    Texture_Format load_texture_no_mipmaps(anton::String_View filename,
-                                           u64 texture_id,
-                                           anton::Array<u8>& pixels);
+    // Loads texture pixels of all mip levels stored one after another
+    // starting with the base level.
+    Texture_Format load_texture(anton::String_View filename, u64 texture_id,
+                                anton::Array<u8>& pixels);
 
     Mesh load_mesh(anton::String_View filename, u64 guid);
   } // namespace assets
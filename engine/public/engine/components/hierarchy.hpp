@@ -1,17 +1,75 @@
 #pragma once
 
+#include <anton/array.hpp>
 #include <anton/fixed_array.hpp>
 #include <core/class_macros.hpp>
+#include <core/serialization/archives/binary.hpp>
 #include <core/serialization/serialization.hpp>
+#include <core/types.hpp>
 #include <engine/ecs/entity.hpp>
 
 namespace anton_engine {
+  class ECS;
+
+  // Children are not stored, so an entity may have any number of them.
+  // They are found by build_hierarchy_levels.
   class COMPONENT Hierarchy {
   public:
-    Entity parent;
-    // TODO: Right now supports only 16 children.
-    anton::Fixed_Array<Entity, 16> children;
+    // null_entity for roots.
+    Entity parent = null_entity;
+  };
+
+  // Hierarchy used to store up to 16 children after the parent. The space is
+  // still written and skipped on read, so that the format does not change.
+  using Hierarchy_Legacy_Children = anton::Fixed_Array<Entity, 16>;
+
+  inline void serialize(serialization::Binary_Output_Archive& out,
+                        Hierarchy const& hierarchy)
+  {
+    out.write(hierarchy.parent);
+    out.write(Hierarchy_Legacy_Children());
+  }
+
+  inline void deserialize(serialization::Binary_Input_Archive& in,
+                          Hierarchy& hierarchy)
+  {
+    in.read(hierarchy.parent);
+    Hierarchy_Legacy_Children children;
+    in.read(children);
+  }
+
+  // Entities that have a parent sorted by depth, so that parents precede their
+  // children and the nodes of one level do not depend on each other.
+  class Hierarchy_Levels {
+  public:
+    anton::Array<Entity> entities;
+    // Position of the parent in entities or -1 if the parent is a root.
+    anton::Array<i64> parents;
+    // Level l occupies [offsets[l], offsets[l + 1]) in entities.
+    // Level 0 holds the children of roots.
+    anton::Array<i64> offsets;
+
+    // Scratch of build_hierarchy_levels. Indexed by the positions of the nodes
+    // in the Hierarchy container.
+    anton::Array<i64> parent_indices;
+    anton::Array<i64> depths;
+    anton::Array<i64> path;
+    anton::Array<i64> cursors;
+    anton::Array<i64> positions;
   };
-} // namespace anton_engine
 
-ANTON_DEFAULT_SERIALIZABLE(anton_engine::Hierarchy)
+  // Attach child to parent or detach it when parent is null_entity.
+  // The local transform of child becomes relative to the new parent.
+  // Hierarchy::parent must be changed only through set_parent, which marks
+  // the structure of ecs as changed.
+  void set_parent(ECS& ecs, Entity child, Entity parent);
+
+  // Detach entities whose parents have been destroyed, so that they become
+  // roots, and mark their transforms dirty. Marks the structure of ecs as
+  // changed if any entity has been detached.
+  void detach_orphans(ECS& ecs);
+
+  // Flatten the hierarchy of entities in ecs into levels.
+  // Throws Exception if the hierarchy contains a cycle.
+  void build_hierarchy_levels(ECS& ecs, Hierarchy_Levels& levels);
+} // namespace anton_engine
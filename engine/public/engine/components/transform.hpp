@@ -5,23 +5,31 @@
 #include <anton/math/transform.hpp>
 #include <anton/math/vec3.hpp>
 #include <core/class_macros.hpp>
+#include <core/serialization/archives/binary.hpp>
 #include <core/serialization/serialization.hpp>
 
 namespace anton_engine {
   class COMPONENT Transform {
   public:
+    // Local members are relative to the parent in the Hierarchy.
     Quat local_rotation;
     Vec3 local_position;
     Vec3 local_scale = Vec3{1.0f, 1.0f, 1.0f};
+    // Whether the cached World_Matrix has to be recomputed.
+    // Set by translate, rotate and scale. Code that writes the local_* members
+    // directly must set it too.
+    bool dirty = true;
 
     void translate(Vec3 const& translation_vec)
     {
       local_position += translation_vec;
+      dirty = true;
     }
 
     void scale(Vec3 const& scale_vec)
     {
       local_scale *= scale_vec;
+      dirty = true;
     }
 
     // axis to rotate about
@@ -32,6 +40,7 @@ namespace anton_engine {
       Quat q(axis.x * half_angle_sin, axis.y * half_angle_sin,
              axis.z * half_angle_sin, math::cos(angle / 2));
       local_rotation = q * local_rotation;
+      dirty = true;
     }
 
     Mat4 to_matrix() const
@@ -48,6 +57,23 @@ namespace anton_engine {
                math::translate(t.local_position);
     return mat;
   }
-} // namespace anton_engine
 
-ANTON_DEFAULT_SERIALIZABLE(anton_engine::Transform)
+  // dirty is not serialized, so that the format stays the same as before the
+  // flag was added. Deserialized transforms are dirty.
+  inline void serialize(serialization::Binary_Output_Archive& out,
+                        Transform const& transform)
+  {
+    out.write(transform.local_rotation);
+    out.write(transform.local_position);
+    out.write(transform.local_scale);
+  }
+
+  inline void deserialize(serialization::Binary_Input_Archive& in,
+                          Transform& transform)
+  {
+    in.read(transform.local_rotation);
+    in.read(transform.local_position);
+    in.read(transform.local_scale);
+    transform.dirty = true;
+  }
+} // namespace anton_engine
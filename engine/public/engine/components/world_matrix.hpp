@@ -0,0 +1,59 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <anton/math/mat4.hpp>
+#include <core/class_macros.hpp>
+#include <core/serialization/serialization.hpp>
+#include <core/types.hpp>
+#include <engine/components/hierarchy.hpp>
+#include <engine/ecs/entity.hpp>
+
+namespace anton_engine {
+  class ECS;
+  class Transform;
+
+  // Cached matrix of a Transform combined with the matrices of its ancestors
+  // in the Hierarchy. Kept up to date by update_world_matrices.
+  class COMPONENT World_Matrix {
+  public:
+    Mat4 matrix;
+  };
+
+  // Components of a node of the hierarchy gathered when the hierarchy is
+  // built, so that the levels are walked linearly without lookups.
+  struct Hierarchy_Node {
+    // nullptr if the node has no Transform.
+    Transform* transform;
+    World_Matrix* world_matrix;
+    // nullptr if the parent has no World_Matrix.
+    World_Matrix const* parent_matrix;
+    // nullptr if the parent has no Transform. Only used for the children of
+    // roots.
+    Transform const* parent_transform;
+  };
+
+  // Hierarchy flattened by update_world_matrices and kept between updates.
+  // It is rebuilt only when the structure version of the ECS changes.
+  // One cache must not be shared by concurrent updates.
+  class World_Matrix_Cache {
+  public:
+    Hierarchy_Levels levels;
+    // Parallel to levels.entities.
+    anton::Array<Hierarchy_Node> nodes;
+    // Structure version of the ECS the cache has been built from.
+    u64 structure_version = -1;
+    // Scratch space of the update.
+    anton::Array<Entity> dirty;
+    anton::Array<Entity> dirty_roots;
+    anton::Array<u8> changed;
+  };
+
+  // Recompute the World_Matrix of every entity whose Transform is dirty or
+  // whose ancestor's Transform is dirty and clear the dirty flags. Entities
+  // with a Transform but without a World_Matrix get one on their first update.
+  // Clean transforms cost a single flag check. Children of destroyed entities
+  // are detached and recomputed as roots.
+  void update_world_matrices(ECS& ecs, World_Matrix_Cache& cache);
+} // namespace anton_engine
+
+ANTON_DEFAULT_SERIALIZABLE(anton_engine::World_Matrix)
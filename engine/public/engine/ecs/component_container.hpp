@@ -10,6 +10,8 @@
 
 namespace anton_engine {
   class Component_Container_Base {
+    friend class ECS;
+
   public:
     using size_type = anton::Array<Entity>::size_type;
     using iterator = anton::Array<Entity>::iterator;
@@ -23,6 +25,8 @@ namespace anton_engine {
     [[nodiscard]] iterator end();
     [[nodiscard]] size_type size() const;
     [[nodiscard]] bool has(Entity) const;
+    // Returns: Number of bytes allocated by the sparse array.
+    [[nodiscard]] i64 get_sparse_memory_usage() const;
 
     friend void serialize(serialization::Binary_Output_Archive&,
                           Component_Container_Base const&);
@@ -44,12 +48,24 @@ namespace anton_engine {
     // Sort only entities.
     void sort_entities();
 
+    // Swap two entities and their components in the dense arrays.
+    virtual void swap_positions(size_type lhs, size_type rhs);
+
   private:
-    // Indices into entities array
-    anton::Array<size_type> _indirect;
+    // The sparse array is split into pages of 2^page_shift entries.
+    constexpr static size_type page_shift = 12;
+    constexpr static size_type page_size = 1 << page_shift;
+
+    // Indices into entities array. Pages are allocated on first use, so
+    // containers of rare components only pay for the ranges of entities they hold.
+    anton::Array<anton::Array<size_type>> _indirect;
     anton::Array<Entity> _entities;
 
     [[nodiscard]] size_type indirect_index(Entity entity) const;
+    // Returns: Entry of the sparse array or npos if the page has not been allocated.
+    [[nodiscard]] size_type find_indirect(size_type index) const;
+    // Entry of the sparse array. The page must have been allocated.
+    [[nodiscard]] size_type& get_indirect(size_type index);
     void ensure(size_type index);
   };
 
@@ -126,6 +142,17 @@ namespace anton_engine {
     template<typename Sort, typename Predicate>
     void sort(Sort sort, Predicate predicate);
 
+  protected:
+    void swap_positions(size_type lhs, size_type rhs) override
+    {
+      if constexpr(!anton::is_empty<Component>) {
+        using anton::swap;
+        swap(_components[lhs], _components[rhs]);
+      }
+
+      Component_Container_Base::swap_positions(lhs, rhs);
+    }
+
   private:
     using base_t = Component_Container_Base;
 
@@ -178,8 +205,19 @@ namespace anton_engine {
 
   inline bool Component_Container_Base::has(Entity const entity) const
   {
-    auto index = indirect_index(entity);
-    return index < _indirect.size() && _indirect[index] != npos;
+    auto position = find_indirect(indirect_index(entity));
+    // Compare the whole entity, so that stale entities whose index has been
+    // reused are not reported as present.
+    return position != npos && _entities[position] == entity;
+  }
+
+  inline i64 Component_Container_Base::get_sparse_memory_usage() const
+  {
+    i64 bytes = _indirect.capacity() * sizeof(anton::Array<size_type>);
+    for(anton::Array<size_type> const& page: _indirect) {
+      bytes += page.capacity() * sizeof(size_type);
+    }
+    return bytes;
   }
 
   inline Component_Container_Base::size_type
@@ -194,7 +232,7 @@ namespace anton_engine {
     _entities.emplace_back(entity);
     auto index = indirect_index(entity);
     ensure(index);
-    _indirect[index] = _entities.size() - 1;
+    get_indirect(index) = _entities.size() - 1;
   }
 
   inline Component_Container_Base::size_type
@@ -203,7 +241,7 @@ namespace anton_engine {
     ANTON_ASSERT(
       has(entity),
       "Attempting to get index of an entity that has not been registered");
-    return _indirect[indirect_index(entity)];
+    return get_indirect(indirect_index(entity));
   }
 
   inline void Component_Container_Base::remove_entity(Entity const entity)
@@ -211,23 +249,59 @@ namespace anton_engine {
     ANTON_ASSERT(has(entity),
                  "Attempting to remove entity that has not been registered");
     auto index = indirect_index(entity);
+    auto position = get_indirect(index);
     auto back_index = indirect_index(_entities[_entities.size() - 1]);
-    _entities.erase_unsorted(index);
-    _indirect[back_index] = _indirect[index];
-    _indirect[index] = npos;
+    _entities.erase_unsorted(position);
+    get_indirect(back_index) = position;
+    get_indirect(index) = npos;
   }
 
   inline Component_Container_Base::size_type
   Component_Container_Base::indirect_index(Entity const entity) const
   {
-    return entity.id;
+    return entity_index(entity);
+  }
+
+  inline Component_Container_Base::size_type
+  Component_Container_Base::find_indirect(size_type const index) const
+  {
+    size_type const page = index >> page_shift;
+    if(page >= _indirect.size() || _indirect[page].size() == 0) {
+      return npos;
+    }
+
+    return _indirect[page][index & (page_size - 1)];
+  }
+
+  inline Component_Container_Base::size_type&
+  Component_Container_Base::get_indirect(size_type const index)
+  {
+    return _indirect[index >> page_shift][index & (page_size - 1)];
   }
 
-  inline void Component_Container_Base::ensure(size_type index)
+  inline void Component_Container_Base::ensure(size_type const index)
   {
-    if(_indirect.size() <= index) {
-      _indirect.resize(index + 1, npos);
+    size_type const page = index >> page_shift;
+    if(_indirect.size() <= page) {
+      _indirect.resize(page + 1);
     }
+
+    if(_indirect[page].size() == 0) {
+      _indirect[page].resize(page_size, npos);
+    }
+  }
+
+  inline void Component_Container_Base::swap_positions(size_type const lhs,
+                                                      size_type const rhs)
+  {
+    if(lhs == rhs) {
+      return;
+    }
+
+    using anton::swap;
+    swap(get_indirect(indirect_index(_entities[lhs])),
+         get_indirect(indirect_index(_entities[rhs])));
+    swap(_entities[lhs], _entities[rhs]);
   }
 
   template<typename Component, typename Sort, typename Predicate>
@@ -260,8 +334,8 @@ namespace anton_engine {
       i64 const sorted_index = indices[i];
       if(i != sorted_index) {
         swap(components[i], components[sorted_index]);
-        swap(_indirect[indirect_index(_entities[i])],
-             _indirect[indirect_index(_entities[sorted_index])]);
+        swap(get_indirect(indirect_index(_entities[i])),
+             get_indirect(indirect_index(_entities[sorted_index])));
         swap(_entities[i], _entities[sorted_index]);
       }
     }
@@ -288,7 +362,7 @@ namespace anton_engine {
     for(i64 i = 0; i < container._entities.size(); i += 1) {
       auto index = container.indirect_index(container._entities[i]);
       container.ensure(index);
-      container._indirect[index] = i;
+      container.get_indirect(index) = i;
     }
   }
 
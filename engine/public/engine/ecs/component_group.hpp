@@ -0,0 +1,111 @@
+#pragma once
+
+#include <anton/tuple.hpp>
+#include <anton/type_traits.hpp>
+#include <engine/ecs/component_container.hpp>
+
+namespace anton_engine {
+  // View over an owning group.
+  // The group keeps the entities that have all of Components... packed at the
+  // front of every owned container in the same order, so the i-th entity of
+  // the group and its components are at index i in every container.
+  //
+  // The group size is captured when the view is created. Adding or removing
+  // components of the owned types invalidates the view.
+  template<typename... Components>
+  class Component_Group {
+    static_assert(sizeof...(Components) > 1,
+                  "Group must own at least 2 component types");
+
+    friend class ECS;
+
+    Component_Group(i64 const size, Component_Container<Components>*... c)
+      : _containers(c...), _size(size)
+    {
+    }
+
+  public:
+    using size_type = Component_Container_Base::size_type;
+    using iterator = Component_Container_Base::iterator;
+
+    [[nodiscard]] size_type size() const
+    {
+      return _size;
+    }
+
+    [[nodiscard]] iterator begin()
+    {
+      return get_first_container()->Component_Container_Base::begin();
+    }
+
+    [[nodiscard]] iterator end()
+    {
+      return begin() + _size;
+    }
+
+    // Returns: Pointer to the packed array of Component.
+    //          Elements [0, size()) belong to the group.
+    template<typename Component>
+    [[nodiscard]] Component* components()
+    {
+      static_assert(!anton::is_empty<Component>,
+                    "Empty components are not stored in arrays");
+      return anton::get<Component_Container<Component>*>(_containers)
+        ->components();
+    }
+
+    template<typename... Ts>
+    [[nodiscard]] decltype(auto) get(Entity const entity)
+    {
+      if constexpr(sizeof...(Ts) == 1) {
+        return (...,
+                anton::get<Component_Container<Ts>*>(_containers)->get(entity));
+      } else {
+        return anton::Tuple<Ts&...>(get<Ts>(entity)...);
+      }
+    }
+
+    // Iterate linearly over all entities in the group and their components.
+    // Requires a callable of form void(Components&...) or void(Entity, Components&...)
+    //
+    template<typename Callable>
+    void each(Callable&& callable)
+    {
+      static_assert(anton::is_invocable<Callable, Entity, Components&...> ||
+                    anton::is_invocable<Callable, Components&...>);
+      Entity const* const entities = get_first_container()->entities();
+      for(i64 i = 0; i < _size; ++i) {
+        if constexpr(anton::is_invocable<Callable, Components&...>) {
+          callable(get_at<Components>(i)...);
+        } else {
+          callable(entities[i], get_at<Components>(i)...);
+        }
+      }
+    }
+
+  private:
+    template<typename Component>
+    Component& get_at(i64 const index)
+    {
+      Component* const components =
+        anton::get<Component_Container<Component>*>(_containers)->components();
+      if constexpr(anton::is_empty<Component>) {
+        return *components;
+      } else {
+        return components[index];
+      }
+    }
+
+    Component_Container_Base* get_first_container()
+    {
+      Component_Container_Base* conts[] = {
+        static_cast<Component_Container_Base*>(
+          anton::get<Component_Container<Components>*>(_containers))...};
+      return conts[0];
+    }
+
+  private:
+    anton::Tuple<Component_Container<Components>*...> _containers;
+    i64 _size;
+  };
+} // namespace anton_engine
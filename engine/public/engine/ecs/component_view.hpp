@@ -1,9 +1,11 @@
 #pragma once
 
+#include <anton/array.hpp>
 #include <anton/math/math.hpp>
 #include <anton/tuple.hpp>
 #include <anton/utility.hpp>
 #include <engine/ecs/component_container.hpp>
+#include <engine/ecs/jobs.hpp>
 
 namespace anton_engine {
   template<typename... Components>
@@ -55,6 +57,7 @@ namespace anton_engine {
         for(; rhs > 0; --rhs) {
           ++(*this);
         }
+        return *this;
       }
 
       underlying_iterator_t operator->()
@@ -152,6 +155,89 @@ namespace anton_engine {
       }
     }
 
+    // Invoke callable for every entity in the view on the job pool.
+    // The entities of the smallest container are split into chunks of grain
+    // entities. callable must be safe to invoke concurrently for different entities.
+    // The chunks run in no particular order. Use parallel_reduce to collect
+    // results across entities.
+    // Requires a callable of form void(Components&...) or void(Entity, Components&...)
+    //
+    template<typename Callable>
+    void parallel_for_each(Callable const& callable, i64 const grain = 1024)
+    {
+      static_assert(
+        anton::is_invocable<Callable const&, Entity, Components&...> ||
+        anton::is_invocable<Callable const&, Components&...>);
+      Component_Container_Base* const smallest_container =
+        find_smallest_container();
+      auto const process = [this, &callable, smallest_container](
+                             i64 const first, i64 const last) {
+        Entity const* const entities = smallest_container->entities();
+        for(i64 i = first; i < last; ++i) {
+          Entity const entity = entities[i];
+          if(has_all_components(entity)) {
+            if constexpr(anton::is_invocable<Callable const&, Components&...>) {
+              callable(get<Components>(entity)...);
+            } else {
+              callable(entity, get<Components>(entity)...);
+            }
+          }
+        }
+      };
+      parallel_for(smallest_container->size(), grain, process);
+    }
+
+    // Invoke callable for every entity in the view on the job pool and merge
+    // the results of the chunks in chunk order.
+    // The entities of the smallest container are split into chunks of grain
+    // entities. The boundaries of the chunks depend only on the size of the
+    // container and grain, so the result is the same on every run regardless
+    // of the number of threads, which replays rely on.
+    // identity - initial value of the result of every chunk and of the total.
+    // Requires a callable of form void(Result&, Components&...) or
+    // void(Result&, Entity, Components&...) and merge of form
+    // void(Result& total, Result& chunk).
+    //
+    // Returns: identity merged with the results of all chunks.
+    template<typename Result, typename Callable, typename Merge>
+    [[nodiscard]] Result parallel_reduce(Result const& identity,
+                                         Callable const& callable,
+                                         Merge const& merge,
+                                         i64 const grain = 1024)
+    {
+      static_assert(
+        anton::is_invocable<Callable const&, Result&, Entity, Components&...> ||
+        anton::is_invocable<Callable const&, Result&, Components&...>);
+      Component_Container_Base* const smallest_container =
+        find_smallest_container();
+      i64 const count = smallest_container->size();
+      // parallel_for splits [0, count) at multiples of grain.
+      anton::Array<Result> results((count + grain - 1) / grain, identity);
+      auto const process = [this, &callable, &results, smallest_container,
+                            grain](i64 const first, i64 const last) {
+        Result& result = results[first / grain];
+        Entity const* const entities = smallest_container->entities();
+        for(i64 i = first; i < last; ++i) {
+          Entity const entity = entities[i];
+          if(has_all_components(entity)) {
+            if constexpr(anton::is_invocable<Callable const&, Result&,
+                                             Components&...>) {
+              callable(result, get<Components>(entity)...);
+            } else {
+              callable(result, entity, get<Components>(entity)...);
+            }
+          }
+        }
+      };
+      parallel_for(count, grain, process);
+
+      Result total = identity;
+      for(Result& result: results) {
+        merge(total, result);
+      }
+      return total;
+    }
+
   private:
     bool has_all_components(Entity entity)
     {
@@ -231,6 +317,76 @@ namespace anton_engine {
       }
     }
 
+    // Invoke callable for every entity in the view on the job pool.
+    // The entities are split into chunks of grain entities. callable must be
+    // safe to invoke concurrently for different entities.
+    // The chunks run in no particular order. Use parallel_reduce to collect
+    // results across entities.
+    // Requires a callable of form void(Component&) or void(Entity, Component&)
+    //
+    template<typename Callable>
+    void parallel_for_each(Callable const& callable, i64 const grain = 1024)
+    {
+      static_assert(anton::is_invocable<Callable const&, Entity, Component&> ||
+                    anton::is_invocable<Callable const&, Component&>);
+      auto const process = [this, &callable](i64 const first, i64 const last) {
+        Entity const* const entities = _container->entities();
+        for(i64 i = first; i < last; ++i) {
+          if constexpr(anton::is_invocable<Callable const&, Component&>) {
+            callable(get(entities[i]));
+          } else {
+            callable(entities[i], get(entities[i]));
+          }
+        }
+      };
+      parallel_for(_container->size(), grain, process);
+    }
+
+    // Invoke callable for every entity in the view on the job pool and merge
+    // the results of the chunks in chunk order.
+    // The entities are split into chunks of grain entities. The boundaries of
+    // the chunks depend only on the size of the view and grain, so the result
+    // is the same on every run regardless of the number of threads.
+    // identity - initial value of the result of every chunk and of the total.
+    // Requires a callable of form void(Result&, Component&) or
+    // void(Result&, Entity, Component&) and merge of form
+    // void(Result& total, Result& chunk).
+    //
+    // Returns: identity merged with the results of all chunks.
+    template<typename Result, typename Callable, typename Merge>
+    [[nodiscard]] Result parallel_reduce(Result const& identity,
+                                         Callable const& callable,
+                                         Merge const& merge,
+                                         i64 const grain = 1024)
+    {
+      static_assert(
+        anton::is_invocable<Callable const&, Result&, Entity, Component&> ||
+        anton::is_invocable<Callable const&, Result&, Component&>);
+      i64 const count = _container->size();
+      // parallel_for splits [0, count) at multiples of grain.
+      anton::Array<Result> results((count + grain - 1) / grain, identity);
+      auto const process = [this, &callable, &results, grain](i64 const first,
+                                                              i64 const last) {
+        Result& result = results[first / grain];
+        Entity const* const entities = _container->entities();
+        for(i64 i = first; i < last; ++i) {
+          if constexpr(anton::is_invocable<Callable const&, Result&,
+                                           Component&>) {
+            callable(result, get(entities[i]));
+          } else {
+            callable(result, entities[i], get(entities[i]));
+          }
+        }
+      };
+      parallel_for(count, grain, process);
+
+      Result total = identity;
+      for(Result& result: results) {
+        merge(total, result);
+      }
+      return total;
+    }
+
   private:
     Component_Container<Component>* _container;
   };
@@ -5,14 +5,30 @@
 #include <anton/tuple.hpp>
 #include <anton/type_traits.hpp>
 #include <anton/typeid.hpp>
-#include <core/integer_sequence_generator.hpp>
 #include <core/serialization/archives/binary.hpp>
 #include <engine.hpp>
 #include <engine/ecs/component_container.hpp>
+#include <engine/ecs/component_group.hpp>
 #include <engine/ecs/component_view.hpp>
 #include <engine/ecs/entity.hpp>
 
 namespace anton_engine {
+  // Returns: Dense index of the component type with given type identifier.
+  //          Indices are assigned in the order the types are first seen.
+  [[nodiscard]] i64 get_component_type_index(u64 type_identifier);
+
+  template<typename T>
+  [[nodiscard]] i64 component_type_index()
+  {
+    static i64 const index =
+      get_component_type_index(anton::type_identifier<T>());
+    return index;
+  }
+
+  // Returns: Value that has not been returned before. Used as structure
+  //          versions, so that versions of different ECS instances never match.
+  [[nodiscard]] u64 next_structure_version();
+
   class ECS {
   public:
     ECS() = default;
@@ -26,9 +42,12 @@ namespace anton_engine {
 
     // Returns: Array of components of type Component
     template<typename Component>
+    [[nodiscard]] Component* components();
+    template<typename Component>
     [[nodiscard]] Component const* components() const;
 
-    // Create entity without any attached components
+    // Create entity without any attached components.
+    // Indices of destroyed entities are reused with a bumped generation.
     Entity create();
 
     // Create entity with Components... components attached.
@@ -36,6 +55,8 @@ namespace anton_engine {
     template<typename... Components>
     auto create();
     void destroy(Entity);
+    // Returns: Whether entity has been created and has not been removed yet.
+    [[nodiscard]] bool is_alive(Entity) const;
     template<typename T, typename... Ctor_Args>
     T& add_component(Entity, Ctor_Args&&... args);
     template<typename T>
@@ -53,6 +74,34 @@ namespace anton_engine {
     template<typename... Ts>
     Component_View<Ts...> view();
 
+    // Get the owning group of Ts... creating it on first use.
+    // A component type may be owned by at most one group. Owned containers
+    // must not be sorted.
+    template<typename... Ts>
+    Component_Group<Ts...> group();
+
+    // Create the containers of Ts... if they do not exist yet.
+    template<typename... Ts>
+    void create_containers();
+
+    // Disallow structural changes, that is creating containers, groups and
+    // entities, destroying entities and adding or removing components.
+    // Asserts in debug builds that code running concurrently does not modify
+    // the shared state of the ECS.
+    void set_structure_locked(bool locked);
+    [[nodiscard]] bool is_structure_locked() const;
+
+    // Returns: Version of the structure of the ECS. The version changes
+    //          whenever components are added or removed, entities are removed,
+    //          containers are created or sorted, groups are created or
+    //          mark_structure_changed is called. Pointers to components stay
+    //          valid as long as the version does not change.
+    [[nodiscard]] u64 get_structure_version() const;
+    // Change the structure version, e.g. after relationships between entities
+    // stored in components have changed, so that data derived from them is
+    // rebuilt.
+    void mark_structure_changed();
+
     // Ts... are the components to copy
     template<typename... Ts>
     ECS snapshot() const;
@@ -72,17 +121,40 @@ namespace anton_engine {
       void (*remove)(Component_Container_Base&, Entity);
       Component_Container_Base* (*make_snapshot)(
         Component_Container_Base const&);
+      // Index of the group owning the container or -1.
+      i64 group = -1;
+    };
+
+    struct Group_Data {
+      // Dense type indices of the owned component types.
+      anton::Array<i64> type_indices;
+      // Number of entities in the group.
+      i64 size = 0;
     };
 
     anton::Array<Entity> _entities;
     anton::Array<Entity> entities_to_remove;
     anton::Array<Components_Container_Data> containers;
-    Integer_Sequence_Generator id_generator;
+    // Maps dense component type indices to indices into containers.
+    // -1 if the ECS does not have a container for the type.
+    anton::Array<i64> container_lookup;
+    anton::Array<Group_Data> groups;
+    // Current generation of each entity index.
+    anton::Array<u32> generations;
+    // Indices of removed entities that may be reused.
+    anton::Array<u32> free_indices;
+    bool structure_locked = false;
+    u64 structure_version = next_structure_version();
 
     template<typename... Container_Data>
-    ECS(anton::Array<Entity> const&, anton::Array<Entity> const&,
-        Integer_Sequence_Generator, Container_Data...);
-
+    ECS(ECS const& other, Container_Data...);
+
+    void rebuild_container_lookup();
+    [[nodiscard]] i64 find_or_create_group(anton::Slice<i64 const> type_indices);
+    // Move entity into the group if it has all of the owned components.
+    void enter_group(Group_Data& group, Entity entity);
+    // Move entity out of the group if it belongs to it.
+    void leave_group(Group_Data& group, Entity entity);
     template<typename T>
     Component_Container<T>* ensure_container();
     template<typename T>
@@ -101,7 +173,8 @@ namespace anton_engine {
 namespace anton_engine {
   inline ECS::ECS(ECS const& other)
     : _entities(other._entities), entities_to_remove(other.entities_to_remove),
-      containers(other.containers), id_generator(other.id_generator)
+      containers(other.containers), container_lookup(other.container_lookup),
+      groups(other.groups), generations(other.generations), free_indices(other.free_indices)
   {
     for(Components_Container_Data& data: containers) {
       data.container = data.make_snapshot(*data.container);
@@ -111,7 +184,10 @@ namespace anton_engine {
   inline ECS::ECS(ECS&& other)
     : _entities(ANTON_MOV(other._entities)),
       entities_to_remove(ANTON_MOV(other.entities_to_remove)),
-      containers(ANTON_MOV(other.containers)), id_generator(other.id_generator)
+      containers(ANTON_MOV(other.containers)),
+      container_lookup(ANTON_MOV(other.container_lookup)),
+      groups(ANTON_MOV(other.groups)), generations(ANTON_MOV(other.generations)),
+      free_indices(ANTON_MOV(other.free_indices))
   {
   }
 
@@ -122,6 +198,13 @@ namespace anton_engine {
     return c ? c->entities() : nullptr;
   }
 
+  template<typename Component>
+  [[nodiscard]] inline Component* ECS::components()
+  {
+    auto* c = find_container<Component>();
+    return c ? c->components() : nullptr;
+  }
+
   template<typename Component>
   [[nodiscard]] inline Component const* ECS::components() const
   {
@@ -136,28 +219,57 @@ namespace anton_engine {
       return create();
     } else {
       Entity entity = create();
+      // Adding a component may move the components of a group it belongs to,
+      // so the references are taken after all components have been added.
+      (..., add_component<Components>(entity));
       return anton::Tuple<Entity, Components&...>{
-        entity, add_component<Components>(entity)...};
+        entity, get_component<Components>(entity)...};
     }
   }
 
   inline void ECS::destroy(Entity const entity)
   {
+    ANTON_ASSERT(!structure_locked, "Cannot destroy entities while the "
+                                    "structure of the ECS is locked");
     entities_to_remove.push_back(entity);
   }
 
+  inline bool ECS::is_alive(Entity const entity) const
+  {
+    u64 const index = entity_index(entity);
+    return index < static_cast<u64>(generations.size()) &&
+           generations[index] == entity_generation(entity);
+  }
+
   template<typename T, typename... Ctor_Args>
   inline T& ECS::add_component(Entity const entity, Ctor_Args&&... args)
   {
+    ANTON_ASSERT(!structure_locked, "Cannot add components while the "
+                                    "structure of the ECS is locked");
     Component_Container<T>& components = *ensure_container<T>();
-    return components.add(entity, ANTON_FWD(args)...);
+    T& component = components.add(entity, ANTON_FWD(args)...);
+    mark_structure_changed();
+    i64 const group = find_container_data<T>()->group;
+    if(group == -1) {
+      return component;
+    }
+
+    enter_group(groups[group], entity);
+    return components.get(entity);
   }
 
   template<typename T>
   inline void ECS::remove_component(Entity const entity)
   {
+    ANTON_ASSERT(!structure_locked, "Cannot remove components while the "
+                                    "structure of the ECS is locked");
     Component_Container<T>& components = *ensure_container<T>();
+    i64 const group = find_container_data<T>()->group;
+    if(group != -1) {
+      leave_group(groups[group], entity);
+    }
     components.remove(entity);
+    mark_structure_changed();
   }
 
   template<typename... Ts>
@@ -199,7 +311,10 @@ namespace anton_engine {
     Component_Container<Component>* const container =
       find_container<Component>();
     if(container) {
+      ANTON_ASSERT(find_container_data<Component>()->group == -1,
+                   "Cannot sort a container owned by a group");
       container->sort(sort, predicate);
+      mark_structure_changed();
     }
   }
 
@@ -209,14 +324,50 @@ namespace anton_engine {
     return Component_View<Ts...>(ensure_container<Ts>()...);
   }
 
+  template<typename... Ts>
+  inline Component_Group<Ts...> ECS::group()
+  {
+    (..., ensure_container<Ts>());
+    i64 const type_indices[] = {component_type_index<Ts>()...};
+    i64 const group = find_or_create_group(type_indices);
+    return Component_Group<Ts...>(groups[group].size, find_container<Ts>()...);
+  }
+
+  template<typename... Ts>
+  inline void ECS::create_containers()
+  {
+    (..., ensure_container<Ts>());
+  }
+
+  inline void ECS::set_structure_locked(bool const locked)
+  {
+    structure_locked = locked;
+  }
+
+  inline bool ECS::is_structure_locked() const
+  {
+    return structure_locked;
+  }
+
+  inline u64 ECS::get_structure_version() const
+  {
+    return structure_version;
+  }
+
+  inline void ECS::mark_structure_changed()
+  {
+    ANTON_ASSERT(!structure_locked, "Cannot change the structure while the "
+                                    "structure of the ECS is locked");
+    structure_version = next_structure_version();
+  }
+
   template<typename... Ts>
   inline ECS ECS::snapshot() const
   {
     ANTON_VERIFY(
       (... && (find_container_data<Ts>() != nullptr)),
       "Cannot create a snapshot of component that has not been added.");
-    return ECS(_entities, entities_to_remove, id_generator,
-               *find_container_data<Ts>()...);
+    return ECS(*this, *find_container_data<Ts>()...);
   }
 
   inline anton::Array<Entity> const& ECS::get_entities() const
@@ -231,27 +382,74 @@ namespace anton_engine {
 
   inline void ECS::remove_requested_entities()
   {
+    ANTON_ASSERT(!structure_locked, "Cannot remove entities while the "
+                                    "structure of the ECS is locked");
+    if(entities_to_remove.size() == 0) {
+      return;
+    }
+
+    // Mark the indices of the entities to remove. Entities that are not alive
+    // are skipped and entities that have been requested multiple times are
+    // removed only once.
+    anton::Array<bool> marked(generations.size(), false);
+    anton::Array<Entity> removed;
+    for(Entity const entity: entities_to_remove) {
+      if(is_alive(entity) && !marked[entity_index(entity)]) {
+        marked[entity_index(entity)] = true;
+        removed.push_back(entity);
+      }
+    }
+
     for(auto& container_data: containers) {
-      for(Entity const entity: entities_to_remove) {
-        if(container_data.container->has(entity)) {
-          container_data.remove(*container_data.container, entity);
+      Component_Container_Base& container = *container_data.container;
+      if(removed.size() < container.size()) {
+        for(Entity const entity: removed) {
+          if(container.has(entity)) {
+            if(container_data.group != -1) {
+              leave_group(groups[container_data.group], entity);
+            }
+            container_data.remove(container, entity);
+          }
+        }
+      } else {
+        // Removal and leaving a group only move entities that have already
+        // been visited into the current slot, so walking backwards visits
+        // every entity exactly once.
+        for(i64 i = container.size() - 1; i >= 0; --i) {
+          Entity const entity = container.entities()[i];
+          if(marked[entity_index(entity)]) {
+            if(container_data.group != -1) {
+              leave_group(groups[container_data.group], entity);
+            }
+            container_data.remove(container, entity);
+          }
         }
       }
     }
 
-    for(Entity const entity: entities_to_remove) {
-      auto iter = anton::find(_entities.begin(), _entities.end(), entity);
-      _entities.erase_unsorted(iter);
+    i64 live_count = 0;
+    for(i64 i = 0; i < _entities.size(); ++i) {
+      Entity const entity = _entities[i];
+      u64 const index = entity_index(entity);
+      if(marked[index]) {
+        generations[index] += 1;
+        free_indices.push_back(index);
+      } else {
+        _entities[live_count] = entity;
+        live_count += 1;
+      }
     }
+    _entities.resize(live_count);
 
     entities_to_remove.clear();
+    mark_structure_changed();
   }
 
   template<typename... Container_Data>
-  inline ECS::ECS(anton::Array<Entity> const& e, anton::Array<Entity> const& er,
-                  Integer_Sequence_Generator g, Container_Data... data)
-    : _entities(e), entities_to_remove(er),
-      containers(anton::reserve, sizeof...(Container_Data)), id_generator(g)
+  inline ECS::ECS(ECS const& other, Container_Data... data)
+    : _entities(other._entities), entities_to_remove(other.entities_to_remove),
+      containers(anton::reserve, sizeof...(Container_Data)),
+      generations(other.generations), free_indices(other.free_indices)
   {
     static_assert(
       (... && anton::is_same<Container_Data, Components_Container_Data>),
@@ -259,18 +457,20 @@ namespace anton_engine {
     (...,
      containers.emplace_back(data.family, data.make_snapshot(*data.container),
                              data.remove, data.make_snapshot));
+    rebuild_container_lookup();
   }
 
   template<typename T>
   inline Component_Container<T>* ECS::ensure_container()
   {
-    u64 const type = anton::type_identifier<T>();
-    for(auto& data: containers) {
-      if(data.family == type) {
-        return static_cast<Component_Container<T>*>(data.container);
-      }
+    if(Components_Container_Data* const data = find_container_data<T>()) {
+      return static_cast<Component_Container<T>*>(data->container);
     }
 
+    // Accessing a component type that has no container yet reallocates
+    // containers under anyone else reading the ECS.
+    ANTON_ASSERT(!structure_locked, "Cannot create a container while the "
+                                    "structure of the ECS is locked");
     auto& data = containers.emplace_back();
     try {
       data.container = new Component_Container<T>();
@@ -278,7 +478,7 @@ namespace anton_engine {
       containers.pop_back();
       throw;
     }
-    data.family = type;
+    data.family = anton::type_identifier<T>();
     data.remove = [](Component_Container_Base& container, Entity const entity) {
       static_cast<Component_Container<T>&>(container).remove(entity);
     };
@@ -288,41 +488,39 @@ namespace anton_engine {
         static_cast<Component_Container<T> const&>(container);
       return new Component_Container<T>(c);
     };
+
+    i64 const type_index = component_type_index<T>();
+    if(container_lookup.size() <= type_index) {
+      container_lookup.resize(type_index + 1, -1);
+    }
+    container_lookup[type_index] = containers.size() - 1;
+    mark_structure_changed();
     return static_cast<Component_Container<T>*>(data.container);
   }
 
   template<typename T>
   inline Component_Container<T> const* ECS::find_container() const
   {
-    u64 const type = anton::type_identifier<T>();
-    for(auto& data: containers) {
-      if(data.family == type) {
-        return static_cast<Component_Container<T> const*>(data.container);
-      }
-    }
-    return nullptr;
+    Components_Container_Data const* const data = find_container_data<T>();
+    return data ? static_cast<Component_Container<T> const*>(data->container)
+                : nullptr;
   }
 
   template<typename T>
   inline Component_Container<T>* ECS::find_container()
   {
-    u64 const type = anton::type_identifier<T>();
-    for(auto& data: containers) {
-      if(data.family == type) {
-        return static_cast<Component_Container<T>*>(data.container);
-      }
-    }
-    return nullptr;
+    Components_Container_Data* const data = find_container_data<T>();
+    return data ? static_cast<Component_Container<T>*>(data->container)
+                : nullptr;
   }
 
   template<typename T>
   inline ECS::Components_Container_Data* ECS::find_container_data()
   {
-    u64 const type = anton::type_identifier<T>();
-    for(auto& data: containers) {
-      if(data.family == type) {
-        return &data;
-      }
+    i64 const type_index = component_type_index<T>();
+    if(type_index < container_lookup.size() &&
+       container_lookup[type_index] != -1) {
+      return &containers[container_lookup[type_index]];
     }
     return nullptr;
   }
@@ -330,11 +528,10 @@ namespace anton_engine {
   template<typename T>
   inline ECS::Components_Container_Data const* ECS::find_container_data() const
   {
-    u64 const type = anton::type_identifier<T>();
-    for(auto& data: containers) {
-      if(data.family == type) {
-        return &data;
-      }
+    i64 const type_index = component_type_index<T>();
+    if(type_index < container_lookup.size() &&
+       container_lookup[type_index] != -1) {
+      return &containers[container_lookup[type_index]];
     }
     return nullptr;
   }
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <engine/ecs/ecs.hpp>
+#include <engine/ecs/entity.hpp>
+
+namespace anton_engine {
+  // Records structural changes of an ECS, that is creating and destroying
+  // entities and adding and removing components, to be applied later.
+  class ECS_Command_Buffer {
+  public:
+    ECS_Command_Buffer() = default;
+    ECS_Command_Buffer(ECS_Command_Buffer const&) = delete;
+    ECS_Command_Buffer& operator=(ECS_Command_Buffer const&) = delete;
+    ~ECS_Command_Buffer();
+
+    // Record function to be invoked as function(ECS&) when the buffer is
+    // applied, e.g. to create entities.
+    template<typename Function>
+    void push(Function function);
+
+    void destroy(Entity entity);
+
+    // Does nothing if entity is no longer alive when the buffer is applied.
+    template<typename T>
+    void add_component(Entity entity, T component);
+
+    // Does nothing if entity does not have T when the buffer is applied.
+    template<typename T>
+    void remove_component(Entity entity);
+
+    // Execute the commands in the order they were recorded and clear the
+    // buffer.
+    void apply(ECS& ecs);
+
+  private:
+    class Command {
+    public:
+      virtual ~Command() {}
+
+      virtual void execute(ECS& ecs) = 0;
+    };
+
+    template<typename Function>
+    class Function_Command: public Command {
+    public:
+      Function function;
+
+      Function_Command(Function function): function(ANTON_MOV(function)) {}
+
+      void execute(ECS& ecs) override
+      {
+        function(ecs);
+      }
+    };
+
+    anton::Array<Command*> commands;
+  };
+} // namespace anton_engine
+
+namespace anton_engine {
+  inline ECS_Command_Buffer::~ECS_Command_Buffer()
+  {
+    for(Command* const command: commands) {
+      delete command;
+    }
+  }
+
+  template<typename Function>
+  inline void ECS_Command_Buffer::push(Function function)
+  {
+    commands.push_back(new Function_Command<Function>(ANTON_MOV(function)));
+  }
+
+  inline void ECS_Command_Buffer::destroy(Entity const entity)
+  {
+    push([entity](ECS& ecs) { ecs.destroy(entity); });
+  }
+
+  template<typename T>
+  inline void ECS_Command_Buffer::add_component(Entity const entity,
+                                                T component)
+  {
+    push([entity, component = ANTON_MOV(component)](ECS& ecs) mutable {
+      if(ecs.is_alive(entity)) {
+        ecs.add_component<T>(entity, ANTON_MOV(component));
+      }
+    });
+  }
+
+  template<typename T>
+  inline void ECS_Command_Buffer::remove_component(Entity const entity)
+  {
+    push([entity](ECS& ecs) {
+      if(ecs.has_component<T>(entity)) {
+        ecs.remove_component<T>(entity);
+      }
+    });
+  }
+
+  inline void ECS_Command_Buffer::apply(ECS& ecs)
+  {
+    // Commands must not record further commands into the buffer being
+    // applied.
+    for(Command* const command: commands) {
+      command->execute(ecs);
+      delete command;
+    }
+    commands.clear();
+  }
+} // namespace anton_engine
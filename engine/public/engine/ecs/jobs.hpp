@@ -1,5 +1,8 @@
 #pragma once
 
+#include <anton/array.hpp>
+#include <anton/assert.hpp>
+#include <anton/slice.hpp>
 #include <core/types.hpp>
 
 namespace anton_engine {
@@ -10,5 +13,74 @@ namespace anton_engine {
     virtual void execute() = 0;
   };
 
-  i64 schedule_job(Job*);
+  // Identifies a scheduled job. Ids are unique for the lifetime of the job system.
+  using Job_Id = i64;
+
+  constexpr Job_Id null_job = -1;
+
+  // Schedule job for execution on the job pool.
+  // The job system does not take ownership of the job. The job must stay alive
+  // until it has finished executing.
+  //
+  // Returns: Id of the scheduled job.
+  Job_Id schedule_job(Job* job);
+
+  // Schedule job for execution once all jobs in dependencies have finished.
+  // null_job entries in dependencies are ignored.
+  //
+  // Returns: Id of the scheduled job.
+  Job_Id schedule_job(Job* job, anton::Slice<Job_Id const> dependencies);
+
+  // Block until the job has finished.
+  // The calling thread executes pending jobs while waiting.
+  void wait(Job_Id id);
+
+  // Returns: Number of threads executing jobs, including the main thread.
+  [[nodiscard]] i64 get_job_thread_count();
+
+  // Split [0, count) into chunks of at most grain elements and invoke
+  // function(first, last) for every chunk on the job pool.
+  // Blocks until all chunks have finished.
+  template<typename Function>
+  void parallel_for(i64 count, i64 grain, Function const& function);
+} // namespace anton_engine
+
+namespace anton_engine {
+  template<typename Function>
+  void parallel_for(i64 const count, i64 const grain,
+                    Function const& function)
+  {
+    ANTON_ASSERT(grain > 0, "grain must be greater than 0");
+    if(count <= grain) {
+      function(0, count);
+      return;
+    }
+
+    class Chunk_Job: public Job {
+    public:
+      Function const* function;
+      i64 first;
+      i64 last;
+
+      void execute() override
+      {
+        (*function)(first, last);
+      }
+    };
+
+    i64 const chunk_count = (count + grain - 1) / grain;
+    anton::Array<Chunk_Job> jobs(chunk_count);
+    anton::Array<Job_Id> ids{anton::reserve, chunk_count};
+    for(i64 i = 0; i < chunk_count; ++i) {
+      Chunk_Job& job = jobs[i];
+      job.function = &function;
+      job.first = i * grain;
+      job.last = job.first + grain < count ? job.first + grain : count;
+      ids.push_back(schedule_job(&job));
+    }
+
+    for(Job_Id const id: ids) {
+      wait(id);
+    }
+  }
 } // namespace anton_engine
@@ -1,11 +1,142 @@
 #pragma once
 
+#include <anton/array.hpp>
+#include <anton/typeid.hpp>
+#include <core/types.hpp>
+#include <engine/ecs/ecs.hpp>
+#include <engine/ecs/ecs_command_buffer.hpp>
+
 namespace anton_engine {
+  // Set of component types that a system reads and writes during update.
+  // Systems whose accesses do not conflict are updated concurrently, hence
+  // a system that has not declared exclusive access
+  //  - may access only the components it has declared. Their containers are
+  //    created before the first update, so that looking them up does not
+  //    modify the ECS.
+  //  - must not create or destroy entities, add or remove components or
+  //    create groups. Such changes must be recorded in the command buffer of
+  //    the system, which is applied after all systems have been updated.
+  // The structure of the ECS is locked during the update, therefore breaking
+  // the rules asserts in debug builds.
+  class System_Access {
+  public:
+    template<typename... Components>
+    System_Access& read();
+
+    template<typename... Components>
+    System_Access& write();
+
+    // Declare that the system may access anything. Such a system is never
+    // updated concurrently with other systems.
+    System_Access& exclusive();
+
+    [[nodiscard]] bool is_exclusive() const;
+    [[nodiscard]] bool conflicts_with(System_Access const&) const;
+
+    // Create the containers of all declared component types.
+    void create_containers(ECS& ecs) const;
+
+  private:
+    anton::Array<u64> reads;
+    anton::Array<u64> writes;
+    anton::Array<void (*)(ECS&)> container_constructors;
+    bool _exclusive = false;
+  };
+
   class System {
   public:
     virtual ~System() {}
 
+    // Declare the components accessed by update.
+    // The default implementation declares exclusive access.
+    virtual void declare_access(System_Access& access) const
+    {
+      access.exclusive();
+    }
+
     virtual void start() {}
     virtual void update() = 0;
+
+    // Returns: Buffer of the structural changes made by update.
+    //          Applied after all systems have been updated.
+    [[nodiscard]] ECS_Command_Buffer& get_command_buffer();
+
+  private:
+    ECS_Command_Buffer command_buffer;
   };
 } // namespace anton_engine
+
+namespace anton_engine {
+  template<typename... Components>
+  inline System_Access& System_Access::read()
+  {
+    (reads.push_back(anton::type_identifier<Components>()), ...);
+    (container_constructors.push_back(
+       [](ECS& ecs) { ecs.create_containers<Components>(); }),
+     ...);
+    return *this;
+  }
+
+  template<typename... Components>
+  inline System_Access& System_Access::write()
+  {
+    (writes.push_back(anton::type_identifier<Components>()), ...);
+    (container_constructors.push_back(
+       [](ECS& ecs) { ecs.create_containers<Components>(); }),
+     ...);
+    return *this;
+  }
+
+  inline System_Access& System_Access::exclusive()
+  {
+    _exclusive = true;
+    return *this;
+  }
+
+  inline bool System_Access::is_exclusive() const
+  {
+    return _exclusive;
+  }
+
+  inline void System_Access::create_containers(ECS& ecs) const
+  {
+    for(auto const constructor: container_constructors) {
+      constructor(ecs);
+    }
+  }
+
+  inline bool System_Access::conflicts_with(System_Access const& other) const
+  {
+    if(_exclusive || other._exclusive) {
+      return true;
+    }
+
+    auto contains = [](anton::Array<u64> const& types, u64 const type) {
+      for(u64 const t: types) {
+        if(t == type) {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    for(u64 const type: writes) {
+      if(contains(other.reads, type) || contains(other.writes, type)) {
+        return true;
+      }
+    }
+
+    for(u64 const type: other.writes) {
+      if(contains(reads, type)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  inline ECS_Command_Buffer& System::get_command_buffer()
+  {
+    return command_buffer;
+  }
+} // namespace anton_engine
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <anton/array.hpp>
+#include <anton/assert.hpp>
 #include <core/exception.hpp>
 #include <core/handle.hpp>
-#include <core/integer_sequence_generator.hpp>
 
 namespace anton_engine {
+  // Stores resources densely and hands out generational handles.
+  // add, get and remove are O(1). Removing a resource may change the order of
+  // the remaining resources during iteration, but never invalidates their handles.
   template<typename T>
   class Resource_Manager {
   public:
@@ -18,10 +21,25 @@ namespace anton_engine {
     T& get(Handle<T>);
     T const& get(Handle<T>) const;
     void remove(Handle<T>);
+    // Returns: Whether handle refers to a resource that has not been removed.
+    [[nodiscard]] bool contains(Handle<T>) const;
 
   private:
+    struct Slot {
+      // Index of the resource in resources or the next free slot if the slot is unused.
+      u32 index;
+      u32 generation;
+    };
+
+    static constexpr u32 null_slot = static_cast<u32>(-1);
+
     anton::Array<T> resources;
-    anton::Array<u64> identifiers;
+    // Maps indices of resources to the slots that refer to them.
+    anton::Array<u32> resource_slots;
+    anton::Array<Slot> slots;
+    u32 free_slot = null_slot;
+
+    u32 find_slot(Handle<T>) const;
   };
 } // namespace anton_engine
 
@@ -41,49 +59,75 @@ namespace anton_engine {
   template<typename T>
   Handle<T> Resource_Manager<T>::add(T&& resource)
   {
-    static Integer_Sequence_Generator id_generator;
+    u32 slot_index = free_slot;
+    if(slot_index != null_slot) {
+      free_slot = slots[slot_index].index;
+    } else {
+      slot_index = slots.size();
+      slots.push_back(Slot{0, 0});
+    }
+
+    Slot& slot = slots[slot_index];
+    slot.index = resources.size();
     resources.emplace_back(ANTON_FWD(resource));
-    u64 resource_id = id_generator.next();
-    identifiers.push_back(resource_id);
-    return {resource_id};
+    resource_slots.push_back(slot_index);
+    return {handle_value(slot_index, slot.generation)};
   }
 
   template<typename T>
-  T& Resource_Manager<T>::get(Handle<T> handle)
+  u32 Resource_Manager<T>::find_slot(Handle<T> const handle) const
   {
-    for(typename anton::Array<T>::size_type i = 0; i < identifiers.size();
-        ++i) {
-      if(identifiers[i] == handle.value) {
-        return resources[i];
-      }
+    u64 const slot_index = handle_index(handle);
+    if(slot_index >= static_cast<u64>(slots.size())) {
+      throw Exception(u8"Could not find resource with given handle");
     }
 
-    throw Exception(u8"Could not find resource with given handle");
+    ANTON_ASSERT(slots[slot_index].generation == handle_generation(handle),
+                 "handle refers to a resource that has been removed");
+    return slots[slot_index].index;
   }
 
   template<typename T>
-  T const& Resource_Manager<T>::get(Handle<T> handle) const
+  T& Resource_Manager<T>::get(Handle<T> const handle)
   {
-    for(typename anton::Array<T>::size_type i = 0; i < identifiers.size();
-        ++i) {
-      if(identifiers[i] == handle.value) {
-        return resources[i];
-      }
-    }
+    return resources[find_slot(handle)];
+  }
+
+  template<typename T>
+  T const& Resource_Manager<T>::get(Handle<T> const handle) const
+  {
+    return resources[find_slot(handle)];
+  }
 
-    throw Exception(u8"Could not find resource with given handle");
+  template<typename T>
+  bool Resource_Manager<T>::contains(Handle<T> const handle) const
+  {
+    u64 const slot_index = handle_index(handle);
+    return slot_index < static_cast<u64>(slots.size()) &&
+           slots[slot_index].generation == handle_generation(handle);
   }
 
   template<typename T>
-  void Resource_Manager<T>::remove(Handle<T> handle)
+  void Resource_Manager<T>::remove(Handle<T> const handle)
   {
-    for(typename anton::Array<T>::size_type i = 0; i < identifiers.size();
-        ++i) {
-      if(identifiers[i] == handle.value) {
-        identifiers.erase_unsorted_unchecked(i);
-        resources.erase_unsorted_unchecked(i);
-        return;
-      }
+    if(!contains(handle)) {
+      return;
+    }
+
+    u32 const slot_index = handle_index(handle);
+    Slot& slot = slots[slot_index];
+    u32 const index = slot.index;
+    u32 const last_index = resources.size() - 1;
+    if(index != last_index) {
+      u32 const moved_slot = resource_slots[last_index];
+      slots[moved_slot].index = index;
+      resource_slots[index] = moved_slot;
     }
+    resources.erase_unsorted_unchecked(index);
+    resource_slots.pop_back();
+
+    slot.generation += 1;
+    slot.index = free_slot;
+    free_slot = slot_index;
   }
 } // namespace anton_engine
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <anton/math/mat4.hpp>
+#include <anton/math/math.hpp>
+#include <anton/math/vec3.hpp>
+#include <anton/slice.hpp>
+#include <core/types.hpp>
+#include <physics/ray.hpp>
+
+namespace anton_engine {
+  class Mesh;
+
+  class AABB {
+  public:
+    Vec3 min;
+    Vec3 max;
+  };
+
+  // Returns: Smallest box enclosing both boxes.
+  [[nodiscard]] AABB merge(AABB, AABB);
+  // Returns: Box enclosing the box transformed by matrix.
+  [[nodiscard]] AABB transform_aabb(AABB, Mat4 const& matrix);
+  // Returns: Distance along the ray to the point where it enters the box
+  //          or infinity if the ray misses the box.
+  // inv_direction - componentwise reciprocal of the direction of the ray.
+  [[nodiscard]] f32 intersect_ray_aabb(Vec3 origin, Vec3 inv_direction, AABB);
+
+  struct BVH_Node {
+    AABB bounds;
+    // Leaf: index of the first primitive in BVH::primitives.
+    // Inner node: index of the second child. The first child directly
+    //             follows its parent.
+    i32 index;
+    // Number of primitives in a leaf or 0 for inner nodes.
+    i32 count;
+  };
+
+  // Bounding volume hierarchy over a set of boxes. Primitives are identified by
+  // the positions of their boxes in the array the hierarchy was built from.
+  class BVH {
+  public:
+    anton::Array<BVH_Node> nodes;
+    anton::Array<i32> primitives;
+
+    // Rebuild the hierarchy over boxes by splitting along the longest axis
+    // of the centroids at the median.
+    void build(anton::Slice<AABB const> boxes);
+
+    // Returns: Bounds of all primitives.
+    [[nodiscard]] AABB get_bounds() const;
+
+    // Visit primitives whose boxes are hit by the ray closer than max_distance,
+    // nearer nodes first. Nodes that are farther than the closest hit found so
+    // far are skipped.
+    // intersect - callable of form f32(i32 primitive, f32 max_distance) that
+    //             returns the distance to the hit or infinity if there is none.
+    // Returns: Distance to the closest hit or infinity.
+    template<typename Intersect>
+    f32 raycast(Ray ray, f32 max_distance, Intersect&& intersect) const;
+  };
+
+  // Build a hierarchy over the triangles of mesh in model space.
+  // Primitive i is the triangle made of indices 3i, 3i + 1 and 3i + 2.
+  [[nodiscard]] BVH build_mesh_bvh(Mesh const& mesh);
+} // namespace anton_engine
+
+namespace anton_engine {
+  template<typename Intersect>
+  f32 BVH::raycast(Ray const ray, f32 max_distance, Intersect&& intersect) const
+  {
+    if(nodes.size() == 0) {
+      return math::infinity;
+    }
+
+    Vec3 const inv_direction = {1.0f / ray.direction.x, 1.0f / ray.direction.y,
+                                1.0f / ray.direction.z};
+    f32 closest = math::infinity;
+    // Median splits keep the tree balanced, so the depth stays far below 64.
+    i32 stack[64];
+    f32 stack_distances[64];
+    i32 stack_size = 0;
+    if(f32 const distance =
+         intersect_ray_aabb(ray.origin, inv_direction, nodes[0].bounds);
+       distance < max_distance) {
+      stack[stack_size] = 0;
+      stack_distances[stack_size] = distance;
+      stack_size += 1;
+    }
+
+    while(stack_size > 0) {
+      stack_size -= 1;
+      // The closest hit might have moved since the node was pushed.
+      if(stack_distances[stack_size] >= max_distance) {
+        continue;
+      }
+
+      i32 const node_index = stack[stack_size];
+      BVH_Node const& node = nodes[node_index];
+      if(node.count > 0) {
+        for(i32 i = node.index; i < node.index + node.count; ++i) {
+          f32 const distance = intersect(primitives[i], max_distance);
+          if(distance < max_distance) {
+            closest = distance;
+            max_distance = distance;
+          }
+        }
+        continue;
+      }
+
+      i32 const first = node_index + 1;
+      i32 const second = node.index;
+      f32 const first_distance =
+        intersect_ray_aabb(ray.origin, inv_direction, nodes[first].bounds);
+      f32 const second_distance =
+        intersect_ray_aabb(ray.origin, inv_direction, nodes[second].bounds);
+      // Push the farther child first, so that the nearer one is visited first.
+      bool const first_nearer = first_distance <= second_distance;
+      i32 const near_child = first_nearer ? first : second;
+      i32 const far_child = first_nearer ? second : first;
+      f32 const near_distance = first_nearer ? first_distance : second_distance;
+      f32 const far_distance = first_nearer ? second_distance : first_distance;
+      if(far_distance < max_distance) {
+        stack[stack_size] = far_child;
+        stack_distances[stack_size] = far_distance;
+        stack_size += 1;
+      }
+      if(near_distance < max_distance) {
+        stack[stack_size] = near_child;
+        stack_distances[stack_size] = near_distance;
+        stack_size += 1;
+      }
+    }
+
+    return closest;
+  }
+} // namespace anton_engine
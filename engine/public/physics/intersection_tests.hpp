@@ -3,6 +3,7 @@
 #include <anton/math/mat4.hpp>
 #include <anton/math/vec3.hpp>
 #include <anton/optional.hpp>
+#include <physics/bvh.hpp>
 #include <physics/intersections_common.hpp>
 #include <physics/line.hpp>
 #include <physics/obb.hpp>
@@ -17,7 +18,29 @@ namespace anton_engine {
     float distance = 0;
   };
 
+  // Four triangles stored componentwise for intersect_ray_triangles.
+  // Unused lanes hold degenerate triangles that are never hit.
+  class Triangle_Packet {
+  public:
+    // Vertex a and edges ab and ac indexed by [component][lane].
+    f32 a[3][4];
+    f32 ab[3][4];
+    f32 ac[3][4];
+  };
+
+  // vertices - 3 * count vertices, every 3 consecutive form a triangle.
+  //            count must not be greater than 4.
+  [[nodiscard]] Triangle_Packet make_triangle_packet(Vec3 const* vertices,
+                                                     i32 count);
+
+  // Two-sided test using the Moller-Trumbore algorithm.
+  // Barycentric coordinates of the hit are the weights of b, c and a.
   anton::Optional<Raycast_Hit> intersect_ray_triangle(Ray, Vec3, Vec3, Vec3);
+  // Test the ray against all 4 triangles of the packet at once.
+  // lane - (out, optional) index of the hit triangle in the packet.
+  // Returns: Closest hit.
+  anton::Optional<Raycast_Hit>
+  intersect_ray_triangles(Ray, Triangle_Packet const&, i32* lane = nullptr);
   anton::Optional<Raycast_Hit> intersect_ray_quad(Ray, Vec3, Vec3, Vec3, Vec3);
   anton::Optional<Raycast_Hit> intersect_ray_plane(Ray, Vec3 plane_normal,
                                                    float plane_distance);
@@ -30,6 +53,10 @@ namespace anton_engine {
   bool test_ray_mesh(Ray, Mesh const&);
   anton::Optional<Raycast_Hit> intersect_ray_mesh(Ray, Mesh const&,
                                                   Mat4 model_transform);
+  // Intersect ray with mesh using the hierarchy of its triangles built by build_mesh_bvh.
+  // The ray and the returned hit are in model space.
+  anton::Optional<Raycast_Hit> intersect_ray_mesh(Ray, Mesh const&,
+                                                  BVH const& mesh_bvh);
   anton::Optional<Linecast_Hit> intersect_line_plane(Line, Vec3 plane_normal,
                                                      float plane_distance);
 } // namespace anton_engine
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <core/types.hpp>
+#include <engine/components/static_mesh_component.hpp>
+
+namespace anton_engine::rendering {
+  // Pack the state of a draw into a key whose order is the draw order.
+  // Objects are sorted by shader, then material, then mesh. Depth ordering is
+  // not provided since objects sharing all three are drawn by a single
+  // instanced draw. Only the low bits of the handle indices fit in the key, so
+  // objects with different handles may share a key. Batching compares the
+  // handles themselves and stays correct, it may only produce more batches.
+  [[nodiscard]] u64 make_draw_key(Static_Mesh_Component const& mesh);
+
+  // Buffers of radix_sort. Kept by the caller, so that sorting every frame
+  // does not allocate.
+  struct Radix_Sort_Scratch {
+    anton::Array<u64> keys;
+    anton::Array<u32> indices;
+  };
+
+  // Sort indices by keys with an LSD radix sort over 8 bit digits. The sort is
+  // stable. Digits that are equal in all keys are skipped.
+  // keys and indices must have the same size.
+  void radix_sort(anton::Array<u64>& keys, anton::Array<u32>& indices,
+                  Radix_Sort_Scratch& scratch);
+} // namespace anton_engine::rendering
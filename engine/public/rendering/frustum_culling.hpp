@@ -0,0 +1,44 @@
+#pragma once
+
+#include <anton/math/mat4.hpp>
+#include <anton/math/vec3.hpp>
+#include <anton/math/vec4.hpp>
+#include <anton/slice.hpp>
+#include <core/types.hpp>
+#include <engine/mesh.hpp>
+
+namespace anton_engine::rendering {
+  struct Bounding_Sphere {
+    Vec3 center;
+    f32 radius;
+  };
+
+  // Planes of a view frustum stored as (normal, distance) with normals pointing
+  // inside, so that dot(normal, point) + distance >= 0 for points inside.
+  struct Frustum {
+    Vec4 planes[6];
+  };
+
+  // Extract the planes of the frustum from a view-projection matrix.
+  [[nodiscard]] Frustum make_frustum(Mat4 const& view_projection);
+
+  // Returns: Sphere enclosing all vertices.
+  [[nodiscard]] Bounding_Sphere
+  compute_bounding_sphere(anton::Slice<Vertex const> vertices);
+
+  // Returns: Sphere enclosing the transformed sphere. Accounts for non-uniform scale.
+  [[nodiscard]] Bounding_Sphere transform_bounding_sphere(Bounding_Sphere,
+                                                          Mat4 const& matrix);
+
+  // Returns: Whether the sphere intersects the frustum.
+  [[nodiscard]] bool test_sphere(Frustum const& frustum,
+                                 Bounding_Sphere const& sphere);
+
+  // Test spheres against the frustum 4 at a time. Gives the same results as
+  // test_sphere.
+  // visible - (out) indices of the spheres that intersect the frustum in
+  //           ascending order. Must be at least spheres.size() big.
+  // Returns: Number of visible spheres.
+  i64 cull_spheres(Frustum const& frustum,
+                   anton::Slice<Bounding_Sphere const> spheres, u32* visible);
+} // namespace anton_engine::rendering
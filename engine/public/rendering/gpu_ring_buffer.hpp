@@ -0,0 +1,88 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <core/types.hpp>
+
+namespace anton_engine::rendering {
+  // Opaque fence handle. 0 is never a valid fence.
+  using Fence = u64;
+
+  constexpr Fence null_fence = 0;
+
+  // Fence operations used by GPU_Ring_Buffer to find out when the GPU has
+  // finished reading a region. Abstracted so that the allocator does not
+  // depend on a GL context.
+  class Fence_Backend {
+  public:
+    virtual ~Fence_Backend() = default;
+
+    // Insert a fence into the command stream after all submitted commands.
+    [[nodiscard]] virtual Fence insert_fence() = 0;
+    // Block until the fence has been signaled.
+    // Returns: Whether the fence was not signaled yet and the call had to block.
+    virtual bool wait_fence(Fence fence) = 0;
+    virtual void delete_fence(Fence fence) = 0;
+  };
+
+  // Fences backed by OpenGL sync objects.
+  class GL_Fence_Backend: public Fence_Backend {
+  public:
+    [[nodiscard]] Fence insert_fence() override;
+    bool wait_fence(Fence fence) override;
+    void delete_fence(Fence fence) override;
+  };
+
+  struct GPU_Ring_Buffer_Statistics {
+    // Largest number of elements allocated from a single region in one frame.
+    i64 high_water_mark = 0;
+    // Number of frames that had to wait for the GPU to release their region.
+    i64 stall_count = 0;
+    // Number of allocations that did not fit in the remaining space of the region.
+    i64 failed_allocations = 0;
+    i64 frame_count = 0;
+  };
+
+  // Allocator for a persistently mapped buffer that is written by the CPU and
+  // read by the GPU. The buffer is split into region_count regions. Every frame
+  // allocates from its own region, which is guarded by a fence when the frame
+  // ends and waited on before the region is reused, so the CPU never overwrites
+  // data the GPU might still be reading.
+  //
+  // The allocator deals only in element offsets and never touches the memory.
+  class GPU_Ring_Buffer {
+  public:
+    // backend - fence backend. Must outlive the ring buffer.
+    // size - number of elements in the buffer.
+    // region_count - number of frames that may be in flight at the same time.
+    GPU_Ring_Buffer(Fence_Backend* backend, i64 size, i64 region_count = 3);
+    GPU_Ring_Buffer(GPU_Ring_Buffer const&) = delete;
+    GPU_Ring_Buffer& operator=(GPU_Ring_Buffer const&) = delete;
+    ~GPU_Ring_Buffer();
+
+    // Move to the region of the next frame.
+    // Blocks until the GPU has finished reading the region.
+    void begin_frame();
+
+    // Guard the region of the current frame with a fence.
+    // Must be called after all commands that read the region have been submitted.
+    void end_frame();
+
+    // Allocate count consecutive elements in the region of the current frame.
+    // Returns: Offset of the first element from the beginning of the buffer
+    //          or -1 if the region does not have enough space left.
+    [[nodiscard]] i64 allocate(i64 count);
+
+    // Returns: Number of elements available to a single frame.
+    [[nodiscard]] i64 get_region_size() const;
+    [[nodiscard]] GPU_Ring_Buffer_Statistics const& get_statistics() const;
+
+  private:
+    Fence_Backend* backend;
+    anton::Array<Fence> fences;
+    GPU_Ring_Buffer_Statistics statistics;
+    i64 region_size;
+    i64 region = 0;
+    // Number of elements allocated from the current region.
+    i64 head = 0;
+  };
+} // namespace anton_engine::rendering
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <anton/math/mat4.hpp>
+#include <anton/slice.hpp>
+#include <core/types.hpp>
+#include <rendering/frustum_culling.hpp>
+
+namespace anton_engine::rendering {
+  // View space froxels of a perspective projection. Tiles split the screen
+  // evenly and slices split the depth exponentially, so that froxels far from
+  // the camera are not much longer than they are wide.
+  struct Cluster_Grid {
+    i32 tiles_x;
+    i32 tiles_y;
+    i32 slices;
+    f32 near_plane;
+    f32 far_plane;
+    // Tangents of the half of the horizontal and vertical field of view.
+    f32 tan_half_fov_x;
+    f32 tan_half_fov_y;
+  };
+
+  // Light index lists of the clusters of a Cluster_Grid. The cluster of tile
+  // (x, y) in slice z has index (z * tiles_y + y) * tiles_x + x.
+  struct Light_Clusters {
+    // Pairs of the offset into light_indices and the number of lights
+    // of every cluster.
+    anton::Array<u32> ranges;
+    // Indices of the lights in ascending order within each cluster.
+    anton::Array<u32> light_indices;
+
+    // Scratch of assign_lights_to_clusters.
+    // Depths of the boundaries between slices.
+    anton::Array<f32> slice_depths;
+    // (cluster, light) pairs gathered before being sorted by cluster.
+    anton::Array<u32> pair_clusters;
+    anton::Array<u32> pair_lights;
+  };
+
+  // Build the grid from a perspective projection matrix.
+  [[nodiscard]] Cluster_Grid make_cluster_grid(Mat4 const& projection,
+                                               i32 tiles_x, i32 tiles_y,
+                                               i32 slices);
+
+  // Returns: Slice containing points at depth in front of the camera
+  //          or -1 if depth lies outside of the near and far planes.
+  [[nodiscard]] i32 get_cluster_slice(Cluster_Grid const& grid, f32 depth);
+
+  // Bin lights into the clusters they overlap. Does not touch the GPU.
+  // lights - bounding spheres of the lights in view space.
+  void assign_lights_to_clusters(Cluster_Grid const& grid,
+                                 anton::Slice<Bounding_Sphere const> lights,
+                                 Light_Clusters& clusters);
+} // namespace anton_engine::rendering
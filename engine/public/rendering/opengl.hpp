@@ -77,7 +77,29 @@ namespace anton_engine::opengl {
   };
 
   enum class Compressed_Internal_Format : u32 {
-    // TODO compressed
+    // BC1
+    rgb_s3tc_dxt1 = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+    srgb_s3tc_dxt1 = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,
+    rgba_s3tc_dxt1 = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+    srgb_alpha_s3tc_dxt1 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT,
+    // BC2
+    rgba_s3tc_dxt3 = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
+    srgb_alpha_s3tc_dxt3 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT,
+    // BC3
+    rgba_s3tc_dxt5 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+    srgb_alpha_s3tc_dxt5 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
+    // BC4
+    red_rgtc1 = GL_COMPRESSED_RED_RGTC1,
+    signed_red_rgtc1 = GL_COMPRESSED_SIGNED_RED_RGTC1,
+    // BC5
+    rg_rgtc2 = GL_COMPRESSED_RG_RGTC2,
+    signed_rg_rgtc2 = GL_COMPRESSED_SIGNED_RG_RGTC2,
+    // BC7
+    rgba_bptc_unorm = GL_COMPRESSED_RGBA_BPTC_UNORM,
+    srgb_alpha_bptc_unorm = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
+    // BC6H
+    rgb_bptc_signed_float = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT,
+    rgb_bptc_unsigned_float = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT,
   };
 
   enum class Format : u32 {
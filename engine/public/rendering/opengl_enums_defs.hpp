@@ -1346,3 +1346,17 @@
   #define GL_CONTEXT_RELEASE_BEHAVIOR 0x82FB
   #define GL_CONTEXT_RELEASE_BEHAVIOR_FLUSH 0x82FC
 #endif // !__gl_h_
+
+// EXT_texture_compression_s3tc and EXT_texture_sRGB are not part of the core
+// profile and may be missing from the loader.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+  #define ANTON_ENGINE_DEFINED_S3TC_ENUMS
+  #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+  #define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+  #define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+  #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+  #define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+  #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+  #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+  #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif // !GL_COMPRESSED_RGB_S3TC_DXT1_EXT
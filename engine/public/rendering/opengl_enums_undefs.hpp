@@ -1346,3 +1346,15 @@
   #undef GL_CONTEXT_RELEASE_BEHAVIOR
   #undef GL_CONTEXT_RELEASE_BEHAVIOR_FLUSH
 #endif // !__gl_h_
+
+#ifdef ANTON_ENGINE_DEFINED_S3TC_ENUMS
+  #undef ANTON_ENGINE_DEFINED_S3TC_ENUMS
+  #undef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+  #undef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+  #undef GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+  #undef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+  #undef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+  #undef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+  #undef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+  #undef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#endif // ANTON_ENGINE_DEFINED_S3TC_ENUMS
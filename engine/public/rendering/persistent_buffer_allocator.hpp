@@ -0,0 +1,51 @@
+#pragma once
+
+#include <anton/array.hpp>
+#include <core/types.hpp>
+
+namespace anton_engine::rendering {
+  // Allocator for a buffer that holds data across many frames, e.g. the
+  // geometry of resident meshes. Freed ranges are kept in a free list sorted by
+  // offset and merged with their neighbours. Since the GPU may still be reading
+  // a freed range, the range is reused only after frame_latency frames have
+  // begun.
+  //
+  // The allocator deals only in element offsets and never touches the memory.
+  class Persistent_Buffer_Allocator {
+  public:
+    // size - number of elements in the buffer.
+    // frame_latency - number of frames that may be in flight at the same time.
+    Persistent_Buffer_Allocator(i64 size, i64 frame_latency = 3);
+
+    // Make the ranges freed frame_latency frames ago available.
+    // Must be called after the GPU has finished the frame that began
+    // frame_latency frames ago.
+    void begin_frame();
+
+    // Allocate count consecutive elements from the first free range that fits.
+    // Returns: Offset of the first element from the beginning of the buffer
+    //          or -1 if no free range is large enough.
+    [[nodiscard]] i64 allocate(i64 count);
+
+    // Return count elements starting at offset to the allocator.
+    void free(i64 offset, i64 count);
+
+    // Returns: Number of elements that may be allocated, including the
+    //          ranges that are waiting for the GPU.
+    [[nodiscard]] i64 get_free_size() const;
+
+  private:
+    struct Range {
+      i64 offset;
+      i64 count;
+      // Number of frames that have to begin before the range may be reused.
+      i64 frames_left;
+    };
+
+    anton::Array<Range> free_ranges;
+    anton::Array<Range> pending_ranges;
+    i64 frame_latency;
+
+    void release(i64 offset, i64 count);
+  };
+} // namespace anton_engine::rendering
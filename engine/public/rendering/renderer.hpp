@@ -1,14 +1,19 @@
 #pragma once
 
 #include <anton/math/mat4.hpp>
+#include <anton/array.hpp>
 #include <anton/math/vec2.hpp>
 #include <anton/slice.hpp>
+#include <core/handle.hpp>
 #include <core/types.hpp>
 #include <engine/components/camera.hpp>
+#include <engine/components/static_mesh_component.hpp>
 #include <engine/components/transform.hpp>
 #include <engine/ecs/ecs.hpp>
 #include <engine/material.hpp>
 #include <engine/mesh.hpp>
+#include <rendering/draw_keys.hpp>
+#include <rendering/frustum_culling.hpp>
 #include <rendering/texture_format.hpp>
 #include <shaders/shader.hpp>
 
@@ -48,29 +53,60 @@ namespace anton_engine::rendering {
   void bind_transient_geometry_buffers();
   void bind_mesh_vao();
   void bind_buffers();
+  // Upload the lights in the ecs. Must be called before rendering a frame.
   void update_dynamic_lights();
 
-  // Write geometry to gpu buffers. The geometry will eventually be overwritten.
+  // Move the transient buffers to the region of the next frame.
+  // Blocks until the GPU has finished reading the data written in that region
+  // the last time the region was used.
+  void begin_frame();
+  // Guard the data written to the transient buffers during the frame with fences.
+  // Must be called after the frame has been submitted.
+  void end_frame();
+
+  // Write geometry to gpu buffers. The geometry is valid until the end of the frame.
+  // If the region of the frame has run out of space, the geometry is dropped and
+  // the returned command draws nothing.
   [[nodiscard]] Draw_Elements_Command write_geometry(anton::Slice<Vertex const>,
                                                      anton::Slice<u32 const>);
 
-  // Write matrices and materials to gpu buffers. Data will eventually be overwritten.
-  // Returns draw_id offset to be used as base_instance in draw commands.
-  [[nodiscard]] u32 write_matrices_and_materials(anton::Slice<Mat4 const>,
+  // Write matrices and materials to gpu buffers. Data is valid until the end of the frame.
+  // matrices and materials must have the same size.
+  // Returns draw_id offset to be used as base_instance in draw commands
+  // or -1 if the region of the frame has run out of space.
+  [[nodiscard]] i64 write_matrices_and_materials(anton::Slice<Mat4 const>,
                                                  anton::Slice<Material const>);
 
-  // Write geometry that will persist across multiple frames. Geometry will not be overwritten.
+  // Write geometry that will persist across multiple frames.
+  // Geometry will not be overwritten until it is freed.
   // Returns: Handle to the persistent geometry.
   [[nodiscard]] u64 write_persistent_geometry(anton::Slice<Vertex const>,
                                               anton::Slice<u32 const>);
 
-  // Loads base texture and generates mipmaps (since we don't have pregenerated mipmaps yet).
-  // pixels is a pointer to an array of pointers to the pixel data.
+  // Release the space of the persistent geometry. The space is reused once
+  // the frames in flight that might draw the geometry have finished.
+  void free_persistent_geometry(u64 handle);
+
+  // Write the geometry of mesh to the persistent buffers unless it has already
+  // been written. Meshes are uploaded once and drawn from the persistent buffers
+  // afterwards, so they should be made resident as soon as they are loaded.
+  // Returns: Handle to the persistent geometry of the mesh.
+  u64 make_mesh_resident(Handle<Mesh> handle, Mesh const& mesh);
+
+  // Free the persistent geometry of the mesh if it is resident.
+  // Must be called before the mesh is removed from the mesh manager.
+  void evict_mesh(Handle<Mesh> handle);
+
+  // Evict the mesh and remove it from the mesh manager.
+  void unload_mesh(Handle<Mesh> handle);
+
+  // Loads textures with all their mip levels.
+  // pixels is a pointer to an array of pointers to the pixel data. The data of every texture
+  //   contains format.mip_levels levels stored one after another starting with the base level.
   // handles (out) array of handles to the textures. Must be at least texture_count big.
   // handle <internal texture index (u32), layer (f32)>
-  void load_textures_generate_mipmaps(Texture_Format, i32 texture_count,
-                                      void const* const* pixels,
-                                      Texture* handles);
+  void load_textures(Texture_Format, i32 texture_count,
+                     void const* const* pixels, Texture* handles);
 
   // handle <internal texture index (u32), layer (f32)>
   // The handle is translated to gl texture handle and then bound.
@@ -84,10 +120,61 @@ namespace anton_engine::rendering {
 
   void add_draw_command(Draw_Elements_Command);
   void add_draw_command(Draw_Persistent_Geometry_Command);
+  // Draw the added commands with a single multi draw call.
+  // If the region of the frame has run out of space, the commands are dropped.
   void commit_draw();
 
-  // objects - snapshot of ecs containing Static_Mesh_Components and Transforms
-  void render_scene(ECS objects, Transform camera_transform, Mat4 view,
+  // Consecutive objects in draw order that share shader, mesh and material.
+  // Every batch is drawn with a single instanced draw command.
+  struct Draw_Batch {
+    Handle<Shader> shader;
+    // Material with texture indices replaced by the units the textures are bound to.
+    Material material;
+    // Geometry of the mesh. instance_count and base_instance are filled in
+    // by generate_draw_data.
+    Draw_Elements_Command command;
+    // Position of the first object of the batch in draw_order.
+    i64 first;
+    i64 count;
+  };
+
+  // Render-side copy of the static meshes of a scene stored as separate arrays.
+  // The arrays keep their capacity between frames, so extracting a scene does not
+  // allocate once the scene has stopped growing.
+  struct Render_Scene {
+    anton::Array<Static_Mesh_Component> meshes;
+    anton::Array<Mat4> matrices;
+    // World space bounds of the objects.
+    anton::Array<Bounding_Sphere> bounds;
+    // Sort keys packing shader, material and mesh. Sorted along with draw_order.
+    anton::Array<u64> draw_keys;
+    Radix_Sort_Scratch sort_scratch;
+    // Indices of the objects that passed culling in the order they are drawn in.
+    anton::Array<u32> draw_order;
+    anton::Array<Draw_Batch> batches;
+  };
+
+  // Copy Static_Mesh_Components, world matrices and world bounds of the entities in ecs to
+  // the render-side scene. The returned scene is overwritten by the next call to
+  // extract_scene, so it must be rendered before extracting another scene.
+  [[nodiscard]] Render_Scene& extract_scene(ECS& ecs);
+
+  // Write the matrices, materials and draw commands of consecutive batches of
+  // scene on the job pool. Does not require a GL context.
+  // Draw data of the i-th object of the batches is written at index i of
+  // matrices and materials, and the draw command of the i-th batch at index i
+  // of commands.
+  //
+  // base_instance - draw id of the first object of the batches.
+  void generate_draw_data(Render_Scene const& scene,
+                          anton::Slice<Draw_Batch const> batches,
+                          u32 base_instance, Mat4* matrices,
+                          Material* materials,
+                          Draw_Elements_Command* commands);
+
+  // scene - extracted scene containing the objects to render. Its draw order
+  //         and batches are rebuilt by the call.
+  void render_scene(Render_Scene& scene, Transform camera_transform, Mat4 view,
                     Mat4 projection);
 
   // Render a quad taking up the whole viewport
@@ -9,6 +9,7 @@ struct Point_Light {
     float attentuation_quadratic;
     float diffuse_strength;
     float specular_strength;
+    float radius;
 };
 
 struct Directional_Light {
@@ -26,10 +27,22 @@ layout(std140, binding = 0) uniform Lighting_Data {
     float todo_remove_shininess;
     int point_lights_count;
     int directional_lights_count;
-    Point_Light[16] point_lights;
     Directional_Light[16] directional_lights;
 };
 
+layout(std430, binding = 3) readonly buffer Point_Lights {
+    Point_Light point_lights[];
+};
+
+// Offset into cluster_lights and the number of lights of every cluster.
+layout(std430, binding = 4) readonly buffer Cluster_Ranges {
+    uvec2 cluster_ranges[];
+};
+
+layout(std430, binding = 5) readonly buffer Cluster_Lights {
+    uint cluster_lights[];
+};
+
 struct Camera {
     vec3 position;
 };
@@ -38,6 +51,11 @@ uniform Camera camera;
 uniform mat4 inv_view_mat;
 uniform mat4 inv_proj_mat;
 uniform vec2 viewport_size;
+uniform int cluster_tiles_x;
+uniform int cluster_tiles_y;
+uniform int cluster_slices;
+uniform float cluster_near;
+uniform float cluster_far;
 
 layout(binding = 0) uniform sampler2D gbuffer_depth;
 layout(binding = 1) uniform sampler2D gbuffer_normal;
@@ -46,13 +64,23 @@ layout(binding = 2) uniform sampler2D gbuffer_albedo_spec;
 in vec2 tex_coords;
 out vec4 frag_color;
 
+// Returns view space position.
 vec3 unproject_point(vec3 coords) {
     vec4 normalized = vec4(coords * 2.0 - 1.0, 1.0);
     vec4 homogenized = inv_proj_mat * normalized;
     if(homogenized.w != 0.0) {
         homogenized /= homogenized.w;
     }
-    return (inv_view_mat * homogenized).xyz;
+    return homogenized.xyz;
+}
+
+// Must match the binning in light_clustering.cpp.
+uint get_cluster_index(vec2 screen_coords, float depth) {
+    int slice = int(log(depth / cluster_near) * float(cluster_slices) / log(cluster_far / cluster_near));
+    slice = clamp(slice, 0, cluster_slices - 1);
+    ivec2 tiles = ivec2(cluster_tiles_x, cluster_tiles_y);
+    ivec2 tile = clamp(ivec2(screen_coords * vec2(tiles)), ivec2(0), tiles - 1);
+    return uint((slice * cluster_tiles_y + tile.y) * cluster_tiles_x + tile.x);
 }
 
 vec3 compute_point_lighting(Point_Light light, vec3 surface_position, vec3 surface_normal, vec3 view_vec, vec3 albedo_color, float specular_factor);
@@ -73,15 +101,22 @@ void main() {
     vec3 albedo = albedo_spec.rgb;
     float specular = albedo_spec.a;
     vec3 point_ndc = vec3(tex_coords, fragment_depth.r);
-    vec3 surface_position = unproject_point(point_ndc);
+    vec3 view_position = unproject_point(point_ndc);
+    vec3 surface_position = (inv_view_mat * vec4(view_position, 1.0)).xyz;
     vec3 surface_normal = texture(gbuffer_normal, tex_coords).rgb;
     
     vec3 view_vec = normalize(camera.position - surface_position);
     vec3 ambient = albedo * vec3(ambient_color) * ambient_strength;
 
     vec3 light_color = vec3(0);
-    for(int i = 0; i < point_lights_count; ++i) {
-        light_color += compute_point_lighting(point_lights[i], surface_position, surface_normal, view_vec, albedo, specular);
+    uvec2 cluster_range = cluster_ranges[get_cluster_index(tex_coords, -view_position.z)];
+    for(uint i = cluster_range.x; i < cluster_range.x + cluster_range.y; ++i) {
+        Point_Light light = point_lights[cluster_lights[i]];
+        // Lights are binned conservatively. Cut them off at the radius, so that
+        // cluster boundaries do not show.
+        if(distance(light.position, surface_position) <= light.radius) {
+            light_color += compute_point_lighting(light, surface_position, surface_normal, view_vec, albedo, specular);
+        }
     }
 
     for(int i = 0; i < directional_lights_count; ++i) {
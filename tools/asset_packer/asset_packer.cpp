@@ -0,0 +1,188 @@
+#include <asset_packer/asset_packer.hpp>
+
+#include <anton/array.hpp>
+#include <core/types.hpp>
+#include <engine/asset_pack.hpp>
+#include <engine/mesh.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace anton_engine {
+  struct Packed_Asset {
+    Asset_Pack_Entry entry;
+    // Index of the file in files.
+    i64 file;
+    // Offset of the data in the file.
+    i64 file_offset;
+  };
+
+  static anton::Array<u8> read_file(std::filesystem::path const& path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) {
+      throw std::runtime_error("Could not open " + path.generic_string());
+    }
+
+    file.seekg(0, std::ios::end);
+    i64 const size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    anton::Array<u8> contents(size);
+    file.read(reinterpret_cast<char*>(contents.data()), size);
+    return contents;
+  }
+
+  static i64 read_int64(anton::Array<u8> const& contents, i64 const offset)
+  {
+    if(offset + static_cast<i64>(sizeof(i64)) > contents.size()) {
+      throw std::runtime_error("Unexpected end of file");
+    }
+
+    i64 value;
+    memcpy(&value, contents.data() + offset, sizeof(i64));
+    return value;
+  }
+
+  // .mesh files are a sequence of records of the form
+  // guid, vertex count, vertices, index count, indices.
+  static void add_meshes(anton::Array<u8> const& contents, i64 const file,
+                         u64 const name_hash, anton::Array<Packed_Asset>& out)
+  {
+    for(i64 offset = 0; offset < contents.size();) {
+      u64 const guid = read_int64(contents, offset);
+      i64 const data_offset = offset + sizeof(u64);
+      i64 const vertex_count = read_int64(contents, data_offset);
+      i64 const index_count_offset =
+        data_offset + sizeof(i64) + vertex_count * sizeof(Vertex);
+      i64 const index_count = read_int64(contents, index_count_offset);
+      offset = index_count_offset + sizeof(i64) + index_count * sizeof(u32);
+      if(offset > contents.size()) {
+        throw std::runtime_error("Unexpected end of file");
+      }
+
+      Asset_Pack_Entry const entry{Asset_Type::mesh,
+                                   0,
+                                   name_hash,
+                                   guid,
+                                   0,
+                                   static_cast<u64>(offset - data_offset)};
+      out.push_back({entry, file, data_offset});
+    }
+  }
+
+  // .getex files are a sequence of chunks of the form
+  // chunk size, identifier, chunk.
+  static void add_textures(anton::Array<u8> const& contents, i64 const file,
+                           u64 const name_hash,
+                           anton::Array<Packed_Asset>& out)
+  {
+    for(i64 offset = 0; offset < contents.size();) {
+      i64 const chunk_size = read_int64(contents, offset);
+      u64 const identifier = read_int64(contents, offset + sizeof(i64));
+      i64 const data_offset = offset + 2 * sizeof(i64);
+      offset = data_offset + chunk_size;
+      if(offset > contents.size()) {
+        throw std::runtime_error("Unexpected end of file");
+      }
+
+      Asset_Pack_Entry const entry{Asset_Type::texture,
+                                   0,
+                                   name_hash,
+                                   identifier,
+                                   0,
+                                   static_cast<u64>(chunk_size)};
+      out.push_back({entry, file, data_offset});
+    }
+  }
+
+  [[nodiscard]] static i64 align(i64 const value)
+  {
+    return (value + asset_pack_alignment - 1) & ~(asset_pack_alignment - 1);
+  }
+
+  i64 pack_assets(std::filesystem::path const& output_file,
+                  std::filesystem::path const& assets_directory)
+  {
+    anton::Array<anton::Array<u8>> files;
+    anton::Array<Packed_Asset> assets;
+    for(auto const& entry:
+        std::filesystem::recursive_directory_iterator(assets_directory)) {
+      std::filesystem::path const& path = entry.path();
+      bool const is_mesh = path.extension() == ".mesh";
+      bool const is_texture = path.extension() == ".getex";
+      if(!entry.is_regular_file() || (!is_mesh && !is_texture)) {
+        continue;
+      }
+
+      // Loaders look assets up by their path relative to the assets directory
+      // without the extension.
+      std::filesystem::path name = path.lexically_relative(assets_directory);
+      name.replace_extension();
+      std::string const name_str = name.generic_string();
+      u64 const name_hash = hash_asset_name(name_str.data(), name_str.size());
+      files.push_back(read_file(path));
+      i64 const file = files.size() - 1;
+      if(is_mesh) {
+        add_meshes(files[file], file, name_hash, assets);
+      } else {
+        add_textures(files[file], file, name_hash, assets);
+      }
+    }
+
+    auto key = [](Asset_Pack_Entry const& entry) {
+      return std::tuple(entry.type, entry.name_hash, entry.guid);
+    };
+    std::sort(assets.begin(), assets.end(),
+              [key](Packed_Asset const& lhs, Packed_Asset const& rhs) {
+                return key(lhs.entry) < key(rhs.entry);
+              });
+    for(i64 i = 1; i < assets.size(); ++i) {
+      if(key(assets[i - 1].entry) == key(assets[i].entry)) {
+        throw std::runtime_error("Duplicate asset guid " +
+                                 std::to_string(assets[i].entry.guid));
+      }
+    }
+
+    i64 offset = align(sizeof(Asset_Pack_Header) +
+                       assets.size() * sizeof(Asset_Pack_Entry));
+    for(Packed_Asset& asset: assets) {
+      asset.entry.offset = offset;
+      offset = align(offset + asset.entry.size);
+    }
+
+    std::ofstream out(output_file, std::ios::binary);
+    if(!out) {
+      throw std::runtime_error("Could not open " +
+                               output_file.generic_string());
+    }
+
+    Asset_Pack_Header const header{asset_pack_magic,
+                                   static_cast<u64>(assets.size())};
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    for(Packed_Asset const& asset: assets) {
+      out.write(reinterpret_cast<char const*>(&asset.entry),
+                sizeof(Asset_Pack_Entry));
+    }
+
+    char const padding[asset_pack_alignment] = {};
+    for(Packed_Asset const& asset: assets) {
+      i64 const position = out.tellp();
+      out.write(padding, asset.entry.offset - position);
+      out.write(reinterpret_cast<char const*>(files[asset.file].data() +
+                                              asset.file_offset),
+                asset.entry.size);
+    }
+
+    if(!out) {
+      throw std::runtime_error("Could not write " +
+                               output_file.generic_string());
+    }
+
+    return assets.size();
+  }
+} // namespace anton_engine
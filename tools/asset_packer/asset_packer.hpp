@@ -0,0 +1,15 @@
+#pragma once
+
+#include <core/types.hpp>
+
+#include <filesystem>
+
+namespace anton_engine {
+  // Pack the .mesh and .getex files in assets_directory and its
+  // subdirectories into a single asset pack. See engine/asset_pack.hpp.
+  // Throws std::runtime_error if a file could not be read or written, is
+  // truncated or if two assets of the same file share a guid.
+  // Returns: Number of packed assets.
+  i64 pack_assets(std::filesystem::path const& output_file,
+                  std::filesystem::path const& assets_directory);
+} // namespace anton_engine
@@ -0,0 +1,39 @@
+#include <asset_packer/asset_packer.hpp>
+
+#include <exception>
+#include <iostream>
+
+static void print_usage(char const* const program)
+{
+  std::cerr << "Usage: " << program << " <output file> <assets directory>\n";
+}
+
+int main(int argc, char** argv)
+{
+  using namespace anton_engine;
+
+  if(argc != 3) {
+    print_usage(argc > 0 ? argv[0] : "AssetPacker");
+    return 1;
+  }
+
+  std::filesystem::path const output_file(argv[1]);
+  std::filesystem::path const assets_directory(argv[2]);
+  if(!std::filesystem::is_directory(assets_directory)) {
+    std::cerr << assets_directory.generic_string()
+              << " is not a directory\n";
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    i64 const count = pack_assets(output_file, assets_directory);
+    std::cout << "Packed " << count << " assets into "
+              << output_file.generic_string() << '\n';
+  } catch(std::exception const& e) {
+    std::cerr << "Could not pack assets: " << e.what() << '\n';
+    return 1;
+  }
+
+  return 0;
+}
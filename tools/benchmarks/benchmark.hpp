@@ -0,0 +1,72 @@
+#pragma once
+
+#include <core/types.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace anton_engine {
+  // Prevent the compiler from optimizing away the computation of value.
+  template<typename T>
+  void do_not_optimize(T const& value);
+
+  // Invoke function repeatedly until at least min_seconds have elapsed.
+  // Returns: Average duration of a single invocation in nanoseconds.
+  template<typename Function>
+  [[nodiscard]] f64 measure(Function const& function, f64 min_seconds = 0.25);
+
+  // Print a line of the form "name  time per invocation".
+  void report(char const* name, f64 nanoseconds);
+  // Print a line of the form "name  bytes".
+  void report_memory(char const* name, i64 bytes);
+} // namespace anton_engine
+
+namespace anton_engine {
+  template<typename T>
+  inline void do_not_optimize(T const& value)
+  {
+#if defined(_MSC_VER)
+    static void const* volatile sink;
+    sink = &value;
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+  }
+
+  template<typename Function>
+  inline f64 measure(Function const& function, f64 const min_seconds)
+  {
+    using clock = std::chrono::steady_clock;
+    // Warm up caches and branch predictors.
+    function();
+    i64 iterations = 0;
+    clock::time_point const start = clock::now();
+    clock::duration elapsed;
+    do {
+      function();
+      iterations += 1;
+      elapsed = clock::now() - start;
+    } while(std::chrono::duration<f64>(elapsed).count() < min_seconds);
+    return std::chrono::duration<f64, std::nano>(elapsed).count() / iterations;
+  }
+
+  inline void report(char const* const name, f64 const nanoseconds)
+  {
+    std::cout << "  " << std::left << std::setw(48) << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(3);
+    if(nanoseconds >= 1e6) {
+      std::cout << nanoseconds / 1e6 << " ms\n";
+    } else if(nanoseconds >= 1e3) {
+      std::cout << nanoseconds / 1e3 << " us\n";
+    } else {
+      std::cout << nanoseconds << " ns\n";
+    }
+  }
+
+  inline void report_memory(char const* const name, i64 const bytes)
+  {
+    std::cout << "  " << std::left << std::setw(48) << name << std::right
+              << std::setw(14) << bytes << " B\n";
+  }
+} // namespace anton_engine
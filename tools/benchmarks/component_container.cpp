@@ -0,0 +1,113 @@
+#include <benchmark.hpp>
+
+#include <anton/array.hpp>
+#include <core/random.hpp>
+#include <engine/ecs/component_container.hpp>
+#include <engine/ecs/entity.hpp>
+
+namespace anton_engine {
+  // Sparse set with a single contiguous sparse array. The layout used by
+  // Component_Container_Base before the sparse arrays were paged.
+  class Flat_Sparse_Set {
+  public:
+    void add(Entity const entity)
+    {
+      i64 const index = entity_index(entity);
+      if(indirect.size() <= index) {
+        indirect.resize(index + 1, npos);
+      }
+      indirect[index] = entities.size();
+      entities.push_back(entity);
+    }
+
+    [[nodiscard]] bool has(Entity const entity) const
+    {
+      i64 const index = entity_index(entity);
+      return index < indirect.size() && indirect[index] != npos &&
+             entities[indirect[index]] == entity;
+    }
+
+    [[nodiscard]] i64 get_sparse_memory_usage() const
+    {
+      return indirect.capacity() * sizeof(i64);
+    }
+
+  private:
+    constexpr static i64 npos = -1;
+
+    anton::Array<i64> indirect;
+    anton::Array<Entity> entities;
+  };
+
+  struct Empty_Component {};
+
+  static void run_scenario(char const* const name,
+                           anton::Array<Entity> const& stored,
+                           anton::Array<Entity> const& probes)
+  {
+    Flat_Sparse_Set flat;
+    Component_Container<Empty_Component> paged;
+    for(Entity const entity: stored) {
+      flat.add(entity);
+      paged.add(entity);
+    }
+
+    std::cout << name << ": " << stored.size() << " entities\n";
+    report_memory("sparse memory flat", flat.get_sparse_memory_usage());
+    report_memory("sparse memory paged", paged.get_sparse_memory_usage());
+    f64 const flat_time = measure([&flat, &probes] {
+      i64 found = 0;
+      for(Entity const entity: probes) {
+        found += flat.has(entity);
+      }
+      do_not_optimize(found);
+    });
+    f64 const paged_time = measure([&paged, &probes] {
+      i64 found = 0;
+      for(Entity const entity: probes) {
+        found += paged.has(entity);
+      }
+      do_not_optimize(found);
+    });
+    report("has() flat", flat_time / probes.size());
+    report("has() paged", paged_time / probes.size());
+  }
+
+  void benchmark_component_container()
+  {
+    seed_default_random_engine(8493);
+    constexpr i64 probe_count = 1 << 16;
+
+    // Every entity has the component, e.g. Transform.
+    {
+      constexpr i64 entity_count = 100000;
+      anton::Array<Entity> stored{anton::reserve, entity_count};
+      for(i64 i = 0; i < entity_count; ++i) {
+        stored.push_back(Entity{static_cast<u64>(i)});
+      }
+
+      anton::Array<Entity> probes{anton::reserve, probe_count};
+      for(i64 i = 0; i < probe_count; ++i) {
+        probes.push_back(stored[random_i64(0, entity_count - 1)]);
+      }
+      run_scenario("dense", stored, probes);
+    }
+
+    // Few entities spread over a large range of indices, e.g. Camera.
+    {
+      constexpr i64 entity_count = 16;
+      constexpr i64 max_index = 1000000;
+      anton::Array<Entity> stored{anton::reserve, entity_count};
+      for(i64 i = 0; i < entity_count; ++i) {
+        stored.push_back(Entity{static_cast<u64>(i * (max_index / 16) +
+                                                 random_i64(0, 1000))});
+      }
+
+      anton::Array<Entity> probes{anton::reserve, probe_count};
+      for(i64 i = 0; i < probe_count; ++i) {
+        probes.push_back(Entity{static_cast<u64>(random_i64(0, max_index))});
+      }
+      run_scenario("sparse", stored, probes);
+    }
+  }
+} // namespace anton_engine
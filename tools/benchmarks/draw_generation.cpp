@@ -0,0 +1,76 @@
+#include <benchmark.hpp>
+
+#include <anton/array.hpp>
+#include <anton/math/mat4.hpp>
+#include <rendering/renderer.hpp>
+
+namespace anton_engine {
+  using namespace rendering;
+
+  // Single threaded equivalent of generate_draw_data. The way draw data was
+  // written before the generation was moved to the job pool.
+  static void generate_draw_data_serial(Render_Scene const& scene,
+                                        anton::Slice<Draw_Batch const> batches,
+                                        u32 const base_instance,
+                                        Mat4* const matrices,
+                                        Material* const materials,
+                                        Draw_Elements_Command* const commands)
+  {
+    i64 const first_object = batches[0].first;
+    for(i64 batch = 0; batch < batches.size(); ++batch) {
+      Draw_Batch const& current = batches[batch];
+      i64 const offset = current.first - first_object;
+      Draw_Elements_Command cmd = current.command;
+      cmd.instance_count = current.count;
+      cmd.base_instance = base_instance + offset;
+      commands[batch] = cmd;
+      for(i64 i = 0; i < current.count; ++i) {
+        u32 const object = scene.draw_order[current.first + i];
+        matrices[offset + i] = scene.matrices[object];
+        materials[offset + i] = current.material;
+      }
+    }
+  }
+
+  void benchmark_draw_generation()
+  {
+    // Objects sharing mesh and material.
+    constexpr i64 batch_size = 64;
+    i64 const object_counts[] = {10000, 100000, 1000000};
+    for(i64 const object_count: object_counts) {
+      Render_Scene scene;
+      scene.matrices.resize(object_count, Mat4(1.0f));
+      scene.draw_order.resize(object_count);
+      // Objects are drawn in an order different from the storage order.
+      for(i64 i = 0; i < object_count; ++i) {
+        scene.draw_order[i] = (i * 7919) % object_count;
+      }
+
+      for(i64 first = 0; first < object_count; first += batch_size) {
+        Draw_Batch batch = {};
+        batch.command.count = 36;
+        batch.first = first;
+        batch.count = anton::min(batch_size, object_count - first);
+        scene.batches.push_back(batch);
+      }
+
+      anton::Array<Mat4> matrices(object_count);
+      anton::Array<Material> materials(object_count);
+      anton::Array<Draw_Elements_Command> commands(scene.batches.size());
+      f64 const serial_time = measure([&] {
+        generate_draw_data_serial(scene, scene.batches, 0, matrices.data(),
+                                  materials.data(), commands.data());
+        do_not_optimize(matrices[0]);
+      });
+      f64 const parallel_time = measure([&] {
+        generate_draw_data(scene, scene.batches, 0, matrices.data(),
+                           materials.data(), commands.data());
+        do_not_optimize(matrices[0]);
+      });
+
+      std::cout << object_count << " objects\n";
+      report("serial", serial_time);
+      report("generate_draw_data", parallel_time);
+    }
+  }
+} // namespace anton_engine
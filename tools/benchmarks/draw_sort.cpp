@@ -0,0 +1,62 @@
+#include <benchmark.hpp>
+
+#include <anton/array.hpp>
+#include <core/random.hpp>
+#include <engine/components/static_mesh_component.hpp>
+#include <rendering/draw_keys.hpp>
+
+#include <algorithm>
+
+namespace anton_engine {
+  using namespace rendering;
+
+  void benchmark_draw_sort()
+  {
+    seed_default_random_engine(1207);
+    i64 const object_counts[] = {10000, 100000, 1000000};
+    for(i64 const object_count: object_counts) {
+      anton::Array<Static_Mesh_Component> meshes(object_count);
+      for(i64 i = 0; i < object_count; ++i) {
+        meshes[i].shader_handle.value = handle_value(random_i64(0, 7), 1);
+        meshes[i].material_handle.value = handle_value(random_i64(0, 255), 1);
+        meshes[i].mesh_handle.value = handle_value(random_i64(0, 1023), 1);
+      }
+
+      anton::Array<u32> order(object_count);
+      // The previous path. std::sort of the draw order with a three-way
+      // comparison of the handles.
+      f64 const std_sort_time = measure([&] {
+        for(i64 i = 0; i < object_count; ++i) {
+          order[i] = i;
+        }
+        std::sort(order.begin(), order.end(),
+                  [&meshes](u32 const lhs_index, u32 const rhs_index) {
+                    Static_Mesh_Component const& lhs = meshes[lhs_index];
+                    Static_Mesh_Component const& rhs = meshes[rhs_index];
+                    return lhs.shader_handle < rhs.shader_handle ||
+                           (lhs.shader_handle == rhs.shader_handle &&
+                            lhs.material_handle < rhs.material_handle) ||
+                           (lhs.shader_handle == rhs.shader_handle &&
+                            lhs.material_handle == rhs.material_handle &&
+                            lhs.mesh_handle < rhs.mesh_handle);
+                  });
+        do_not_optimize(order[0]);
+      });
+
+      anton::Array<u64> keys(object_count);
+      Radix_Sort_Scratch scratch;
+      f64 const radix_sort_time = measure([&] {
+        for(i64 i = 0; i < object_count; ++i) {
+          order[i] = i;
+          keys[i] = make_draw_key(meshes[i]);
+        }
+        radix_sort(keys, order, scratch);
+        do_not_optimize(order[0]);
+      });
+
+      std::cout << object_count << " objects\n";
+      report("std::sort", std_sort_time);
+      report("make_draw_key + radix_sort", radix_sort_time);
+    }
+  }
+} // namespace anton_engine
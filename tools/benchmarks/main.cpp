@@ -0,0 +1,52 @@
+#include <core/types.hpp>
+#include <engine/ecs/jobs_management.hpp>
+
+#include <cstring>
+#include <iostream>
+
+namespace anton_engine {
+  void benchmark_component_container();
+  void benchmark_draw_generation();
+  void benchmark_draw_sort();
+  void benchmark_ray_intersection();
+#if ANTON_WITH_EDITOR
+  void benchmark_obj_import();
+  void benchmark_png_decode();
+#endif
+} // namespace anton_engine
+
+// argv[1] is an optional filter. Only benchmarks whose names contain it
+// are run.
+int main(int argc, char** argv)
+{
+  using namespace anton_engine;
+
+  struct Benchmark {
+    char const* name;
+    void (*run)();
+  };
+
+  Benchmark const benchmarks[] = {
+    {"component_container", benchmark_component_container},
+    {"draw_generation", benchmark_draw_generation},
+    {"draw_sort", benchmark_draw_sort},
+    {"ray_intersection", benchmark_ray_intersection},
+#if ANTON_WITH_EDITOR
+    {"obj_import", benchmark_obj_import},
+    {"png_decode", benchmark_png_decode},
+#endif
+  };
+
+  char const* const filter = argc > 1 ? argv[1] : nullptr;
+  init_jobs();
+  for(Benchmark const& benchmark: benchmarks) {
+    if(filter && !strstr(benchmark.name, filter)) {
+      continue;
+    }
+
+    std::cout << "[" << benchmark.name << "]\n";
+    benchmark.run();
+  }
+  terminate_jobs();
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <benchmark.hpp>
+
+#include <anton/array.hpp>
+#include <content_browser/importers/obj.hpp>
+
+#include <cstdio>
+
+namespace anton_engine {
+  static void append(anton::Array<u8>& data, char const* const text,
+                     i64 const length)
+  {
+    for(i64 i = 0; i < length; ++i) {
+      data.push_back(text[i]);
+    }
+  }
+
+  // Grid of side * side vertices with texture coordinates and normals
+  // connected by quads.
+  [[nodiscard]] static anton::Array<u8> generate_grid_obj(i64 const side)
+  {
+    anton::Array<u8> data;
+    char line[128];
+    for(i64 z = 0; z < side; ++z) {
+      for(i64 x = 0; x < side; ++x) {
+        i64 length =
+          snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x * 0.01,
+                   (x * 7 + z * 13) % 100 * 0.001, z * 0.01);
+        append(data, line, length);
+        length = snprintf(line, sizeof(line), "vt %.6f %.6f\n",
+                          (f64)x / side, (f64)z / side);
+        append(data, line, length);
+        append(data, "vn 0.000000 1.000000 0.000000\n", 30);
+      }
+    }
+
+    append(data, "o grid\n", 7);
+    for(i64 z = 0; z + 1 < side; ++z) {
+      for(i64 x = 0; x + 1 < side; ++x) {
+        i64 const a = z * side + x + 1;
+        i64 const b = a + 1;
+        i64 const c = a + side + 1;
+        i64 const d = a + side;
+        i64 const length = snprintf(
+          line, sizeof(line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld "
+                              "%lld/%lld/%lld\n",
+          (long long)a, (long long)a, (long long)a, (long long)b, (long long)b,
+          (long long)b, (long long)c, (long long)c, (long long)c, (long long)d,
+          (long long)d, (long long)d);
+        append(data, line, length);
+      }
+    }
+    return data;
+  }
+
+  void benchmark_obj_import()
+  {
+    i64 const sides[] = {100, 1000};
+    for(i64 const side: sides) {
+      anton::Array<u8> const data = generate_grid_obj(side);
+      std::cout << side * side << " vertices\n";
+      report_memory("file size", data.size());
+      // A single chunk is the way files were parsed before the parsing was
+      // split into chunks. Large files take seconds, so measure one import.
+      f64 const single_time = measure(
+        [&data] {
+          anton::Array<importers::Mesh> const meshes =
+            importers::import_obj(data, data.size());
+          do_not_optimize(meshes[0].vertices[0]);
+        },
+        0.0);
+      f64 const chunked_time = measure(
+        [&data] {
+          anton::Array<importers::Mesh> const meshes =
+            importers::import_obj(data);
+          do_not_optimize(meshes[0].vertices[0]);
+        },
+        0.0);
+      report("import_obj single chunk", single_time);
+      report("import_obj chunked", chunked_time);
+    }
+  }
+} // namespace anton_engine
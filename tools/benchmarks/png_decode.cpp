@@ -0,0 +1,184 @@
+#include <benchmark.hpp>
+
+#include <anton/array.hpp>
+#include <content_browser/importers/png.hpp>
+#include <zlib.h>
+
+namespace anton_engine {
+  static void write_u32_be(anton::Array<u8>& data, u32 const value)
+  {
+    data.push_back(value >> 24);
+    data.push_back(value >> 16);
+    data.push_back(value >> 8);
+    data.push_back(value);
+  }
+
+  static void write_chunk(anton::Array<u8>& png, char const* const type,
+                          u8 const* const data, i64 const size)
+  {
+    write_u32_be(png, size);
+    i64 const type_offset = png.size();
+    for(i64 i = 0; i < 4; ++i) {
+      png.push_back(type[i]);
+    }
+
+    for(i64 i = 0; i < size; ++i) {
+      png.push_back(data[i]);
+    }
+
+    u32 const crc = crc32(0, png.data() + type_offset, size + 4);
+    write_u32_be(png, crc);
+  }
+
+  [[nodiscard]] static u8 paeth_predictor(i32 const a, i32 const b,
+                                          i32 const c)
+  {
+    i32 const p = a + b - c;
+    i32 const pa = p > a ? p - a : a - p;
+    i32 const pb = p > b ? p - b : b - p;
+    i32 const pc = p > c ? p - c : c - p;
+    if(pa <= pb && pa <= pc) {
+      return a;
+    } else if(pb <= pc) {
+      return b;
+    } else {
+      return c;
+    }
+  }
+
+  // Filtered scanlines of an 8 bit image with every filter type in turn.
+  [[nodiscard]] static anton::Array<u8>
+  filter_image(anton::Array<u8> const& pixels, i64 const width,
+               i64 const height, i32 const pixel_width)
+  {
+    i64 const scanline_width = width * pixel_width;
+    anton::Array<u8> const zeros(scanline_width, 0);
+    anton::Array<u8> filtered{anton::reserve, height * (scanline_width + 1)};
+    for(i64 y = 0; y < height; ++y) {
+      u8 const filter = y % 5;
+      u8 const* const row = pixels.data() + y * scanline_width;
+      u8 const* const prev = y > 0 ? row - scanline_width : zeros.data();
+      filtered.push_back(filter);
+      for(i64 i = 0; i < scanline_width; ++i) {
+        i32 const a = i >= pixel_width ? row[i - pixel_width] : 0;
+        i32 const b = prev[i];
+        i32 const c = i >= pixel_width ? prev[i - pixel_width] : 0;
+        i32 predictor = 0;
+        switch(filter) {
+        case 1:
+          predictor = a;
+          break;
+        case 2:
+          predictor = b;
+          break;
+        case 3:
+          predictor = (a + b) >> 1;
+          break;
+        case 4:
+          predictor = paeth_predictor(a, b, c);
+          break;
+        }
+        filtered.push_back(row[i] - predictor);
+      }
+    }
+    return filtered;
+  }
+
+  // Smooth gradients with a little noise, so that the image compresses
+  // similarly to a photo rather than to a flat color.
+  [[nodiscard]] static anton::Array<u8>
+  generate_pixels(i64 const width, i64 const height, i32 const pixel_width)
+  {
+    anton::Array<u8> pixels{anton::reserve, width * height * pixel_width};
+    u32 noise = 12345;
+    for(i64 y = 0; y < height; ++y) {
+      for(i64 x = 0; x < width; ++x) {
+        for(i32 channel = 0; channel < pixel_width; ++channel) {
+          noise = noise * 1664525 + 1013904223;
+          i64 const gradient = (x * (channel + 1) + y * (3 - channel)) / 32;
+          pixels.push_back(gradient + (noise >> 29));
+        }
+      }
+    }
+    return pixels;
+  }
+
+  [[nodiscard]] static anton::Array<u8> encode_png(i64 const width,
+                                                   i64 const height,
+                                                   i32 const pixel_width)
+  {
+    anton::Array<u8> const pixels = generate_pixels(width, height, pixel_width);
+    anton::Array<u8> const filtered =
+      filter_image(pixels, width, height, pixel_width);
+    uLongf compressed_size = compressBound(filtered.size());
+    anton::Array<u8> compressed(compressed_size);
+    compress2(compressed.data(), &compressed_size, filtered.data(),
+              filtered.size(), 1);
+
+    anton::Array<u8> png;
+    u8 const signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    for(u8 const byte: signature) {
+      png.push_back(byte);
+    }
+
+    anton::Array<u8> header;
+    write_u32_be(header, width);
+    write_u32_be(header, height);
+    // Bit depth 8, truecolor with or without alpha, default compression and
+    // filtering, no interlacing.
+    u8 const header_rest[] = {8, (u8)(pixel_width == 4 ? 6 : 2), 0, 0, 0};
+    for(u8 const byte: header_rest) {
+      header.push_back(byte);
+    }
+    write_chunk(png, "IHDR", header.data(), header.size());
+    write_chunk(png, "IDAT", compressed.data(), compressed_size);
+    write_chunk(png, "IEND", nullptr, 0);
+    return png;
+  }
+
+  void benchmark_png_decode()
+  {
+    constexpr i64 width = 7680;
+    constexpr i64 height = 4320;
+    u8 const filters[] = {1, 3, 4};
+    char const* const scalar_names[] = {"sub scalar", "average scalar",
+                                        "paeth scalar"};
+    char const* const sse_names[] = {"sub", "average", "paeth"};
+    i32 const pixel_widths[] = {3, 4};
+    for(i32 const pixel_width: pixel_widths) {
+      std::cout << "8K " << (pixel_width == 4 ? "rgba8" : "rgb8") << "\n";
+      i64 const scanline_width = width * pixel_width;
+      anton::Array<u8> const in = generate_pixels(width, 1, pixel_width);
+      anton::Array<u8> const prev = generate_pixels(width, 1, pixel_width);
+      anton::Array<u8> out(scanline_width);
+      for(i64 i = 0; i < 3; ++i) {
+        f64 const scalar_time = measure([&] {
+          importers::unfilter_scanline_scalar(filters[i], in.data(),
+                                              prev.data(), out.data(),
+                                              scanline_width, pixel_width);
+          do_not_optimize(out[0]);
+        });
+        f64 const sse_time = measure([&] {
+          importers::unfilter_scanline(filters[i], in.data(), prev.data(),
+                                       out.data(), scanline_width,
+                                       pixel_width);
+          do_not_optimize(out[0]);
+        });
+        // Per image rather than per scanline to compare with the decode.
+        report(scalar_names[i], scalar_time * height);
+        report(sse_names[i], sse_time * height);
+      }
+
+      anton::Array<u8> const png = encode_png(width, height, pixel_width);
+      report_memory("file size", png.size());
+      // Decoding takes long enough that a single run is representative.
+      f64 const decode_time = measure(
+        [&png] {
+          importers::Image const image = importers::import_png(png);
+          do_not_optimize(image.data[0]);
+        },
+        0.0);
+      report("import_png", decode_time);
+    }
+  }
+} // namespace anton_engine
@@ -0,0 +1,144 @@
+#include <benchmark.hpp>
+
+#include <anton/array.hpp>
+#include <anton/math/mat3.hpp>
+#include <anton/math/math.hpp>
+#include <anton/math/transform.hpp>
+#include <anton/optional.hpp>
+#include <core/random.hpp>
+#include <engine/mesh.hpp>
+#include <physics/bvh.hpp>
+#include <physics/intersection_tests.hpp>
+#include <physics/obb.hpp>
+
+namespace anton_engine {
+  // The matrix-inverse triangle test used before intersect_ray_triangle was
+  // replaced by Moller-Trumbore.
+  [[nodiscard]] static anton::Optional<Raycast_Hit>
+  intersect_ray_triangle_inverse(Ray const ray, Vec3 const a, Vec3 const b,
+                                 Vec3 const c)
+  {
+    Vec3 const ao = ray.origin - a;
+    Vec3 const ab = b - a;
+    Vec3 const ac = c - a;
+    Mat3 const inv_mat = math::inverse(Mat3{ab, ac, -ray.direction});
+    Vec3 const result = inv_mat * ao;
+    f32 const u = result.x;
+    f32 const v = result.y;
+    f32 const t = result.z;
+    if(u < 0 || v < 0 || u + v > 1 || t < 0) {
+      return anton::null_optional;
+    }
+
+    Vec3 r(a + u * ab + v * ac);
+    return Raycast_Hit{r, {u, v, 1 - u - v}, t};
+  }
+
+  // Grid of quads in the xz plane displaced along y.
+  [[nodiscard]] static Mesh generate_terrain(i64 const quads_per_side)
+  {
+    anton::Array<Vertex> vertices;
+    anton::Array<u32> indices;
+    i64 const side = quads_per_side + 1;
+    for(i64 z = 0; z < side; ++z) {
+      for(i64 x = 0; x < side; ++x) {
+        f32 const height = math::sin(x * 0.3f) * math::cos(z * 0.2f);
+        Vec3 const position = {(f32)x, height, (f32)z};
+        vertices.push_back(Vertex(position, Vec3(0.0f, 1.0f, 0.0f), Vec3(),
+                                  Vec3(), Vec2()));
+      }
+    }
+
+    for(i64 z = 0; z < quads_per_side; ++z) {
+      for(i64 x = 0; x < quads_per_side; ++x) {
+        u32 const i = z * side + x;
+        u32 const quad[] = {i, i + side, i + 1, i + 1, i + side, i + side + 1};
+        for(u32 const index: quad) {
+          indices.push_back(index);
+        }
+      }
+    }
+    return Mesh(ANTON_MOV(vertices), ANTON_MOV(indices));
+  }
+
+  // Rays from above the mesh. About half of them miss it.
+  [[nodiscard]] static anton::Array<Ray> generate_rays(f32 const extent)
+  {
+    anton::Array<Ray> rays;
+    for(i64 i = 0; i < 256; ++i) {
+      Vec3 const origin = {random_f32(0.0f, extent), 10.0f,
+                           random_f32(0.0f, extent)};
+      Vec3 const target = {random_f32(-extent, 2.0f * extent), 0.0f,
+                           random_f32(-extent, 2.0f * extent)};
+      rays.push_back({origin, math::normalize(target - origin)});
+    }
+    return rays;
+  }
+
+  template<typename Function>
+  static void report_per_ray(char const* const name,
+                             anton::Array<Ray> const& rays,
+                             Function const& function)
+  {
+    f64 const time = measure([&rays, &function] {
+      i64 hits = 0;
+      for(Ray const& ray: rays) {
+        hits += function(ray);
+      }
+      do_not_optimize(hits);
+    });
+    report(name, time / rays.size());
+  }
+
+  void benchmark_ray_intersection()
+  {
+    seed_default_random_engine(2209);
+    i64 const quad_counts[] = {8, 32, 128};
+    for(i64 const quads_per_side: quad_counts) {
+      Mesh const mesh = generate_terrain(quads_per_side);
+      BVH const bvh = build_mesh_bvh(mesh);
+      anton::Array<Ray> const rays = generate_rays(quads_per_side);
+      Mat4 const model_transform = math::translate(Vec3(1.0f, 2.0f, 3.0f));
+      Mat4 const inv_model_transform = math::inverse(model_transform);
+      std::cout << mesh.indices.size() / 3 << " triangles\n";
+      report_per_ray("matrix inverse per triangle", rays, [&mesh](Ray ray) {
+        for(i64 i = 0; i < mesh.indices.size(); i += 3) {
+          if(intersect_ray_triangle_inverse(
+               ray, mesh.vertices[mesh.indices[i]].position,
+               mesh.vertices[mesh.indices[i + 1]].position,
+               mesh.vertices[mesh.indices[i + 2]].position)) {
+            return true;
+          }
+        }
+        return false;
+      });
+      report_per_ray("test_ray_mesh", rays,
+                     [&mesh](Ray ray) { return test_ray_mesh(ray, mesh); });
+      report_per_ray("intersect_ray_mesh transform", rays,
+                     [&mesh, &model_transform](Ray ray) {
+                       return intersect_ray_mesh(ray, mesh, model_transform)
+                         .holds_value();
+                     });
+      report_per_ray("intersect_ray_mesh bvh", rays,
+                     [&mesh, &bvh, &inv_model_transform](Ray ray) {
+                       Ray const model_ray = {
+                         Vec3(inv_model_transform * Vec4(ray.origin, 1.0f)),
+                         Vec3(inv_model_transform *
+                              Vec4(ray.direction, 0.0f))};
+                       return intersect_ray_mesh(model_ray, mesh, bvh)
+                         .holds_value();
+                     });
+    }
+
+    {
+      anton::Array<Ray> const rays = generate_rays(8.0f);
+      OBB const obb = {Vec3(4.0f, 0.0f, 4.0f), math::normalize(Vec3(1, 0, 1)),
+                       Vec3(0.0f, 1.0f, 0.0f), math::normalize(Vec3(-1, 0, 1)),
+                       Vec3(2.0f, 1.0f, 3.0f)};
+      std::cout << "obb\n";
+      report_per_ray("intersect_ray_obb", rays, [&obb](Ray ray) {
+        return intersect_ray_obb(ray, obb).holds_value();
+      });
+    }
+  }
+} // namespace anton_engine
@@ -0,0 +1,236 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <asset_packer/asset_packer.hpp>
+#include <core/exception.hpp>
+#include <engine/asset_pack.hpp>
+#include <engine/assets.hpp>
+#include <engine/mesh.hpp>
+#include <rendering/texture_format.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace anton_engine {
+  namespace fs = std::filesystem;
+
+  static fs::path const test_directory =
+    fs::temp_directory_path() / "anton_engine_test_asset_pack";
+  static fs::path const assets_directory = test_directory / "assets";
+  static fs::path const pack_path = test_directory / "assets.gepack";
+
+  static void append(anton::Array<u8>& bytes, void const* const data,
+                     i64 const size)
+  {
+    i64 const offset = bytes.size();
+    bytes.resize(offset + size);
+    memcpy(bytes.data() + offset, data, size);
+  }
+
+  static void append_int64(anton::Array<u8>& bytes, i64 const value)
+  {
+    append(bytes, &value, sizeof(i64));
+  }
+
+  static void write_file(fs::path const& path, anton::Array<u8> const& bytes)
+  {
+    fs::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+  }
+
+  [[nodiscard]] static Mesh make_mesh(i64 const vertex_count)
+  {
+    anton::Array<Vertex> vertices(vertex_count);
+    anton::Array<u32> indices;
+    for(i64 i = 0; i < vertex_count; ++i) {
+      f32 const value = static_cast<f32>(i);
+      vertices[i] = Vertex(Vec3{value, 1.0f, 2.0f}, Vec3{0.0f, 0.0f, 1.0f},
+                           Vec3{1.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f},
+                           Vec2{value, 0.5f});
+      indices.push_back(vertex_count - 1 - i);
+    }
+    return {ANTON_MOV(vertices), ANTON_MOV(indices)};
+  }
+
+  // Record of a .mesh file. See save_meshes.
+  static void append_mesh(anton::Array<u8>& bytes, u64 const guid,
+                          Mesh const& mesh)
+  {
+    append(bytes, &guid, sizeof(u64));
+    append_int64(bytes, mesh.vertices.size());
+    append(bytes, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    append_int64(bytes, mesh.indices.size());
+    append(bytes, mesh.indices.data(), mesh.indices.size() * sizeof(u32));
+  }
+
+  [[nodiscard]] static bool equal(Mesh const& lhs, Mesh const& rhs)
+  {
+    return lhs.vertices.size() == rhs.vertices.size() &&
+           lhs.indices.size() == rhs.indices.size() &&
+           memcmp(lhs.vertices.data(), rhs.vertices.data(),
+                  lhs.vertices.size() * sizeof(Vertex)) == 0 &&
+           memcmp(lhs.indices.data(), rhs.indices.data(),
+                  lhs.indices.size() * sizeof(u32)) == 0;
+  }
+
+  constexpr u64 texture_id = 11;
+
+  [[nodiscard]] static Texture_Format make_texture_format()
+  {
+    Texture_Format format = {};
+    format.width = 4;
+    format.height = 4;
+    format.mip_levels = 3;
+    return format;
+  }
+
+  // Pixels of all levels of a 4x4 rgba8 texture one after another.
+  [[nodiscard]] static anton::Array<u8> make_texture_pixels()
+  {
+    anton::Array<u8> pixels(4 * (16 + 4 + 1));
+    for(i64 i = 0; i < pixels.size(); ++i) {
+      pixels[i] = i * 7;
+    }
+    return pixels;
+  }
+
+  // .getex file with a single chunk. See write_texture.
+  [[nodiscard]] static anton::Array<u8> make_texture_file()
+  {
+    Texture_Format const format = make_texture_format();
+    anton::Array<u8> const pixels = make_texture_pixels();
+    anton::Array<u8> chunk;
+    append(chunk, &format, sizeof(Texture_Format));
+    i64 const level_sizes[] = {64, 16, 4};
+    i64 offset = 0;
+    for(i64 const level_size: level_sizes) {
+      append_int64(chunk, level_size);
+      append(chunk, pixels.data() + offset, level_size);
+      offset += level_size;
+    }
+
+    anton::Array<u8> file;
+    append_int64(file, chunk.size());
+    append(file, &texture_id, sizeof(u64));
+    append(file, chunk.data(), chunk.size());
+    return file;
+  }
+
+  static void write_assets()
+  {
+    fs::remove_all(test_directory);
+    anton::Array<u8> meshes;
+    append_mesh(meshes, 7, make_mesh(5));
+    append_mesh(meshes, 3, make_mesh(9));
+    write_file(assets_directory / "models" / "box.mesh", meshes);
+    write_file(assets_directory / "textures" / "brick.getex",
+               make_texture_file());
+    // Files of other types are skipped.
+    write_file(assets_directory / "notes.txt", anton::Array<u8>(3, 0));
+  }
+
+  static void test_pack_and_find()
+  {
+    write_assets();
+    CHECK(pack_assets(pack_path, assets_directory) == 3);
+
+    Asset_Pack pack;
+    CHECK(pack.open(pack_path.generic_string().data()));
+    u64 const name_hash = hash_asset_name("models/box", 10);
+    anton::Slice<u8 const> const mesh =
+      pack.find(Asset_Type::mesh, name_hash, 3);
+    // Vertex count, vertices, index count, indices.
+    CHECK(mesh.size() == 16 + 9 * (sizeof(Vertex) + sizeof(u32)));
+    CHECK(reinterpret_cast<u64>(mesh.data()) % asset_pack_alignment == 0);
+    CHECK(pack.find(Asset_Type::mesh, name_hash, 4).size() == 0);
+    CHECK(pack.find(Asset_Type::texture, name_hash, 3).size() == 0);
+    pack.close();
+    CHECK(!pack.is_open());
+
+    fs::path const missing = test_directory / "missing.gepack";
+    CHECK(!pack.open(missing.generic_string().data()));
+  }
+
+  static void test_load_from_pack()
+  {
+    write_assets();
+    CHECK(pack_assets(pack_path, assets_directory) == 3);
+    // The loose files must not be read.
+    fs::remove_all(assets_directory);
+
+    CHECK(assets::mount_asset_pack(pack_path.generic_string().data()));
+    CHECK(equal(assets::load_mesh("models/box.mesh", 7), make_mesh(5)));
+    CHECK(equal(assets::load_mesh("models/box.mesh", 3), make_mesh(9)));
+
+    anton::Array<u8> pixels;
+    Texture_Format const format =
+      assets::load_texture("textures/brick", texture_id, pixels);
+    Texture_Format const expected_format = make_texture_format();
+    CHECK(memcmp(&format, &expected_format, sizeof(Texture_Format)) == 0);
+    anton::Array<u8> const expected_pixels = make_texture_pixels();
+    CHECK(pixels.size() == expected_pixels.size() &&
+          memcmp(pixels.data(), expected_pixels.data(), pixels.size()) == 0);
+    assets::unmount_asset_pack();
+  }
+
+  static void test_invalid_assets()
+  {
+    write_assets();
+    // Same guid in the same file.
+    anton::Array<u8> meshes;
+    append_mesh(meshes, 7, make_mesh(2));
+    append_mesh(meshes, 7, make_mesh(3));
+    write_file(assets_directory / "models" / "box.mesh", meshes);
+    bool thrown = false;
+    try {
+      (void)pack_assets(pack_path, assets_directory);
+    } catch(std::runtime_error const&) {
+      thrown = true;
+    }
+    CHECK(thrown);
+
+    // The same guid in different files is fine.
+    write_assets();
+    anton::Array<u8> other;
+    append_mesh(other, 7, make_mesh(2));
+    write_file(assets_directory / "models" / "sphere.mesh", other);
+    CHECK(pack_assets(pack_path, assets_directory) == 4);
+
+    // Truncated record.
+    write_assets();
+    meshes.resize(meshes.size() - 1);
+    write_file(assets_directory / "models" / "box.mesh", meshes);
+    thrown = false;
+    try {
+      (void)pack_assets(pack_path, assets_directory);
+    } catch(std::runtime_error const&) {
+      thrown = true;
+    }
+    CHECK(thrown);
+
+    // Not an asset pack.
+    write_file(pack_path, anton::Array<u8>(64, 1));
+    Asset_Pack pack;
+    thrown = false;
+    try {
+      (void)pack.open(pack_path.generic_string().data());
+    } catch(Exception const&) {
+      thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(!pack.is_open());
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_pack_and_find();
+  test_load_from_pack();
+  test_invalid_assets();
+  fs::remove_all(test_directory);
+  return report_test_results();
+}
@@ -0,0 +1,147 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <engine/ecs/ecs.hpp>
+#include <engine/ecs/jobs_management.hpp>
+
+#include <cstring>
+
+namespace anton_engine {
+  struct Mass {
+    f32 value;
+  };
+
+  struct Speed {
+    f32 value;
+  };
+
+  constexpr i64 entity_count = 10000;
+  constexpr i64 grain = 256;
+
+  static void create_entities(ECS& ecs)
+  {
+    for(i64 i = 0; i < entity_count; ++i) {
+      // Values of very different magnitudes, so that the sum depends on the
+      // order of additions.
+      f32 const value = 1.0f / static_cast<f32>(i % 97 + 1) + (i % 13) * 1e4f;
+      auto [entity, mass] = ecs.create<Mass>();
+      mass.value = value;
+      if(i % 3 != 0) {
+        ecs.add_component<Speed>(entity).value = 2.0f * value;
+      }
+    }
+  }
+
+  [[nodiscard]] static bool bit_equal(f32 const lhs, f32 const rhs)
+  {
+    return memcmp(&lhs, &rhs, sizeof(f32)) == 0;
+  }
+
+  // Sum of chunks of grain components added one after another.
+  template<typename Component>
+  [[nodiscard]] static f32 chunked_sum(ECS& ecs)
+  {
+    auto view = ecs.view<Component>();
+    Entity const* const entities = ecs.entities<Component>();
+    f32 total = 0.0f;
+    for(i64 first = 0; first < view.size(); first += grain) {
+      f32 chunk = 0.0f;
+      for(i64 i = first; i < first + grain && i < view.size(); ++i) {
+        chunk += view.get(entities[i]).value;
+      }
+      total += chunk;
+    }
+    return total;
+  }
+
+  static void merge_sums(f32& total, f32& chunk)
+  {
+    total += chunk;
+  }
+
+  static void test_parallel_reduce()
+  {
+    ECS ecs;
+    create_entities(ecs);
+    f32 const expected = chunked_sum<Mass>(ecs);
+    for(i64 run = 0; run < 8; ++run) {
+      f32 const sum = ecs.view<Mass>().parallel_reduce(
+        0.0f, [](f32& sum, Mass& mass) { sum += mass.value; }, merge_sums,
+        grain);
+      CHECK(bit_equal(sum, expected));
+    }
+
+    // Speed has fewer entities, so the view iterates over its container.
+    f32 const expected_speed = chunked_sum<Speed>(ecs);
+    for(i64 run = 0; run < 8; ++run) {
+      f32 const sum = ecs.view<Mass, Speed>().parallel_reduce(
+        0.0f,
+        [](f32& sum, Entity, Mass&, Speed& speed) { sum += speed.value; },
+        merge_sums, grain);
+      CHECK(bit_equal(sum, expected_speed));
+    }
+
+    ECS empty;
+    f32 const sum = empty.view<Mass>().parallel_reduce(
+      1.0f, [](f32& sum, Mass& mass) { sum += mass.value; }, merge_sums);
+    CHECK(sum == 1.0f);
+  }
+
+  static void test_parallel_for_each()
+  {
+    ECS ecs;
+    create_entities(ecs);
+    auto view = ecs.view<Mass>();
+    Entity const* const entities = ecs.entities<Mass>();
+    anton::Array<f32> original(view.size());
+    for(i64 i = 0; i < view.size(); ++i) {
+      original[i] = view.get(entities[i]).value;
+    }
+
+    view.parallel_for_each([](Mass& mass) { mass.value += 1.0f; }, grain);
+    ecs.view<Mass, Speed>().parallel_for_each(
+      [](Mass& mass, Speed&) { mass.value += 1.0f; }, grain);
+    // Every entity is visited exactly once by each view.
+    bool visited_once = true;
+    for(i64 i = 0; i < view.size(); ++i) {
+      Entity const entity = entities[i];
+      f32 expected = original[i] + 1.0f;
+      if(ecs.has_component<Speed>(entity)) {
+        expected += 1.0f;
+      }
+      visited_once &= view.get(entity).value == expected;
+    }
+    CHECK(visited_once);
+  }
+
+  static void test_create_in_group()
+  {
+    ECS ecs;
+    (void)ecs.group<Mass, Speed>();
+    // Entities outside the group are moved when entities join the group.
+    for(i64 i = 0; i < 4; ++i) {
+      auto [entity, mass] = ecs.create<Mass>();
+      mass.value = -1.0f;
+    }
+
+    bool references_valid = true;
+    for(i64 i = 0; i < 8; ++i) {
+      auto [entity, mass, speed] = ecs.create<Mass, Speed>();
+      mass.value = static_cast<f32>(i);
+      speed.value = static_cast<f32>(i);
+      references_valid &= ecs.get_component<Mass>(entity).value == i;
+    }
+    CHECK(references_valid);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  init_jobs();
+  test_parallel_reduce();
+  test_parallel_for_each();
+  test_create_in_group();
+  terminate_jobs();
+  return report_test_results();
+}
@@ -0,0 +1,103 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <core/random.hpp>
+#include <rendering/draw_keys.hpp>
+
+#include <algorithm>
+
+namespace anton_engine {
+  using namespace rendering;
+
+  // Compare radix_sort with a stable std::sort of the same keys.
+  static void check_sort(anton::Array<u64> const& keys)
+  {
+    anton::Array<u64> sorted_keys = keys;
+    anton::Array<u32> indices(keys.size());
+    for(i64 i = 0; i < indices.size(); ++i) {
+      indices[i] = i;
+    }
+    Radix_Sort_Scratch scratch;
+    radix_sort(sorted_keys, indices, scratch);
+
+    anton::Array<u32> expected(keys.size());
+    for(i64 i = 0; i < expected.size(); ++i) {
+      expected[i] = i;
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&keys](u32 const lhs, u32 const rhs) {
+                       return keys[lhs] < keys[rhs];
+                     });
+
+    bool equal = true;
+    for(i64 i = 0; i < keys.size(); ++i) {
+      equal = equal && indices[i] == expected[i] &&
+              sorted_keys[i] == keys[expected[i]];
+    }
+    CHECK(equal);
+  }
+
+  static void test_radix_sort()
+  {
+    seed_default_random_engine(5231);
+    check_sort({});
+    check_sort(anton::Array<u64>(1, 42));
+
+    i64 const counts[] = {2, 7, 1000, 65537};
+    for(i64 const count: counts) {
+      // Keys using all 64 bits.
+      anton::Array<u64> keys(count);
+      for(u64& key: keys) {
+        key = (static_cast<u64>(random_i64(0, 0xFFFFFFFF)) << 32) |
+              static_cast<u64>(random_i64(0, 0xFFFFFFFF));
+      }
+      check_sort(keys);
+
+      // Few distinct keys, so that most digits are skipped and the sort must
+      // keep equal keys in their original order.
+      for(u64& key: keys) {
+        key = static_cast<u64>(random_i64(0, 3)) << 40;
+      }
+      check_sort(keys);
+
+      // Equal keys.
+      for(u64& key: keys) {
+        key = 0x0123456789ABCDEF;
+      }
+      check_sort(keys);
+    }
+  }
+
+  [[nodiscard]] static Static_Mesh_Component make_mesh(u64 const shader,
+                                                       u64 const material,
+                                                       u64 const mesh)
+  {
+    Static_Mesh_Component component;
+    component.shader_handle.value = handle_value(shader, 1);
+    component.material_handle.value = handle_value(material, 1);
+    component.mesh_handle.value = handle_value(mesh, 1);
+    return component;
+  }
+
+  static void test_draw_key_order()
+  {
+    // Shader takes precedence over material and material over mesh.
+    CHECK(make_draw_key(make_mesh(1, 0xFFFFFF, 0xFFFFFF)) <
+          make_draw_key(make_mesh(2, 0, 0)));
+    CHECK(make_draw_key(make_mesh(1, 1, 0xFFFFFF)) <
+          make_draw_key(make_mesh(1, 2, 0)));
+    CHECK(make_draw_key(make_mesh(1, 1, 1)) <
+          make_draw_key(make_mesh(1, 1, 2)));
+    // Objects that share shader, material and mesh share the key.
+    CHECK(make_draw_key(make_mesh(3, 4, 5)) ==
+          make_draw_key(make_mesh(3, 4, 5)));
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_radix_sort();
+  test_draw_key_order();
+  return report_test_results();
+}
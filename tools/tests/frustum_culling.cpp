@@ -0,0 +1,117 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <anton/math/mat4.hpp>
+#include <anton/math/transform.hpp>
+#include <core/random.hpp>
+#include <rendering/frustum_culling.hpp>
+
+#include <cmath>
+
+namespace anton_engine {
+  using namespace rendering;
+
+  // Compare cull_spheres with test_sphere applied to every sphere.
+  static void check_culling(Frustum const& frustum,
+                            anton::Array<Bounding_Sphere> const& spheres)
+  {
+    anton::Array<u32> visible(spheres.size());
+    i64 const visible_count = cull_spheres(frustum, spheres, visible.data());
+    anton::Array<u32> expected;
+    for(i64 i = 0; i < spheres.size(); ++i) {
+      if(test_sphere(frustum, spheres[i])) {
+        expected.push_back(i);
+      }
+    }
+
+    bool equal = visible_count == expected.size();
+    for(i64 i = 0; equal && i < visible_count; ++i) {
+      equal = visible[i] == expected[i];
+    }
+    CHECK(equal);
+  }
+
+  [[nodiscard]] static Frustum make_test_frustum()
+  {
+    Mat4 const projection =
+      math::perspective_rh(math::radians(70.0f), 16.0f / 9.0f, 0.3f, 100.0f);
+    Mat4 const view = math::lookat_rh(Vec3(3.0f, 2.0f, 5.0f),
+                                      Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f));
+    return make_frustum(projection * view);
+  }
+
+  [[nodiscard]] static Bounding_Sphere random_sphere()
+  {
+    return {Vec3(random_f32(-120.0f, 120.0f), random_f32(-120.0f, 120.0f),
+                 random_f32(-120.0f, 120.0f)),
+            random_f32(0.0f, 20.0f)};
+  }
+
+  static void test_random_spheres()
+  {
+    seed_default_random_engine(7713);
+    Frustum const frustum = make_test_frustum();
+    // Include counts that leave a remainder for the scalar loop.
+    for(i64 count = 0; count <= 13; ++count) {
+      anton::Array<Bounding_Sphere> spheres;
+      for(i64 i = 0; i < count; ++i) {
+        spheres.push_back(random_sphere());
+      }
+      check_culling(frustum, spheres);
+    }
+
+    anton::Array<Bounding_Sphere> spheres;
+    for(i64 i = 0; i < 10003; ++i) {
+      spheres.push_back(random_sphere());
+    }
+    check_culling(frustum, spheres);
+  }
+
+  static void test_spheres_touching_planes()
+  {
+    seed_default_random_engine(991);
+    Frustum const frustum = make_test_frustum();
+    // Spheres whose distance to one of the planes is exactly -radius, slightly
+    // more or slightly less.
+    anton::Array<Bounding_Sphere> spheres;
+    for(i64 i = 0; i < 1001; ++i) {
+      Vec4 const& plane = frustum.planes[i % 6];
+      Bounding_Sphere sphere = random_sphere();
+      f32 const distance = plane.x * sphere.center.x + plane.w +
+                           plane.y * sphere.center.y +
+                           plane.z * sphere.center.z;
+      if(distance >= 0.0f) {
+        continue;
+      }
+
+      sphere.radius = -distance;
+      if(i % 3 == 1) {
+        sphere.radius = std::nextafter(sphere.radius, 0.0f);
+      } else if(i % 3 == 2) {
+        sphere.radius = std::nextafter(sphere.radius, 1.0e9f);
+      }
+      spheres.push_back(sphere);
+    }
+    check_culling(frustum, spheres);
+  }
+
+  static void test_known_spheres()
+  {
+    Frustum const frustum = make_test_frustum();
+    Bounding_Sphere const origin = {Vec3(0.0f), 1.0f};
+    Bounding_Sphere const behind = {Vec3(6.0f, 4.0f, 10.0f), 1.0f};
+    Bounding_Sphere const far = {Vec3(-300.0f, -200.0f, -500.0f), 1.0f};
+    CHECK(test_sphere(frustum, origin));
+    CHECK(!test_sphere(frustum, behind));
+    CHECK(!test_sphere(frustum, far));
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_random_spheres();
+  test_spheres_touching_planes();
+  test_known_spheres();
+  return report_test_results();
+}
@@ -0,0 +1,150 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <rendering/gpu_ring_buffer.hpp>
+
+namespace anton_engine {
+  using namespace rendering;
+
+  // Fences that are signaled only when the test says so. Waiting on a fence
+  // that has not been signaled completes the GPU work, i.e. signals it.
+  class Fake_Fence_Backend: public Fence_Backend {
+  public:
+    // signaled[fence - 1] is the state of fence.
+    anton::Array<bool> signaled;
+    i64 live_fences = 0;
+
+    [[nodiscard]] Fence insert_fence() override
+    {
+      signaled.push_back(false);
+      live_fences += 1;
+      return signaled.size();
+    }
+
+    bool wait_fence(Fence const fence) override
+    {
+      bool const blocked = !signaled[fence - 1];
+      signaled[fence - 1] = true;
+      return blocked;
+    }
+
+    void delete_fence(Fence const fence) override
+    {
+      CHECK(fence != null_fence);
+      live_fences -= 1;
+    }
+
+    void signal_all()
+    {
+      for(i64 i = 0; i < signaled.size(); ++i) {
+        signaled[i] = true;
+      }
+    }
+  };
+
+  static void test_regions_wrap_around()
+  {
+    Fake_Fence_Backend backend;
+    GPU_Ring_Buffer buffer(&backend, 30, 3);
+    CHECK(buffer.get_region_size() == 10);
+    // The first frame allocates from region 1 and the regions then cycle.
+    i64 const expected_offsets[] = {10, 20, 0, 10, 20, 0, 10};
+    for(i64 const expected: expected_offsets) {
+      buffer.begin_frame();
+      CHECK(buffer.allocate(4) == expected);
+      CHECK(buffer.allocate(6) == expected + 4);
+      buffer.end_frame();
+      backend.signal_all();
+    }
+    CHECK(buffer.get_statistics().frame_count == 7);
+    CHECK(buffer.get_statistics().stall_count == 0);
+  }
+
+  static void test_stalls_are_counted()
+  {
+    Fake_Fence_Backend backend;
+    GPU_Ring_Buffer buffer(&backend, 30, 3);
+    // The first use of every region does not wait.
+    for(i64 i = 0; i < 3; ++i) {
+      buffer.begin_frame();
+      buffer.end_frame();
+    }
+    CHECK(buffer.get_statistics().stall_count == 0);
+
+    // The GPU has not finished any frame yet, so reusing a region blocks.
+    buffer.begin_frame();
+    buffer.end_frame();
+    CHECK(buffer.get_statistics().stall_count == 1);
+
+    // The GPU has finished all frames.
+    backend.signal_all();
+    buffer.begin_frame();
+    buffer.end_frame();
+    CHECK(buffer.get_statistics().stall_count == 1);
+  }
+
+  static void test_high_water_mark()
+  {
+    Fake_Fence_Backend backend;
+    GPU_Ring_Buffer buffer(&backend, 300, 3);
+    i64 const frame_allocations[] = {10, 70, 25};
+    for(i64 const count: frame_allocations) {
+      buffer.begin_frame();
+      for(i64 i = 0; i < count; ++i) {
+        CHECK(buffer.allocate(1) != -1);
+      }
+      buffer.end_frame();
+    }
+    CHECK(buffer.get_statistics().high_water_mark == 70);
+  }
+
+  static void test_failed_allocations()
+  {
+    Fake_Fence_Backend backend;
+    GPU_Ring_Buffer buffer(&backend, 30, 3);
+    buffer.begin_frame();
+    i64 const offset = buffer.allocate(8);
+    CHECK(offset != -1);
+    CHECK(buffer.allocate(3) == -1);
+    // A failed allocation does not consume space.
+    CHECK(buffer.allocate(2) == offset + 8);
+    CHECK(buffer.allocate(1) == -1);
+    CHECK(buffer.allocate(0) == offset + 10);
+    CHECK(buffer.get_statistics().failed_allocations == 2);
+    CHECK(buffer.get_statistics().high_water_mark == 10);
+    buffer.end_frame();
+
+    // The next frame starts with an empty region.
+    buffer.begin_frame();
+    CHECK(buffer.allocate(10) != -1);
+    buffer.end_frame();
+  }
+
+  static void test_fences_are_released()
+  {
+    Fake_Fence_Backend backend;
+    {
+      GPU_Ring_Buffer buffer(&backend, 30, 3);
+      for(i64 i = 0; i < 5; ++i) {
+        buffer.begin_frame();
+        buffer.end_frame();
+        CHECK(backend.live_fences <= 3);
+      }
+      // end_frame without begin_frame replaces the fence of the region.
+      buffer.end_frame();
+      CHECK(backend.live_fences == 3);
+    }
+    CHECK(backend.live_fences == 0);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_regions_wrap_around();
+  test_stalls_are_counted();
+  test_high_water_mark();
+  test_failed_allocations();
+  test_fences_are_released();
+  return report_test_results();
+}
@@ -0,0 +1,210 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <anton/math/math.hpp>
+#include <anton/math/transform.hpp>
+#include <core/random.hpp>
+#include <rendering/light_clustering.hpp>
+
+#include <cmath> // std::log, std::round
+
+namespace anton_engine {
+  using namespace rendering;
+
+  constexpr i32 tiles_x = 4;
+  constexpr i32 tiles_y = 3;
+  constexpr i32 slices = 8;
+
+  // 90 degree vertical field of view, so that the tangents are easy to check.
+  [[nodiscard]] static Cluster_Grid make_test_grid()
+  {
+    Mat4 const projection =
+      math::perspective_rh(math::radians(90.0f), 2.0f, 1.0f, 100.0f);
+    return make_cluster_grid(projection, tiles_x, tiles_y, slices);
+  }
+
+  [[nodiscard]] static i64 get_cluster_index(i32 const x, i32 const y,
+                                             i32 const z)
+  {
+    return (z * tiles_y + y) * tiles_x + x;
+  }
+
+  [[nodiscard]] static bool cluster_has_light(Light_Clusters const& clusters,
+                                              i64 const cluster,
+                                              u32 const light)
+  {
+    u32 const offset = clusters.ranges[2 * cluster];
+    u32 const count = clusters.ranges[2 * cluster + 1];
+    for(u32 i = offset; i < offset + count; ++i) {
+      if(clusters.light_indices[i] == light) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] static Light_Clusters assign(Cluster_Grid const& grid,
+                                             Bounding_Sphere const light)
+  {
+    Light_Clusters clusters;
+    assign_lights_to_clusters(grid, anton::Slice<Bounding_Sphere const>(
+                                      &light, &light + 1),
+                              clusters);
+    return clusters;
+  }
+
+  static void test_grid_from_projection()
+  {
+    Cluster_Grid const grid = make_test_grid();
+    CHECK(math::abs(grid.near_plane - 1.0f) < 1e-4f);
+    CHECK(math::abs(grid.far_plane - 100.0f) < 1e-2f);
+    CHECK(math::abs(grid.tan_half_fov_x - 2.0f) < 1e-5f);
+    CHECK(math::abs(grid.tan_half_fov_y - 1.0f) < 1e-5f);
+    CHECK(get_cluster_slice(grid, 0.5f) == -1);
+    CHECK(get_cluster_slice(grid, 1.0f) == 0);
+    CHECK(get_cluster_slice(grid, 99.0f) == slices - 1);
+    CHECK(get_cluster_slice(grid, 101.0f) == -1);
+  }
+
+  static void test_light_behind_camera()
+  {
+    Cluster_Grid const grid = make_test_grid();
+    Light_Clusters const clusters =
+      assign(grid, {Vec3(0.0f, 0.0f, 5.0f), 3.0f});
+    CHECK(clusters.light_indices.size() == 0);
+  }
+
+  static void test_light_beyond_far_plane()
+  {
+    Cluster_Grid const grid = make_test_grid();
+    Light_Clusters const beyond =
+      assign(grid, {Vec3(0.0f, 0.0f, -110.0f), 5.0f});
+    CHECK(beyond.light_indices.size() == 0);
+
+    // Only the last slice reaches the far plane.
+    Light_Clusters const straddling =
+      assign(grid, {Vec3(0.0f, 0.0f, -101.0f), 5.0f});
+    CHECK(straddling.light_indices.size() > 0);
+    for(i32 z = 0; z < slices - 1; ++z) {
+      for(i32 y = 0; y < tiles_y; ++y) {
+        for(i32 x = 0; x < tiles_x; ++x) {
+          CHECK(!cluster_has_light(straddling, get_cluster_index(x, y, z), 0));
+        }
+      }
+    }
+  }
+
+  static void test_light_straddling_near_plane()
+  {
+    // Center behind the near plane and the sphere reaching up to depth 1.5,
+    // which is within the first slice. At the near plane the sphere spans
+    // [-0.87, 0.87] in x and y, which covers the middle tiles.
+    Cluster_Grid const grid = make_test_grid();
+    Light_Clusters const clusters =
+      assign(grid, {Vec3(0.0f, 0.0f, -0.5f), 1.0f});
+    CHECK(cluster_has_light(clusters, get_cluster_index(1, 1, 0), 0));
+    CHECK(cluster_has_light(clusters, get_cluster_index(2, 1, 0), 0));
+    CHECK(!cluster_has_light(clusters, get_cluster_index(0, 1, 0), 0));
+    CHECK(!cluster_has_light(clusters, get_cluster_index(3, 1, 0), 0));
+    for(i32 z = 1; z < slices; ++z) {
+      for(i32 y = 0; y < tiles_y; ++y) {
+        for(i32 x = 0; x < tiles_x; ++x) {
+          CHECK(!cluster_has_light(clusters, get_cluster_index(x, y, z), 0));
+        }
+      }
+    }
+  }
+
+  static void test_light_covering_screen()
+  {
+    Cluster_Grid const grid = make_test_grid();
+    Light_Clusters const clusters =
+      assign(grid, {Vec3(0.0f, 0.0f, -50.0f), 1000.0f});
+    CHECK(clusters.light_indices.size() == tiles_x * tiles_y * slices);
+    for(i64 cluster = 0; cluster < tiles_x * tiles_y * slices; ++cluster) {
+      CHECK(cluster_has_light(clusters, cluster, 0));
+    }
+  }
+
+  // Returns: Tile containing ndc or -1 if ndc lies too close to the boundary
+  //          between tiles to tell.
+  [[nodiscard]] static i32 get_tile(f32 const ndc, i32 const tiles)
+  {
+    f32 const position = (ndc + 1.0f) * 0.5f * tiles;
+    if(math::abs(position - std::round(position)) < 1e-3f) {
+      return -1;
+    }
+    return static_cast<i32>(math::floor(position));
+  }
+
+  // Every point of a light that lies inside the frustum must be in a cluster
+  // that lists the light.
+  static void test_assignment_is_conservative()
+  {
+    seed_default_random_engine(5151);
+    Cluster_Grid const grid = make_test_grid();
+    anton::Array<Bounding_Sphere> lights;
+    for(i64 i = 0; i < 200; ++i) {
+      Vec3 const center = {random_f32(-60.0f, 60.0f), random_f32(-40.0f, 40.0f),
+                           random_f32(-110.0f, 5.0f)};
+      lights.push_back({center, random_f32(0.1f, 15.0f)});
+    }
+
+    Light_Clusters clusters;
+    assign_lights_to_clusters(grid, lights, clusters);
+    f32 const slice_scale =
+      slices / std::log(grid.far_plane / grid.near_plane);
+    i64 misses = 0;
+    i64 tested = 0;
+    for(i64 light = 0; light < lights.size(); ++light) {
+      Bounding_Sphere const& sphere = lights[light];
+      for(i64 i = 0; i < 200; ++i) {
+        Vec3 const offset = {random_f32(-1.0f, 1.0f), random_f32(-1.0f, 1.0f),
+                             random_f32(-1.0f, 1.0f)};
+        if(math::length_squared(offset) > 1.0f) {
+          continue;
+        }
+
+        Vec3 const point = sphere.center + offset * sphere.radius;
+        f32 const depth = -point.z;
+        if(depth <= grid.near_plane || depth >= grid.far_plane) {
+          continue;
+        }
+
+        f32 const ndc_x = point.x / (depth * grid.tan_half_fov_x);
+        f32 const ndc_y = point.y / (depth * grid.tan_half_fov_y);
+        if(math::abs(ndc_x) >= 1.0f || math::abs(ndc_y) >= 1.0f) {
+          continue;
+        }
+
+        f32 const slice_position =
+          std::log(depth / grid.near_plane) * slice_scale;
+        i32 const x = get_tile(ndc_x, tiles_x);
+        i32 const y = get_tile(ndc_y, tiles_y);
+        if(x == -1 || y == -1 ||
+           math::abs(slice_position - std::round(slice_position)) < 1e-3f) {
+          continue;
+        }
+
+        i32 const z = static_cast<i32>(slice_position);
+        tested += 1;
+        misses += !cluster_has_light(clusters, get_cluster_index(x, y, z),
+                                     light);
+      }
+    }
+    CHECK(misses == 0);
+    CHECK(tested > 1000);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_grid_from_projection();
+  test_light_behind_camera();
+  test_light_beyond_far_plane();
+  test_light_straddling_near_plane();
+  test_light_covering_screen();
+  test_assignment_is_conservative();
+  return report_test_results();
+}
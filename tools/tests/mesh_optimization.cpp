@@ -0,0 +1,221 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <anton/math/math.hpp>
+#include <content_browser/mesh_optimization.hpp>
+#include <core/random.hpp>
+
+#include <algorithm> // std::sort
+
+namespace anton_engine {
+  using namespace asset_importing;
+
+  constexpr i32 cache_size = 16;
+
+  struct Triangle {
+    Vec3 vertices[3];
+  };
+
+  // Grid of size x size quads in the z = 0 plane with the triangles in
+  // random order.
+  static void make_shuffled_grid(i64 const size, anton::Array<Vertex>& vertices,
+                                 anton::Array<u32>& indices)
+  {
+    vertices.clear();
+    indices.clear();
+    for(i64 y = 0; y <= size; ++y) {
+      for(i64 x = 0; x <= size; ++x) {
+        Vertex vertex;
+        vertex.position = Vec3{static_cast<f32>(x), static_cast<f32>(y), 0.0f};
+        vertex.normal = Vec3{0.0f, 0.0f, 1.0f};
+        vertices.push_back(vertex);
+      }
+    }
+
+    for(i64 y = 0; y < size; ++y) {
+      for(i64 x = 0; x < size; ++x) {
+        u32 const corner = y * (size + 1) + x;
+        u32 const quad[6] = {corner,     corner + 1,
+                             corner + size + 2, corner,
+                             corner + size + 2, corner + size + 1};
+        for(u32 const index: quad) {
+          indices.push_back(index);
+        }
+      }
+    }
+
+    i64 const triangle_count = indices.size() / 3;
+    for(i64 t = triangle_count - 1; t > 0; --t) {
+      i64 const other = random_i64(0, t);
+      for(i64 k = 0; k < 3; ++k) {
+        u32 const index = indices[3 * t + k];
+        indices[3 * t + k] = indices[3 * other + k];
+        indices[3 * other + k] = index;
+      }
+    }
+  }
+
+  // Average cache miss ratio of a FIFO cache of cache_size vertices.
+  [[nodiscard]] static f32 get_acmr(anton::Array<u32> const& indices,
+                                    i64 const vertex_count)
+  {
+    anton::Array<i64> timestamps(vertex_count, 0);
+    i64 timestamp = cache_size + 1;
+    i64 misses = 0;
+    for(u32 const index: indices) {
+      if(timestamp - timestamps[index] > cache_size) {
+        timestamps[index] = timestamp;
+        timestamp += 1;
+        misses += 1;
+      }
+    }
+    return static_cast<f32>(misses) / (indices.size() / 3);
+  }
+
+  [[nodiscard]] static bool less(Vec3 const lhs, Vec3 const rhs)
+  {
+    if(lhs.x != rhs.x) {
+      return lhs.x < rhs.x;
+    }
+    if(lhs.y != rhs.y) {
+      return lhs.y < rhs.y;
+    }
+    return lhs.z < rhs.z;
+  }
+
+  // Returns: Triangles by the positions of their vertices in a canonical
+  //          order. The order of the vertices within a triangle is kept.
+  [[nodiscard]] static anton::Array<Triangle>
+  get_sorted_triangles(anton::Array<Vertex> const& vertices,
+                       anton::Array<u32> const& indices)
+  {
+    anton::Array<Triangle> triangles;
+    for(i64 i = 0; i < indices.size(); i += 3) {
+      Triangle triangle;
+      for(i64 k = 0; k < 3; ++k) {
+        triangle.vertices[k] = vertices[indices[i + k]].position;
+      }
+      triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end(),
+              [](Triangle const& lhs, Triangle const& rhs) {
+                for(i64 k = 0; k < 3; ++k) {
+                  if(less(lhs.vertices[k], rhs.vertices[k])) {
+                    return true;
+                  }
+                  if(less(rhs.vertices[k], lhs.vertices[k])) {
+                    return false;
+                  }
+                }
+                return false;
+              });
+    return triangles;
+  }
+
+  [[nodiscard]] static bool equal(anton::Array<Triangle> const& lhs,
+                                  anton::Array<Triangle> const& rhs)
+  {
+    if(lhs.size() != rhs.size()) {
+      return false;
+    }
+
+    for(i64 i = 0; i < lhs.size(); ++i) {
+      for(i64 k = 0; k < 3; ++k) {
+        Vec3 const a = lhs[i].vertices[k];
+        Vec3 const b = rhs[i].vertices[k];
+        if(a.x != b.x || a.y != b.y || a.z != b.z) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] static bool in_range(anton::Array<u32> const& indices,
+                                     i64 const vertex_count)
+  {
+    for(u32 const index: indices) {
+      if(index >= vertex_count) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void test_vertex_cache()
+  {
+    seed_default_random_engine(3407);
+    anton::Array<Vertex> vertices;
+    anton::Array<u32> indices;
+    make_shuffled_grid(32, vertices, indices);
+    anton::Array<Triangle> const expected =
+      get_sorted_triangles(vertices, indices);
+    f32 const shuffled_acmr = get_acmr(indices, vertices.size());
+
+    optimize_vertex_cache(indices, vertices.size(), cache_size);
+    CHECK(in_range(indices, vertices.size()));
+    CHECK(equal(get_sorted_triangles(vertices, indices), expected));
+    f32 const optimized_acmr = get_acmr(indices, vertices.size());
+    // A shuffled grid misses on almost every vertex while the ideal is 0.5.
+    CHECK(shuffled_acmr > 2.0f);
+    CHECK(optimized_acmr < 0.8f);
+  }
+
+  static void test_overdraw()
+  {
+    seed_default_random_engine(3407);
+    anton::Array<Vertex> vertices;
+    anton::Array<u32> indices;
+    make_shuffled_grid(32, vertices, indices);
+    // Fold the grid into a roof, so that the clusters face different ways.
+    for(Vertex& vertex: vertices) {
+      vertex.position.z = math::abs(vertex.position.x - 16.0f);
+    }
+    optimize_vertex_cache(indices, vertices.size(), cache_size);
+    anton::Array<Triangle> const expected =
+      get_sorted_triangles(vertices, indices);
+    f32 const cache_acmr = get_acmr(indices, vertices.size());
+
+    optimize_overdraw(indices, vertices, cache_size, 1.05f);
+    CHECK(in_range(indices, vertices.size()));
+    CHECK(equal(get_sorted_triangles(vertices, indices), expected));
+    CHECK(get_acmr(indices, vertices.size()) < 1.2f * cache_acmr);
+  }
+
+  static void test_vertex_fetch()
+  {
+    seed_default_random_engine(3407);
+    anton::Array<Vertex> vertices;
+    anton::Array<u32> indices;
+    make_shuffled_grid(8, vertices, indices);
+    // Unused vertex.
+    vertices.push_back(Vertex{});
+    i64 const used_count = vertices.size() - 1;
+    anton::Array<Triangle> const expected =
+      get_sorted_triangles(vertices, indices);
+
+    optimize_vertex_fetch(vertices, indices);
+    CHECK(vertices.size() == used_count);
+    CHECK(in_range(indices, vertices.size()));
+    CHECK(equal(get_sorted_triangles(vertices, indices), expected));
+    // Vertices are in the order of their first use.
+    u32 next = 0;
+    bool ordered = true;
+    for(u32 const index: indices) {
+      ordered &= index <= next;
+      if(index == next) {
+        next += 1;
+      }
+    }
+    CHECK(ordered);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_vertex_cache();
+  test_overdraw();
+  test_vertex_fetch();
+  return report_test_results();
+}
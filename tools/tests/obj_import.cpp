@@ -0,0 +1,181 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <content_browser/importers/obj.hpp>
+#include <core/random.hpp>
+#include <engine/ecs/jobs_management.hpp>
+
+#include <string>
+
+namespace anton_engine {
+  using namespace importers;
+
+  [[nodiscard]] static anton::Array<u8> to_bytes(std::string const& text)
+  {
+    anton::Array<u8> bytes(text.size());
+    for(i64 i = 0; i < (i64)text.size(); ++i) {
+      bytes[i] = text[i];
+    }
+    return bytes;
+  }
+
+  // Objects of random quads and triangles. Faces use absolute and relative
+  // references and some of them precede the first object.
+  [[nodiscard]] static std::string generate_obj()
+  {
+    std::string obj = "# generated\n";
+    i64 vertex_count = 0;
+    for(i64 object = -1; object < 40; ++object) {
+      if(object >= 0) {
+        obj += "o object_" + std::to_string(object) + "\n";
+      }
+
+      i64 const object_vertices = random_i64(4, 50);
+      for(i64 i = 0; i < object_vertices; ++i) {
+        obj += "v " + std::to_string(random_f32(-10.0f, 10.0f)) + " " +
+               std::to_string(random_f32(-10.0f, 10.0f)) + " " +
+               std::to_string(random_f32(-10.0f, 10.0f)) + "\n";
+        obj += "vt " + std::to_string(random_f32(0.0f, 1.0f)) + " " +
+               std::to_string(random_f32(0.0f, 1.0f)) + "\n";
+        obj += "vn 0 1 0\n";
+      }
+      vertex_count += object_vertices;
+
+      obj += "\n";
+      i64 const face_count = random_i64(1, 60);
+      for(i64 face = 0; face < face_count; ++face) {
+        obj += "f";
+        i64 const corners = random_i64(3, 4);
+        for(i64 i = 0; i < corners; ++i) {
+          i64 const relative = random_i64(1, object_vertices);
+          std::string const index =
+            random_i64(0, 1) ? std::to_string(-relative)
+                             : std::to_string(vertex_count - relative + 1);
+          obj += " " + index + "/" + index + "/" + index;
+        }
+        obj += "\n";
+      }
+    }
+    return obj;
+  }
+
+  [[nodiscard]] static bool equal(anton::Array<Vec3> const& lhs,
+                                  anton::Array<Vec3> const& rhs)
+  {
+    if(lhs.size() != rhs.size()) {
+      return false;
+    }
+
+    for(i64 i = 0; i < lhs.size(); ++i) {
+      if(lhs[i] != rhs[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] static bool equal(Mesh const& lhs, Mesh const& rhs)
+  {
+    if(lhs.name != rhs.name || lhs.faces.size() != rhs.faces.size() ||
+       !equal(lhs.vertices, rhs.vertices) || !equal(lhs.normals, rhs.normals) ||
+       !equal(lhs.texture_coordinates, rhs.texture_coordinates)) {
+      return false;
+    }
+
+    for(i64 i = 0; i < lhs.faces.size(); ++i) {
+      anton::Array<u32> const& lhs_indices = lhs.faces[i].indices;
+      anton::Array<u32> const& rhs_indices = rhs.faces[i].indices;
+      if(lhs_indices.size() != rhs_indices.size()) {
+        return false;
+      }
+
+      for(i64 j = 0; j < lhs_indices.size(); ++j) {
+        if(lhs_indices[j] != rhs_indices[j]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  static void test_chunks_do_not_change_result()
+  {
+    seed_default_random_engine(612);
+    anton::Array<u8> const obj = to_bytes(generate_obj());
+    anton::Array<Mesh> const expected = import_obj(obj, obj.size());
+    // One unnamed mesh of the leading faces followed by the objects.
+    CHECK(expected.size() == 41);
+    // Chunks of single lines, chunks ending mid-line and the default.
+    i64 const chunk_sizes[] = {1, 37, 4096, 1 << 20};
+    for(i64 const chunk_size: chunk_sizes) {
+      anton::Array<Mesh> const meshes = import_obj(obj, chunk_size);
+      bool same = meshes.size() == expected.size();
+      for(i64 i = 0; same && i < meshes.size(); ++i) {
+        same = equal(meshes[i], expected[i]);
+      }
+      CHECK(same);
+    }
+  }
+
+  static void test_known_file()
+  {
+    anton::Array<u8> const obj = to_bytes("v 0 0 0\n"
+                                          "v 1 0 0\n"
+                                          "v 0 1 0\n"
+                                          "v 1 1 0\n"
+                                          "o quad\n"
+                                          "f 1 2 4 3\n"
+                                          "o triangle\n"
+                                          "f -4 -3 -2\n");
+    for(i64 const chunk_size: {1, 1 << 20}) {
+      anton::Array<Mesh> const meshes = import_obj(obj, chunk_size);
+      CHECK(meshes.size() == 2);
+      if(meshes.size() != 2) {
+        continue;
+      }
+
+      CHECK(meshes[0].name == u8"quad");
+      CHECK(meshes[0].faces.size() == 1);
+      CHECK(meshes[0].vertices.size() == 4);
+      CHECK(meshes[0].vertices[2] == Vec3(1.0f, 1.0f, 0.0f));
+      CHECK(meshes[1].name == u8"triangle");
+      CHECK(meshes[1].vertices.size() == 3);
+      CHECK(meshes[1].vertices[2] == Vec3(0.0f, 1.0f, 0.0f));
+    }
+  }
+
+  static void test_invalid_references()
+  {
+    char const* const files[] = {
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 9999\n",
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nf -9999 -2 -1\n",
+      // Relative references count only the elements defined before them.
+      "v 0 0 0\nv 1 0 0\nf -1 -2 -3\nv 0 1 0\n",
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nf 1/1 2/2 3/1\n",
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//-2 3//1\n",
+    };
+    for(char const* const file: files) {
+      anton::Array<u8> const obj = to_bytes(file);
+      for(i64 const chunk_size: {1, 1 << 20}) {
+        bool thrown = false;
+        try {
+          anton::Array<Mesh> const meshes = import_obj(obj, chunk_size);
+        } catch(Invalid_Mesh_File const&) {
+          thrown = true;
+        }
+        CHECK(thrown);
+      }
+    }
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  init_jobs();
+  test_chunks_do_not_change_result();
+  test_known_file();
+  test_invalid_references();
+  terminate_jobs();
+  return report_test_results();
+}
@@ -0,0 +1,70 @@
+#include <test.hpp>
+
+#include <rendering/persistent_buffer_allocator.hpp>
+
+namespace anton_engine {
+  using namespace rendering;
+
+  static void test_allocate_until_full()
+  {
+    Persistent_Buffer_Allocator allocator(100, 3);
+    CHECK(allocator.allocate(40) == 0);
+    CHECK(allocator.allocate(50) == 40);
+    CHECK(allocator.allocate(11) == -1);
+    CHECK(allocator.allocate(10) == 90);
+    CHECK(allocator.allocate(1) == -1);
+    CHECK(allocator.get_free_size() == 0);
+  }
+
+  static void test_freed_ranges_wait_for_frames()
+  {
+    Persistent_Buffer_Allocator allocator(100, 3);
+    CHECK(allocator.allocate(60) == 0);
+    CHECK(allocator.allocate(40) == 60);
+    allocator.free(0, 60);
+    CHECK(allocator.get_free_size() == 60);
+    // The GPU may still read the range during the frames in flight.
+    for(i64 frame = 0; frame < 2; ++frame) {
+      allocator.begin_frame();
+      CHECK(allocator.allocate(1) == -1);
+    }
+    allocator.begin_frame();
+    CHECK(allocator.allocate(60) == 0);
+  }
+
+  static void test_neighbours_merge()
+  {
+    Persistent_Buffer_Allocator allocator(100, 0);
+    CHECK(allocator.allocate(30) == 0);
+    CHECK(allocator.allocate(30) == 30);
+    CHECK(allocator.allocate(30) == 60);
+    allocator.free(0, 30);
+    allocator.free(60, 30);
+    // [0, 30) and [60, 100) are free, neither fits 50 elements.
+    CHECK(allocator.allocate(50) == -1);
+    allocator.free(30, 30);
+    CHECK(allocator.allocate(100) == 0);
+
+    allocator.free(0, 100);
+    CHECK(allocator.allocate(20) == 0);
+    CHECK(allocator.allocate(20) == 20);
+    CHECK(allocator.allocate(20) == 40);
+    allocator.free(20, 20);
+    allocator.free(0, 20);
+    // First fit.
+    CHECK(allocator.allocate(10) == 0);
+    // [10, 40) and [60, 100) are free.
+    CHECK(allocator.allocate(35) == 60);
+    CHECK(allocator.allocate(30) == 10);
+    CHECK(allocator.get_free_size() == 5);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_allocate_until_full();
+  test_freed_ranges_wait_for_frames();
+  test_neighbours_merge();
+  return report_test_results();
+}
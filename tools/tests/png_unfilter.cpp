@@ -0,0 +1,97 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <content_browser/importers/png.hpp>
+#include <core/random.hpp>
+
+namespace anton_engine {
+  using namespace importers;
+
+  constexpr u8 filter_sub = 1;
+  constexpr u8 filter_up = 2;
+  constexpr u8 filter_average = 3;
+  constexpr u8 filter_paeth = 4;
+
+  // Bytes are either random or one of the extremes, which exercise the
+  // wrap-around of the sums and the rounding of Average.
+  [[nodiscard]] static u8 random_byte(i64 const mode)
+  {
+    switch(mode) {
+    case 0:
+      return random_i64(0, 255);
+    case 1:
+      return random_i64(0, 1) ? 255 : 0;
+    default:
+      return random_i64(250, 255);
+    }
+  }
+
+  // Unfilter a sequence of scanlines with both paths, feeding every output
+  // back as the previous scanline, and compare the outputs.
+  static void check_scanlines(u8 const filter, i32 const pixel_width,
+                              i64 const pixel_count)
+  {
+    i64 const scanline_width = pixel_width * pixel_count;
+    anton::Array<u8> prev(scanline_width, 0);
+    anton::Array<u8> in(scanline_width);
+    anton::Array<u8> out(scanline_width);
+    anton::Array<u8> expected(scanline_width);
+    bool equal = true;
+    for(i64 scanline = 0; scanline < 8; ++scanline) {
+      i64 const mode = random_i64(0, 2);
+      for(u8& byte: in) {
+        byte = random_byte(mode);
+      }
+
+      unfilter_scanline(filter, in.data(), prev.data(), out.data(),
+                        scanline_width, pixel_width);
+      unfilter_scanline_scalar(filter, in.data(), prev.data(),
+                               expected.data(), scanline_width, pixel_width);
+      for(i64 i = 0; i < scanline_width; ++i) {
+        equal &= out[i] == expected[i];
+      }
+      prev = expected;
+    }
+    CHECK(equal);
+  }
+
+  static void test_sse_matches_scalar()
+  {
+    seed_default_random_engine(3407);
+    u8 const filters[] = {filter_sub, filter_up, filter_average, filter_paeth};
+    i32 const pixel_widths[] = {3, 4};
+    for(u8 const filter: filters) {
+      for(i32 const pixel_width: pixel_widths) {
+        for(i64 pixel_count = 1; pixel_count <= 40; ++pixel_count) {
+          check_scanlines(filter, pixel_width, pixel_count);
+        }
+        check_scanlines(filter, pixel_width, 7680);
+      }
+    }
+  }
+
+  // Scanline of known values worked out by hand from the PNG specification.
+  static void test_known_scanline()
+  {
+    u8 const prev[] = {10, 20, 30, 200, 100, 50};
+    u8 const in[] = {1, 2, 3, 4, 5, 6};
+    u8 out[6];
+    unfilter_scanline(filter_sub, in, prev, out, 6, 3);
+    CHECK(out[0] == 1 && out[3] == 5 && out[5] == 9);
+    unfilter_scanline(filter_average, in, prev, out, 6, 3);
+    // (0 + 10) / 2 + 1 = 6 and (6 + 200) / 2 + 4 = 107
+    CHECK(out[0] == 6 && out[3] == 107);
+    unfilter_scanline(filter_paeth, in, prev, out, 6, 3);
+    // First pixel predicts b: 10 + 1 = 11. Second pixel with a = 11,
+    // b = 200, c = 10 predicts b, since |p - b| = 1 is the smallest.
+    CHECK(out[0] == 11 && out[3] == 204);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_sse_matches_scalar();
+  test_known_scanline();
+  return report_test_results();
+}
@@ -0,0 +1,182 @@
+#include <test.hpp>
+
+#include <anton/math/math.hpp>
+#include <anton/optional.hpp>
+#include <core/random.hpp>
+#include <physics/intersection_tests.hpp>
+
+namespace anton_engine {
+  constexpr f32 tolerance = 1e-3f;
+
+  // The matrix-inverse test intersect_ray_triangle used before it was replaced
+  // by Moller-Trumbore. Solves ao = u * ab + v * ac - t * direction by
+  // inverting the matrix [ab, ac, -direction] with cofactors.
+  // margin - (out) distance of u, v, u + v and t from the edges of the ranges
+  //          in which the ray hits the triangle.
+  [[nodiscard]] static anton::Optional<Raycast_Hit>
+  intersect_ray_triangle_inverse(Ray const ray, Vec3 const a, Vec3 const b,
+                                 Vec3 const c, f32& margin)
+  {
+    Vec3 const ao = ray.origin - a;
+    Vec3 const ab = b - a;
+    Vec3 const ac = c - a;
+    Vec3 const nd = -ray.direction;
+    Vec3 const row0 = math::cross(ac, nd);
+    Vec3 const row1 = math::cross(nd, ab);
+    Vec3 const row2 = math::cross(ab, ac);
+    f32 const det = math::dot(ab, row0);
+    f32 const u = math::dot(row0, ao) / det;
+    f32 const v = math::dot(row1, ao) / det;
+    f32 const t = math::dot(row2, ao) / det;
+    margin = math::min(math::min(math::abs(u), math::abs(v)),
+                       math::min(math::abs(1 - u - v), math::abs(t)));
+    if(u < 0 || v < 0 || u + v > 1 || t < 0) {
+      return anton::null_optional;
+    }
+
+    Vec3 r(a + u * ab + v * ac);
+    return Raycast_Hit{r, {u, v, 1 - u - v}, t};
+  }
+
+  // Rays nearly parallel to the triangle and sliver triangles lose most of the
+  // precision in both kernels, so they are only expected to agree elsewhere.
+  [[nodiscard]] static bool is_well_conditioned(Ray const ray, Vec3 const a,
+                                                Vec3 const b, Vec3 const c)
+  {
+    Vec3 const ab = b - a;
+    Vec3 const ac = c - a;
+    Vec3 const normal = math::cross(ab, ac);
+    f32 const area = math::length(normal);
+    return math::abs(math::dot(normal, ray.direction)) > 0.1f * area &&
+           area > 0.1f * math::length_squared(ab) &&
+           area > 0.1f * math::length_squared(ac);
+  }
+
+  [[nodiscard]] static Vec3 random_vec3(f32 const min, f32 const max)
+  {
+    return {random_f32(min, max), random_f32(min, max), random_f32(min, max)};
+  }
+
+  // Half of the rays are aimed at a point inside or close to the triangle.
+  [[nodiscard]] static Ray random_ray(Vec3 const a, Vec3 const b, Vec3 const c)
+  {
+    Vec3 const origin = random_vec3(-10.0f, 10.0f);
+    Vec3 target = random_vec3(-10.0f, 10.0f);
+    if(random_i64(0, 1)) {
+      f32 const u = random_f32(-0.2f, 1.0f);
+      f32 const v = random_f32(-0.2f, 1.0f - u);
+      target = a + u * (b - a) + v * (c - a);
+    }
+    return {origin, math::normalize(target - origin)};
+  }
+
+  // Distances are relative so that hits far away are not held to a stricter
+  // standard than hits close to the origin.
+  [[nodiscard]] static bool nearly_equal(f32 const a, f32 const b)
+  {
+    return math::abs(a - b) <= tolerance * math::max(1.0f, math::abs(b));
+  }
+
+  [[nodiscard]] static bool hits_match(Raycast_Hit const& hit,
+                                       Raycast_Hit const& expected)
+  {
+    return nearly_equal(hit.distance, expected.distance) &&
+           nearly_equal(hit.barycentric_coordinates.x,
+                        expected.barycentric_coordinates.x) &&
+           nearly_equal(hit.barycentric_coordinates.y,
+                        expected.barycentric_coordinates.y) &&
+           nearly_equal(hit.hit_point.x, expected.hit_point.x) &&
+           nearly_equal(hit.hit_point.y, expected.hit_point.y) &&
+           nearly_equal(hit.hit_point.z, expected.hit_point.z);
+  }
+
+  static void test_triangle_matches_inverse()
+  {
+    seed_default_random_engine(4201);
+    i64 mismatches = 0;
+    i64 hits = 0;
+    for(i64 i = 0; i < 100000; ++i) {
+      Vec3 const a = random_vec3(-5.0f, 5.0f);
+      Vec3 const b = random_vec3(-5.0f, 5.0f);
+      Vec3 const c = random_vec3(-5.0f, 5.0f);
+      Ray const ray = random_ray(a, b, c);
+      f32 margin;
+      anton::Optional<Raycast_Hit> const expected =
+        intersect_ray_triangle_inverse(ray, a, b, c, margin);
+      anton::Optional<Raycast_Hit> const hit =
+        intersect_ray_triangle(ray, a, b, c);
+      hits += expected.holds_value();
+      // Rays that graze an edge may go either way.
+      if(margin < tolerance || !is_well_conditioned(ray, a, b, c)) {
+        continue;
+      }
+
+      if(hit.holds_value() != expected.holds_value() ||
+         (hit && !hits_match(*hit, *expected))) {
+        mismatches += 1;
+      }
+    }
+    CHECK(mismatches == 0);
+    // Make sure the rays exercise both outcomes.
+    CHECK(hits > 10000);
+    CHECK(hits < 90000);
+  }
+
+  static void test_packet_matches_inverse()
+  {
+    seed_default_random_engine(1337);
+    i64 mismatches = 0;
+    i64 hits = 0;
+    for(i64 i = 0; i < 50000; ++i) {
+      i32 const count = random_i64(1, 4);
+      Vec3 vertices[12];
+      for(i32 j = 0; j < 3 * count; ++j) {
+        vertices[j] = random_vec3(-5.0f, 5.0f);
+      }
+
+      Ray const ray = random_ray(vertices[0], vertices[1], vertices[2]);
+      anton::Optional<Raycast_Hit> expected = anton::null_optional;
+      i32 expected_lane = -1;
+      bool ambiguous = false;
+      for(i32 j = 0; j < count; ++j) {
+        f32 margin;
+        anton::Optional<Raycast_Hit> const hit = intersect_ray_triangle_inverse(
+          ray, vertices[3 * j], vertices[3 * j + 1], vertices[3 * j + 2],
+          margin);
+        ambiguous |= margin < tolerance ||
+                     !is_well_conditioned(ray, vertices[3 * j],
+                                          vertices[3 * j + 1],
+                                          vertices[3 * j + 2]);
+        if(hit && (!expected || hit->distance < expected->distance)) {
+          ambiguous |= expected &&
+                       nearly_equal(hit->distance, expected->distance);
+          expected = hit;
+          expected_lane = j;
+        }
+      }
+
+      i32 lane = -1;
+      anton::Optional<Raycast_Hit> const hit = intersect_ray_triangles(
+        ray, make_triangle_packet(vertices, count), &lane);
+      hits += expected.holds_value();
+      if(ambiguous) {
+        continue;
+      }
+
+      if(hit.holds_value() != expected.holds_value() ||
+         (hit && (lane != expected_lane || !hits_match(*hit, *expected)))) {
+        mismatches += 1;
+      }
+    }
+    CHECK(mismatches == 0);
+    CHECK(hits > 5000);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  test_triangle_matches_inverse();
+  test_packet_matches_inverse();
+  return report_test_results();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <core/types.hpp>
+
+#include <iostream>
+
+namespace anton_engine {
+  // Number of checks that have failed in the test executable.
+  inline i64 failed_checks = 0;
+
+  // Print the number of failed checks.
+  // Returns: Exit code of the test executable.
+  [[nodiscard]] int report_test_results();
+} // namespace anton_engine
+
+// Record a failure and print the condition if it does not hold.
+// Execution continues after a failed check.
+#define CHECK(condition)                                               \
+  do {                                                                 \
+    if(!(condition)) {                                                 \
+      ::anton_engine::failed_checks += 1;                              \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: "   \
+                << #condition << '\n';                                 \
+    }                                                                  \
+  } while(false)
+
+namespace anton_engine {
+  inline int report_test_results()
+  {
+    if(failed_checks > 0) {
+      std::cerr << failed_checks << " checks failed\n";
+      return 1;
+    }
+
+    return 0;
+  }
+} // namespace anton_engine
@@ -0,0 +1,358 @@
+#include <test.hpp>
+
+#include <anton/array.hpp>
+#include <anton/math/math.hpp>
+#include <content_browser/texture_processing.hpp>
+#include <core/random.hpp>
+#include <engine/ecs/jobs_management.hpp>
+
+namespace anton_engine {
+  using namespace asset_importing;
+  using importers::Image;
+  using importers::Image_Pixel_Format;
+
+  [[nodiscard]] static Image make_image(u32 const width, u32 const height,
+                                        Image_Pixel_Format const format,
+                                        i64 const pixel_size)
+  {
+    return Image(width, height, format, importers::srgb, 2.2f,
+                 anton::Array<u8>(width * height * pixel_size, 0));
+  }
+
+  [[nodiscard]] static i64 abs_difference(i64 const a, i64 const b)
+  {
+    return a < b ? b - a : a - b;
+  }
+
+  static void test_chain_sizes()
+  {
+    Image const image = make_image(5, 3, Image_Pixel_Format::grey8, 1);
+    anton::Array<Image> const levels = generate_mipmaps(image);
+    CHECK(levels.size() == 2);
+    if(levels.size() == 2) {
+      CHECK(levels[0].width == 2 && levels[0].height == 1);
+      CHECK(levels[1].width == 1 && levels[1].height == 1);
+      CHECK(levels[0].data.size() == 2 && levels[1].data.size() == 1);
+    }
+  }
+
+  // Odd dimensions weigh the covered pixels by the covered area.
+  static void test_odd_dimensions()
+  {
+    Image row = make_image(5, 1, Image_Pixel_Format::grey8, 1);
+    u8 const values[] = {30, 60, 90, 120, 150};
+    for(i64 i = 0; i < 5; ++i) {
+      row.data[i] = values[i];
+    }
+    anton::Array<Image> levels = generate_mipmaps(row);
+    // (2 * 30 + 2 * 60 + 90) / 5 and (90 + 2 * 120 + 2 * 150) / 5.
+    CHECK(levels[0].data[0] == 54 && levels[0].data[1] == 126);
+
+    // The last row and column contribute to the level.
+    Image corner = make_image(3, 3, Image_Pixel_Format::grey8, 1);
+    corner.data[8] = 255;
+    levels = generate_mipmaps(corner);
+    CHECK(levels[0].data[0] == 28);
+  }
+
+  static void test_srgb_averaged_in_linear_space()
+  {
+    Image image = make_image(2, 1, Image_Pixel_Format::rgba8, 4);
+    for(i64 c = 0; c < 4; ++c) {
+      image.data[4 + c] = 255;
+    }
+    anton::Array<Image> const levels = generate_mipmaps(image);
+    // Linear 0.5 encodes as 188. Alpha is linear.
+    CHECK(abs_difference(levels[0].data[0], 188) <= 1);
+    CHECK(levels[0].data[3] == 128);
+  }
+
+  // The average of a level matches the average of the image up to rounding.
+  static void test_mean_is_preserved()
+  {
+    seed_default_random_engine(3407);
+    for(u32 height = 1; height <= 9; ++height) {
+      for(u32 width = 1; width <= 9; ++width) {
+        if(width == 1 && height == 1) {
+          continue;
+        }
+
+        Image image = make_image(width, height, Image_Pixel_Format::grey16, 2);
+        f64 image_sum = 0.0;
+        for(i64 i = 0; i < width * height; ++i) {
+          i64 const value = random_i64(0, 65535);
+          image.data[2 * i] = value;
+          image.data[2 * i + 1] = value >> 8;
+          image_sum += value;
+        }
+
+        anton::Array<Image> const levels = generate_mipmaps(image);
+        Image const& level = levels[0];
+        f64 level_sum = 0.0;
+        for(i64 i = 0; i < level.width * level.height; ++i) {
+          level_sum += level.data[2 * i] | (level.data[2 * i + 1] << 8);
+        }
+        f64 const difference = level_sum / (level.width * level.height) -
+                               image_sum / (width * height);
+        CHECK(difference < 0.51 && difference > -0.51);
+      }
+    }
+  }
+
+  static void decode_bc4_block(u8 const* const block, u8 (&values)[16])
+  {
+    i32 const r0 = block[0];
+    i32 const r1 = block[1];
+    i32 palette[8] = {r0, r1};
+    if(r0 > r1) {
+      for(i32 i = 1; i < 7; ++i) {
+        palette[i + 1] = ((7 - i) * r0 + i * r1) / 7;
+      }
+    } else {
+      for(i32 i = 1; i < 5; ++i) {
+        palette[i + 1] = ((5 - i) * r0 + i * r1) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+
+    u64 indices = 0;
+    for(i32 i = 0; i < 6; ++i) {
+      indices |= static_cast<u64>(block[i + 2]) << (8 * i);
+    }
+    for(i32 i = 0; i < 16; ++i) {
+      values[i] = palette[(indices >> (3 * i)) & 7];
+    }
+  }
+
+  // Decode the color of a BC1 block. four_colors forces the 4 color mode
+  // as in BC3.
+  static void decode_bc1_block(u8 const* const block, bool const four_colors,
+                               u8 (&pixels)[16][4])
+  {
+    u16 const colors[2] = {static_cast<u16>(block[0] | (block[1] << 8)),
+                           static_cast<u16>(block[2] | (block[3] << 8))};
+    i32 palette[4][3];
+    for(i32 i = 0; i < 2; ++i) {
+      palette[i][0] = (colors[i] >> 11) * 255 / 31;
+      palette[i][1] = ((colors[i] >> 5) & 63) * 255 / 63;
+      palette[i][2] = (colors[i] & 31) * 255 / 31;
+    }
+    for(i32 c = 0; c < 3; ++c) {
+      if(four_colors || colors[0] > colors[1]) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      } else {
+        palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = 0;
+      }
+    }
+
+    for(i32 i = 0; i < 16; ++i) {
+      i32 const index = (block[4 + i / 4] >> (2 * (i % 4))) & 3;
+      for(i32 c = 0; c < 3; ++c) {
+        pixels[i][c] = palette[index][c];
+      }
+    }
+  }
+
+  [[nodiscard]] static u32 read_bits(u8 const* const block, i32& position,
+                                     i32 const count)
+  {
+    u32 value = 0;
+    for(i32 i = 0; i < count; ++i, ++position) {
+      value |= ((block[position >> 3] >> (position & 7)) & 1) << i;
+    }
+    return value;
+  }
+
+  // Decode a BC7 block. Only mode 6 is supported.
+  // Returns: Whether the block uses mode 6.
+  [[nodiscard]] static bool decode_bc7_block(u8 const* const block,
+                                             u8 (&pixels)[16][4])
+  {
+    if((block[0] & 0x7F) != 0x40) {
+      return false;
+    }
+
+    i32 position = 7;
+    i32 endpoints[2][4];
+    for(i32 c = 0; c < 4; ++c) {
+      endpoints[0][c] = read_bits(block, position, 7) << 1;
+      endpoints[1][c] = read_bits(block, position, 7) << 1;
+    }
+    u32 const p0 = read_bits(block, position, 1);
+    u32 const p1 = read_bits(block, position, 1);
+    for(i32 c = 0; c < 4; ++c) {
+      endpoints[0][c] |= p0;
+      endpoints[1][c] |= p1;
+    }
+
+    i32 const weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                             34, 38, 43, 47, 51, 55, 60, 64};
+    for(i32 i = 0; i < 16; ++i) {
+      i32 const index = read_bits(block, position, i == 0 ? 3 : 4);
+      for(i32 c = 0; c < 4; ++c) {
+        pixels[i][c] = ((64 - weights[index]) * endpoints[0][c] +
+                        weights[index] * endpoints[1][c] + 32) >>
+                       6;
+      }
+    }
+    return true;
+  }
+
+  // Smooth gradients with noise, which is what block compression is built
+  // for. Dimensions are not multiples of 4 to exercise the partial blocks.
+  // decreasing - bit mask of the channels that decrease along x and y.
+  //              Exercises the ordering of the endpoints.
+  [[nodiscard]] static Image make_gradient(Image_Pixel_Format const format,
+                                           i64 const channels,
+                                           u32 const decreasing)
+  {
+    u32 const width = 21;
+    u32 const height = 11;
+    Image image = make_image(width, height, format, channels);
+    for(i64 y = 0; y < height; ++y) {
+      for(i64 x = 0; x < width; ++x) {
+        for(i64 c = 0; c < channels; ++c) {
+          bool const reverse = (decreasing >> c) & 1;
+          i64 const gradient_x = reverse ? width - 1 - x : x;
+          i64 const gradient_y = reverse ? height - 1 - y : y;
+          i64 const value = gradient_x * (3 + c) + gradient_y * (7 - c) + 20 +
+                            random_i64(-4, 4);
+          image.data[(y * width + x) * channels + c] = value;
+        }
+      }
+    }
+    return image;
+  }
+
+  // Compress the gradient, decode it and compare the pixels.
+  // Returns: Largest difference of a channel or -1 if a block could not be
+  //          decoded.
+  [[nodiscard]] static i64 compress_and_decode(Image_Pixel_Format const format,
+                                               i64 const channels,
+                                               Block_Format const block_format,
+                                               u32 const decreasing)
+  {
+    Image const image = make_gradient(format, channels, decreasing);
+    anton::Array<u8> const blocks = compress_image(image, block_format);
+    i64 const blocks_x = (image.width + 3) / 4;
+    i64 const blocks_y = (image.height + 3) / 4;
+    i64 const block_size =
+      block_format == Block_Format::bc1 || block_format == Block_Format::bc4
+        ? 8
+        : 16;
+    if(blocks.size() != blocks_x * blocks_y * block_size) {
+      return -1;
+    }
+
+    i64 max_error = 0;
+    for(i64 block_y = 0; block_y < blocks_y; ++block_y) {
+      for(i64 block_x = 0; block_x < blocks_x; ++block_x) {
+        u8 const* const block =
+          blocks.data() + (block_y * blocks_x + block_x) * block_size;
+        u8 pixels[16][4];
+        u8 values[16];
+        switch(block_format) {
+        case Block_Format::bc1:
+          decode_bc1_block(block, false, pixels);
+          break;
+        case Block_Format::bc3:
+          decode_bc4_block(block, values);
+          decode_bc1_block(block + 8, true, pixels);
+          for(i64 i = 0; i < 16; ++i) {
+            pixels[i][3] = values[i];
+          }
+          break;
+        case Block_Format::bc4:
+        case Block_Format::bc5:
+          for(i64 c = 0; c < channels; ++c) {
+            decode_bc4_block(block + 8 * c, values);
+            for(i64 i = 0; i < 16; ++i) {
+              pixels[i][c] = values[i];
+            }
+          }
+          break;
+        case Block_Format::bc7:
+          if(!decode_bc7_block(block, pixels)) {
+            return -1;
+          }
+          break;
+        }
+
+        for(i64 i = 0; i < 16; ++i) {
+          i64 const x = block_x * 4 + i % 4;
+          i64 const y = block_y * 4 + i / 4;
+          if(x >= image.width || y >= image.height) {
+            continue;
+          }
+
+          u8 const* const pixel =
+            image.data.data() + (y * image.width + x) * channels;
+          for(i64 c = 0; c < channels; ++c) {
+            max_error =
+              math::max(max_error, abs_difference(pixels[i][c], pixel[c]));
+          }
+        }
+      }
+    }
+    return max_error;
+  }
+
+  // Returns: Largest difference of compress_and_decode over gradients
+  //          increasing in all channels, decreasing in red and decreasing in
+  //          all channels.
+  [[nodiscard]] static i64 get_max_error(Image_Pixel_Format const format,
+                                         i64 const channels,
+                                         Block_Format const block_format)
+  {
+    i64 max_error = 0;
+    u32 const masks[] = {0b0000, 0b0001, 0b1111};
+    for(u32 const decreasing: masks) {
+      i64 const error =
+        compress_and_decode(format, channels, block_format, decreasing);
+      if(error == -1) {
+        return -1;
+      }
+      max_error = math::max(max_error, error);
+    }
+    return max_error;
+  }
+
+  static void test_compression()
+  {
+    seed_default_random_engine(3407);
+    i64 const bc4 =
+      get_max_error(Image_Pixel_Format::grey8, 1, Block_Format::bc4);
+    CHECK(bc4 >= 0 && bc4 <= 8);
+    i64 const bc5 =
+      get_max_error(Image_Pixel_Format::grey8_alpha8, 2, Block_Format::bc5);
+    CHECK(bc5 >= 0 && bc5 <= 8);
+    i64 const bc7_rgb =
+      get_max_error(Image_Pixel_Format::rgb8, 3, Block_Format::bc7);
+    CHECK(bc7_rgb >= 0 && bc7_rgb <= 14);
+    i64 const bc7_rgba =
+      get_max_error(Image_Pixel_Format::rgba8, 4, Block_Format::bc7);
+    CHECK(bc7_rgba >= 0 && bc7_rgba <= 14);
+    i64 const bc1 =
+      get_max_error(Image_Pixel_Format::rgb8, 3, Block_Format::bc1);
+    CHECK(bc1 >= 0 && bc1 <= 20);
+    i64 const bc3 =
+      get_max_error(Image_Pixel_Format::rgba8, 4, Block_Format::bc3);
+    CHECK(bc3 >= 0 && bc3 <= 20);
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  init_jobs();
+  test_chain_sizes();
+  test_odd_dimensions();
+  test_srgb_averaged_in_linear_space();
+  test_mean_is_preserved();
+  test_compression();
+  terminate_jobs();
+  return report_test_results();
+}
@@ -0,0 +1,161 @@
+#include <test.hpp>
+
+#include <anton/math/math.hpp>
+#include <engine/components/hierarchy.hpp>
+#include <engine/components/transform.hpp>
+#include <engine/components/world_matrix.hpp>
+#include <engine/ecs/ecs.hpp>
+#include <engine/ecs/jobs_management.hpp>
+
+namespace anton_engine {
+  [[nodiscard]] static bool translation_equals(ECS& ecs, Entity const entity,
+                                               Vec3 const expected)
+  {
+    Vec3 const translation =
+      math::get_translation(ecs.get_component<World_Matrix>(entity).matrix);
+    return math::length(translation - expected) < 1e-5f;
+  }
+
+  [[nodiscard]] static bool matrix_equals(Mat4 const& lhs, Mat4 const& rhs)
+  {
+    for(i64 i = 0; i < 4; ++i) {
+      for(i64 j = 0; j < 4; ++j) {
+        if(math::abs(lhs[i][j] - rhs[i][j]) > 1e-5f) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  static void test_children_follow_parents()
+  {
+    ECS ecs;
+    World_Matrix_Cache cache;
+    auto [parent, parent_transform] = ecs.create<Transform>();
+    parent_transform.translate(Vec3(1.0f, 0.0f, 0.0f));
+    auto [child, child_transform] = ecs.create<Transform>();
+    child_transform.translate(Vec3(0.0f, 2.0f, 0.0f));
+    auto [grandchild, grandchild_transform] = ecs.create<Transform>();
+    grandchild_transform.translate(Vec3(0.0f, 0.0f, 3.0f));
+    set_parent(ecs, child, parent);
+    set_parent(ecs, grandchild, child);
+    update_world_matrices(ecs, cache);
+    CHECK(translation_equals(ecs, parent, Vec3(1.0f, 0.0f, 0.0f)));
+    CHECK(translation_equals(ecs, child, Vec3(1.0f, 2.0f, 0.0f)));
+    CHECK(translation_equals(ecs, grandchild, Vec3(1.0f, 2.0f, 3.0f)));
+    CHECK(!ecs.get_component<Transform>(grandchild).dirty);
+
+    ecs.get_component<Transform>(parent).translate(Vec3(4.0f, 0.0f, 0.0f));
+    update_world_matrices(ecs, cache);
+    CHECK(translation_equals(ecs, child, Vec3(5.0f, 2.0f, 0.0f)));
+    CHECK(translation_equals(ecs, grandchild, Vec3(5.0f, 2.0f, 3.0f)));
+  }
+
+  static void test_destroying_parent_detaches_children()
+  {
+    ECS ecs;
+    World_Matrix_Cache cache;
+    auto [parent, parent_transform] = ecs.create<Transform>();
+    parent_transform.translate(Vec3(1.0f, 0.0f, 0.0f));
+    auto [child, child_transform] = ecs.create<Transform>();
+    child_transform.translate(Vec3(0.0f, 2.0f, 0.0f));
+    auto [grandchild, grandchild_transform] = ecs.create<Transform>();
+    grandchild_transform.translate(Vec3(0.0f, 0.0f, 3.0f));
+    set_parent(ecs, child, parent);
+    set_parent(ecs, grandchild, child);
+    update_world_matrices(ecs, cache);
+
+    ecs.destroy(parent);
+    ecs.remove_requested_entities();
+    // The index of the parent is reused by an entity that must not be mistaken
+    // for the destroyed parent.
+    ecs.create<Transform>();
+    update_world_matrices(ecs, cache);
+    CHECK(ecs.get_component<Hierarchy>(child).parent == null_entity);
+    CHECK(ecs.get_component<Hierarchy>(grandchild).parent == child);
+    CHECK(translation_equals(ecs, child, Vec3(0.0f, 2.0f, 0.0f)));
+    CHECK(translation_equals(ecs, grandchild, Vec3(0.0f, 2.0f, 3.0f)));
+  }
+
+  // Scale and rotation of a parent do not commute with the translation of its
+  // child, so the matrices are combined in the order of to_matrix.
+  static void test_parent_scale_and_rotation()
+  {
+    ECS ecs;
+    World_Matrix_Cache cache;
+    auto [parent, parent_transform] = ecs.create<Transform>();
+    parent_transform.translate(Vec3(1.0f, 0.0f, 0.0f));
+    parent_transform.rotate(Vec3(0.0f, 0.0f, 1.0f), math::pi / 2.0f);
+    parent_transform.scale(Vec3(2.0f, 3.0f, 4.0f));
+    auto [child, child_transform] = ecs.create<Transform>();
+    child_transform.translate(Vec3(0.0f, 2.0f, 0.0f));
+    child_transform.rotate(Vec3(1.0f, 0.0f, 0.0f), math::pi / 4.0f);
+    child_transform.scale(Vec3(0.5f, 0.5f, 0.5f));
+    auto [grandchild, grandchild_transform] = ecs.create<Transform>();
+    grandchild_transform.translate(Vec3(0.0f, 0.0f, 3.0f));
+    set_parent(ecs, child, parent);
+    set_parent(ecs, grandchild, child);
+    update_world_matrices(ecs, cache);
+
+    Mat4 const parent_matrix = to_matrix(ecs.get_component<Transform>(parent));
+    Mat4 const child_matrix =
+      to_matrix(ecs.get_component<Transform>(child)) * parent_matrix;
+    Mat4 const grandchild_matrix =
+      to_matrix(ecs.get_component<Transform>(grandchild)) * child_matrix;
+    CHECK(matrix_equals(ecs.get_component<World_Matrix>(child).matrix,
+                        child_matrix));
+    CHECK(matrix_equals(ecs.get_component<World_Matrix>(grandchild).matrix,
+                        grandchild_matrix));
+    // The parent's scale applies to the child's translation.
+    CHECK(!matrix_equals(child_matrix,
+                         parent_matrix *
+                           to_matrix(ecs.get_component<Transform>(child))));
+  }
+
+  static void test_cache_follows_structure_changes()
+  {
+    ECS ecs;
+    World_Matrix_Cache cache;
+    auto [a, a_transform] = ecs.create<Transform>();
+    a_transform.translate(Vec3(1.0f, 0.0f, 0.0f));
+    auto [b, b_transform] = ecs.create<Transform>();
+    b_transform.translate(Vec3(0.0f, 2.0f, 0.0f));
+    auto [child, child_transform] = ecs.create<Transform>();
+    child_transform.translate(Vec3(0.0f, 0.0f, 3.0f));
+    set_parent(ecs, child, a);
+    update_world_matrices(ecs, cache);
+    CHECK(translation_equals(ecs, child, Vec3(1.0f, 0.0f, 3.0f)));
+
+    // Clean transforms do not rebuild the cache.
+    u64 const version = cache.structure_version;
+    update_world_matrices(ecs, cache);
+    CHECK(cache.structure_version == version);
+
+    set_parent(ecs, child, b);
+    update_world_matrices(ecs, cache);
+    CHECK(translation_equals(ecs, child, Vec3(0.0f, 2.0f, 3.0f)));
+
+    // Adding components moves the containers the cache points into.
+    for(i64 i = 0; i < 100; ++i) {
+      ecs.create<Transform>();
+    }
+    update_world_matrices(ecs, cache);
+    ecs.get_component<Transform>(b).translate(Vec3(0.0f, 1.0f, 0.0f));
+    update_world_matrices(ecs, cache);
+    CHECK(translation_equals(ecs, child, Vec3(0.0f, 3.0f, 3.0f)));
+    CHECK(cache.structure_version == ecs.get_structure_version());
+  }
+} // namespace anton_engine
+
+int main()
+{
+  using namespace anton_engine;
+  init_jobs();
+  test_children_follow_parents();
+  test_destroying_parent_detaches_children();
+  test_parent_scale_and_rotation();
+  test_cache_follows_structure_changes();
+  terminate_jobs();
+  return report_test_results();
+}